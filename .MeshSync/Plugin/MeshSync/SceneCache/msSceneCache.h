@@ -4,6 +4,7 @@
 #include <mutex>
 #include <future>
 #include "SceneGraph/msSceneGraph.h"
+#include "SceneGraph/msAnimation.h"
 
 namespace ms {
 
@@ -16,6 +17,9 @@ enum class SceneCacheEncoding
 struct SceneCacheSettings
 {
     SceneCacheEncoding encoding = SceneCacheEncoding::ZSTD;
+    // animation clips in scenes passed to addScene() are encoded as copies and the scenes are left as they are.
+    // they are decoded on read.
+    CurveEncodingSettings curve_encoding;
 };
 
 
@@ -101,9 +101,26 @@ void OSceneCacheImpl::doWrite()
                 continue;
 
 
+            // the scene belongs to the caller and may still be in use. clips are encoded as copies.
+            auto scene = desc.scene;
+            if (m_settings.curve_encoding.enabled || m_settings.curve_encoding.share_times) {
+                scene = Scene::create();
+                scene->settings = desc.scene->settings;
+                scene->assets = desc.scene->assets;
+                scene->entities = desc.scene->entities;
+                scene->constraints = desc.scene->constraints;
+                for (auto& asset : scene->assets) {
+                    if (auto clip = std::dynamic_pointer_cast<AnimationClip>(asset)) {
+                        clip = clip->clone();
+                        clip->encode(m_settings.curve_encoding);
+                        asset = clip;
+                    }
+                }
+            }
+
             // serialize
             m_scene_buf.reset();
-            desc.scene->serialize(m_scene_buf);
+            scene->serialize(m_scene_buf);
             m_scene_buf.flush();
 
             // encode
@@ -210,6 +227,8 @@ ScenePtr ISceneCacheImpl::getByIndex(size_t i)
     try {
         m_last_scene = Scene::create();
         m_last_scene->deserialize(m_scene_buf);
+        for (auto& clip : m_last_scene->getAssets<AnimationClip>())
+            clip->decode();
         return m_last_scene;
     }
     catch (std::runtime_error& e) {
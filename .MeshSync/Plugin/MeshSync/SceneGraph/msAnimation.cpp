@@ -46,29 +46,619 @@ static void ReserveKeyframes(AnimationCurve& self, size_t n)
 }
 template<> void ReserveKeyframes<void>(AnimationCurve& /*self*/, size_t /*n*/) {}
 
+// keyframe reduction works on values as arrays of float components.
+template<class T> struct KeyComponents { static const int N = sizeof(T) / sizeof(float); };
+template<> struct KeyComponents<int> { static const int N = 1; };
+
+template<class T> static inline void GetComponents(const T& v, float *dst)
+{
+    for (int c = 0; c < KeyComponents<T>::N; ++c)
+        dst[c] = ((const float*)&v)[c];
+}
+template<> inline void GetComponents<int>(const int& v, float *dst) { dst[0] = (float)v; }
+
+// selects keys to keep: the greedy pass extends each segment as far as it fits in the tolerance (galloping and then
+// binary search), and for Smooth interpolation a fix-up pass re-inserts the worst key of segments that don't fit
+// anymore because their tangents depend on the neighbor keys that are finally kept.
+class KeyframeReducer
+{
+public:
+    KeyframeReducer(const float *times, const float *values, int num_keys, int num_components,
+        const KeyframeReductionSettings& settings, bool rotation)
+        : m_times(times), m_values(values), m_num_keys(num_keys), m_num_components(num_components)
+        , m_smooth(settings.interpolation == KeyframeReductionSettings::Interpolation::Smooth)
+        , m_rotation(rotation)
+    {
+        // chord length between unit quaternions is 2 * sin(angle / 4)
+        if (m_rotation)
+            m_bound = std::max(2.0f * std::sin(settings.rotation_tolerance * 0.25f), muEpsilon);
+        else
+            m_bound = std::max(settings.tolerance, muEpsilon);
+    }
+
+    void reduce(RawVector<int>& kept) const
+    {
+        kept.clear();
+        int n = m_num_keys;
+        if (n <= 2) {
+            for (int i = 0; i < n; ++i)
+                kept.push_back(i);
+            return;
+        }
+
+        kept.push_back(0);
+        int prev = -1, begin = 0;
+        while (begin < n - 1) {
+            auto fits = [&](int end) { return worstKey(prev, begin, end, end + 1 < n ? end + 1 : -1, false) == -1; };
+            int good = begin + 1, bad = n;
+            for (int step = 1; ; step *= 2) {
+                int end = std::min(begin + 1 + step, n - 1);
+                if (end <= good)
+                    break;
+                if (fits(end))
+                    good = end;
+                else {
+                    bad = end;
+                    break;
+                }
+            }
+            while (bad - good > 1) {
+                int mid = (good + bad) / 2;
+                if (fits(mid))
+                    good = mid;
+                else
+                    bad = mid;
+            }
+            kept.push_back(good);
+            prev = begin;
+            begin = good;
+        }
+
+        if (!m_smooth)
+            return;
+        RawVector<int> tmp;
+        for (;;) {
+            bool inserted = false;
+            tmp.clear();
+            size_t num_kept = kept.size();
+            for (size_t ki = 0; ki + 1 < num_kept; ++ki) {
+                tmp.push_back(kept[ki]);
+                int worst = worstKey(ki > 0 ? kept[ki - 1] : -1, kept[ki], kept[ki + 1], ki + 2 < num_kept ? kept[ki + 2] : -1, true);
+                if (worst != -1) {
+                    tmp.push_back(worst);
+                    inserted = true;
+                }
+            }
+            tmp.push_back(kept.back());
+            kept.swap(tmp);
+            if (!inserted)
+                break;
+        }
+    }
+
+private:
+    const float* value(int i) const { return m_values + (size_t)m_num_components * i; }
+
+    static float SafeDiv(float y, float x) { return std::abs(x) > 0.00001f ? y / x : 0.0f; }
+
+    // clamped auto tangent (bias 0.5) of component c of key k whose neighbor keys are p and n.
+    // same as Unity's. the first and last keys have flat tangents.
+    float tangent(int p, int k, int n, int c) const
+    {
+        if (p == -1 || n == -1)
+            return 0.0f;
+
+        float dx1 = m_times[k] - m_times[p];
+        float dy1 = value(k)[c] - value(p)[c];
+        float dx2 = m_times[n] - m_times[k];
+        float dy2 = value(n)[c] - value(k)[c];
+        float dy = dy1 + dy2;
+        float m1 = SafeDiv(dy1, dx1);
+        float m2 = SafeDiv(dy2, dx2);
+        float m = SafeDiv(dy, dx1 + dx2);
+        if ((m1 > 0 && m2 > 0) || (m1 < 0 && m2 < 0)) {
+            float lower_dy = dy * 0.25f;
+            float upper_dy = dy * 0.75f;
+            if (std::abs(dy1) >= std::abs(upper_dy))
+                return (1.0f - SafeDiv(dy1 - upper_dy, lower_dy)) * m;
+            else if (std::abs(dy1) < std::abs(lower_dy))
+                return SafeDiv(dy1, lower_dy) * m;
+            else
+                return m;
+        }
+        return 0.0f;
+    }
+
+    // keys between b and e are reconstructed from them as if they were adjacent. p and n are the keys next to b and e
+    // (-1 if none) that the tangents of b and e depend on.
+    // returns -1 if all of them are in the tolerance. otherwise the index of the worst key if find_worst is true,
+    // or the first key out of the tolerance.
+    int worstKey(int p, int b, int e, int n, bool find_worst) const
+    {
+        const int max_components = 4;
+        float m0[max_components], m1[max_components];
+        for (int c = 0; c < m_num_components; ++c) {
+            m0[c] = m_smooth ? tangent(p, b, e, c) : 0.0f;
+            m1[c] = m_smooth ? tangent(b, e, n, c) : 0.0f;
+        }
+
+        const float *v0 = value(b);
+        const float *v1 = value(e);
+        float t0 = m_times[b];
+        float dt = m_times[e] - t0;
+        int worst = -1;
+        float worst_error = m_bound;
+        for (int i = b + 1; i < e; ++i) {
+            float s = dt > 0.0f ? (m_times[i] - t0) / dt : 0.0f;
+            float r[max_components];
+            if (m_smooth) {
+                float s2 = s * s, s3 = s2 * s;
+                float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+                float h10 = s3 - 2.0f * s2 + s;
+                float h01 = -2.0f * s3 + 3.0f * s2;
+                float h11 = s3 - s2;
+                for (int c = 0; c < m_num_components; ++c)
+                    r[c] = h00 * v0[c] + h10 * dt * m0[c] + h01 * v1[c] + h11 * dt * m1[c];
+            }
+            else {
+                for (int c = 0; c < m_num_components; ++c)
+                    r[c] = v0[c] + (v1[c] - v0[c]) * s;
+            }
+
+            const float *v = value(i);
+            float error = 0.0f;
+            if (m_rotation) {
+                // q and -q are the same rotation
+                float len = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+                float d = r[0] * v[0] + r[1] * v[1] + r[2] * v[2] + r[3] * v[3];
+                float rl = (len > 0.0f ? 1.0f / len : 0.0f) * (d < 0.0f ? -1.0f : 1.0f);
+                float sq = 0.0f;
+                for (int c = 0; c < 4; ++c) {
+                    float diff = r[c] * rl - v[c];
+                    sq += diff * diff;
+                }
+                error = std::sqrt(sq);
+            }
+            else {
+                for (int c = 0; c < m_num_components; ++c)
+                    error = std::max(error, std::abs(r[c] - v[c]));
+            }
+
+            if (error > worst_error) {
+                worst = i;
+                worst_error = error;
+                if (!find_worst)
+                    break;
+            }
+        }
+        return worst;
+    }
+
+    const float *m_times;
+    const float *m_values;
+    int m_num_keys;
+    int m_num_components;
+    bool m_smooth;
+    bool m_rotation;
+    float m_bound;
+};
+
+// returns true if all keys have the same value. the curve is cleared or reduced to 2 keys in that case.
+template<class T>
+static bool ReduceFlatKeyframes(TAnimationCurve<T>& data, bool keep_flat_curves)
+{
+    int n = (int)data.size();
+    for (int i = 1; i < n; ++i) {
+        if (!Equals<T>()(data[0].value, data[i].value))
+            return false;
+    }
+    if (keep_flat_curves) {
+        // keep at least 2 keys to prevent Unity's warning
+        data[1] = data[n - 1];
+        data.resize(2);
+    }
+    else
+        data.clear();
+    return true;
+}
+
+// removes keys that are equal to both of their neighbors, which doesn't change the curve in any interpolation mode.
+// int curves are stepped, so keys equal to the previous key are removed.
+// the first and last keys are kept. keys are compared to their original neighbors, so this can be done in place.
+template<class T>
+static void RemoveRedundantKeys(TAnimationCurve<T>& data)
+{
+    int n = (int)data.size();
+    int num_kept = 1;
+    for (int i = 1; i < n - 1; ++i) {
+        bool redundant = Equals<T>()(data[i - 1].value, data[i].value) &&
+            (std::is_same<T, int>::value || Equals<T>()(data[i].value, data[i + 1].value));
+        if (!redundant)
+            data[num_kept++] = data[i];
+    }
+    data[num_kept++] = data[n - 1];
+    data.resize(num_kept);
+}
+
 template<class T>
-static void ReduceKeyframes(AnimationCurve& self, bool keep_flat_curve)
+static void RemoveRedundantKeyframes(AnimationCurve& self, bool keep_flat_curves)
 {
     TAnimationCurve<T> data(self);
-    if (data.size() <= 1)
+    if (data.size() <= 1 || ReduceFlatKeyframes(data, keep_flat_curves))
         return;
+    RemoveRedundantKeys(data);
+}
+template<> void RemoveRedundantKeyframes<void>(AnimationCurve& /*self*/, bool /*keep_flat_curves*/) {}
 
-    auto last_key = data.back();
-    while (data.size() >= 2) {
-        if (Equals<T>()(data[data.size()-2].value, data.back().value))
-            data.pop_back();
-        else
-            break;
+template<class T>
+static void ReduceKeyframes(AnimationCurve& self, const KeyframeReductionSettings& settings)
+{
+    TAnimationCurve<T> data(self);
+    int n = (int)data.size();
+    if (n <= 1 || ReduceFlatKeyframes(data, settings.keep_flat_curves))
+        return;
+    if (std::is_same<T, int>::value) {
+        // ints are not interpolated
+        RemoveRedundantKeys(data);
+        return;
     }
 
-    if (data.size() == 1) {
-        if (keep_flat_curve)
-            data.push_back(last_key); // keep at least 2 keys to prevent Unity's warning
-        else
-            data.clear();
+    const int N = KeyComponents<T>::N;
+    RawVector<float> times, values;
+    times.resize_discard(n);
+    values.resize_discard(n * N);
+    for (int i = 0; i < n; ++i) {
+        times[i] = data[i].time;
+        GetComponents(data[i].value, &values[i * N]);
+    }
+
+    RawVector<int> kept;
+    KeyframeReducer reducer(times.data(), values.data(), n, N, settings, std::is_same<T, quatf>::value);
+    reducer.reduce(kept);
+
+    // kept is in ascending order, so keys can be moved in place
+    size_t num_kept = kept.size();
+    for (size_t ki = 0; ki < num_kept; ++ki)
+        data[ki] = data[kept[ki]];
+    data.resize(num_kept);
+}
+template<> void ReduceKeyframes<void>(AnimationCurve& /*self*/, const KeyframeReductionSettings& /*settings*/) {}
+
+template<class T> static inline void SetComponents(T& v, const float *src)
+{
+    for (int c = 0; c < KeyComponents<T>::N; ++c)
+        ((float*)&v)[c] = src[c];
+}
+template<> inline void SetComponents<int>(int& v, const float *src) { v = (int)src[0]; }
+
+
+// layout of Compressed curves:
+// EncodedCurveHeader, [min and range of each component (Quantize16)], [times (if not uniform)], values
+enum class ValueEncoding : uint8_t
+{
+    Raw,
+    Half,
+    Quantize16,
+    Quat32,
+};
+
+struct EncodedCurveHeader
+{
+    uint32_t num_keys;
+    uint8_t uniform_time;
+    ValueEncoding value_encoding;
+    uint16_t num_components;
+    float time_start;
+    float time_interval;
+};
+
+template<class T> static ValueEncoding GetValueEncoding(const CurveEncodingSettings& settings)
+{
+    switch (settings.vector_encoding) {
+    case CurveEncodingSettings::VectorEncoding::Half: return ValueEncoding::Half;
+    case CurveEncodingSettings::VectorEncoding::Quantize16: return ValueEncoding::Quantize16;
+    default: return ValueEncoding::Raw;
+    }
+}
+template<> ValueEncoding GetValueEncoding<int>(const CurveEncodingSettings& /*settings*/) { return ValueEncoding::Raw; }
+template<> ValueEncoding GetValueEncoding<quatf>(const CurveEncodingSettings& settings)
+{
+    return settings.quat32_rotations ? ValueEncoding::Quat32 : ValueEncoding::Raw;
+}
+
+template<class V> static inline void Append(RawVector<char>& dst, const V *src, size_t num)
+{
+    dst.insert(dst.end(), (const char*)src, (const char*)(src + num));
+}
+template<class V> static inline const char* Consume(V *dst, const char *src, size_t num)
+{
+    memcpy(dst, src, sizeof(V) * num);
+    return src + sizeof(V) * num;
+}
+
+template<class T>
+static void EncodeKeyframes(AnimationCurve& self, const CurveEncodingSettings& settings)
+{
+    // keys within this error from evenly spaced times are regarded as uniform
+    const float time_tolerance = 0.00001f;
+    const int N = KeyComponents<T>::N;
+
+    TAnimationCurve<T> data(self);
+    int n = (int)data.size();
+
+    EncodedCurveHeader header{};
+    header.num_keys = (uint32_t)n;
+    header.num_components = (uint16_t)N;
+    header.value_encoding = GetValueEncoding<T>(settings);
+    if (settings.uniform_time && n >= 2) {
+        float start = data[0].time;
+        float interval = (data[n - 1].time - start) / (float)(n - 1);
+        bool uniform = interval > 0.0f;
+        for (int i = 1; i < n && uniform; ++i)
+            uniform = std::abs(data[i].time - (start + interval * (float)i)) <= time_tolerance;
+        if (uniform) {
+            header.uniform_time = 1;
+            header.time_start = start;
+            header.time_interval = interval;
+        }
+    }
+
+    RawVector<char> dst;
+    Append(dst, &header, 1);
+    if (!header.uniform_time) {
+        RawVector<float> times;
+        times.resize_discard(n);
+        for (int i = 0; i < n; ++i)
+            times[i] = data[i].time;
+        Append(dst, times.data(), n);
+    }
+
+    RawVector<float> values;
+    if (header.value_encoding == ValueEncoding::Half || header.value_encoding == ValueEncoding::Quantize16) {
+        values.resize_discard(n * N);
+        for (int i = 0; i < n; ++i)
+            GetComponents(data[i].value, &values[i * N]);
+    }
+
+    switch (header.value_encoding) {
+    case ValueEncoding::Half:
+    {
+        RawVector<half> halfs;
+        halfs.resize_discard(values.size());
+        F32ToF16(halfs.data(), values.data(), values.size());
+        Append(dst, halfs.data(), halfs.size());
+        break;
+    }
+    case ValueEncoding::Quantize16:
+    {
+        float vmin[4], vrange[4];
+        for (int c = 0; c < N; ++c) {
+            vmin[c] = FLT_MAX;
+            float vmax = -FLT_MAX;
+            for (int i = 0; i < n; ++i) {
+                float v = values[i * N + c];
+                vmin[c] = std::min(vmin[c], v);
+                vmax = std::max(vmax, v);
+            }
+            vrange[c] = vmax - vmin[c];
+        }
+        Append(dst, vmin, N);
+        Append(dst, vrange, N);
+
+        for (int i = 0; i < n; ++i) {
+            for (int c = 0; c < N; ++c) {
+                float& v = values[i * N + c];
+                v = vrange[c] > 0.0f ? (v - vmin[c]) / vrange[c] : 0.0f;
+            }
+        }
+        RawVector<unorm16> quantized;
+        quantized.resize_discard(values.size());
+        F32ToU16(quantized.data(), values.data(), values.size());
+        Append(dst, quantized.data(), quantized.size());
+        break;
+    }
+    case ValueEncoding::Quat32:
+    {
+        RawVector<quat32> quats;
+        quats.resize_discard(n);
+        for (int i = 0; i < n; ++i)
+            quats[i] = (const quatf&)data[i].value;
+        Append(dst, quats.data(), n);
+        break;
+    }
+    default:
+        for (int i = 0; i < n; ++i)
+            Append(dst, &data[i].value, 1);
+        break;
+    }
+
+    self.data.swap(dst);
+    self.encoding = AnimationCurve::Encoding::Compressed;
+}
+template<> void EncodeKeyframes<void>(AnimationCurve& /*self*/, const CurveEncodingSettings& /*settings*/) {}
+
+// size of encoded data described by header, or 0 if the header is not valid for the curve
+static size_t GetEncodedSize(const EncodedCurveHeader& header, int num_components, size_t value_size)
+{
+    if (header.num_components != num_components)
+        return 0;
+    size_t n = header.num_keys;
+    size_t nc = n * num_components;
+    size_t ret = sizeof(header);
+    if (!header.uniform_time)
+        ret += sizeof(float) * n;
+    switch (header.value_encoding) {
+    case ValueEncoding::Half: ret += sizeof(half) * nc; break;
+    case ValueEncoding::Quantize16: ret += sizeof(float) * 2 * num_components + sizeof(unorm16) * nc; break;
+    case ValueEncoding::Quat32:
+        if (value_size != sizeof(quatf))
+            return 0;
+        ret += sizeof(quat32) * n;
+        break;
+    default: ret += value_size * n; break;
+    }
+    return ret;
+}
+
+template<class T>
+static void DecodeKeyframes(AnimationCurve& self)
+{
+    const int N = KeyComponents<T>::N;
+
+    RawVector<char> src;
+    src.swap(self.data);
+    self.encoding = AnimationCurve::Encoding::Plain;
+
+    // data comes from the network or files. curves whose size doesn't match the header are cleared.
+    EncodedCurveHeader header;
+    if (src.size() < sizeof(header))
+        return;
+    const char *p = Consume(&header, src.data(), 1);
+    if (src.size() != GetEncodedSize(header, N, sizeof(T)))
+        return;
+
+    TAnimationCurve<T> data(self);
+    int n = (int)header.num_keys;
+    data.resize_discard(n);
+
+    if (header.uniform_time) {
+        for (int i = 0; i < n; ++i)
+            data[i].time = header.time_start + header.time_interval * (float)i;
+    }
+    else {
+        for (int i = 0; i < n; ++i)
+            p = Consume(&data[i].time, p, 1);
+    }
+
+    RawVector<float> values;
+    switch (header.value_encoding) {
+    case ValueEncoding::Half:
+    {
+        RawVector<half> halfs;
+        halfs.resize_discard(n * N);
+        p = Consume(halfs.data(), p, halfs.size());
+        values.resize_discard(n * N);
+        F16ToF32(values.data(), halfs.data(), values.size());
+        break;
+    }
+    case ValueEncoding::Quantize16:
+    {
+        float vmin[4], vrange[4];
+        p = Consume(vmin, p, N);
+        p = Consume(vrange, p, N);
+        RawVector<unorm16> quantized;
+        quantized.resize_discard(n * N);
+        p = Consume(quantized.data(), p, quantized.size());
+        values.resize_discard(n * N);
+        U16ToF32(values.data(), quantized.data(), values.size());
+        for (int i = 0; i < n; ++i) {
+            for (int c = 0; c < N; ++c) {
+                float& v = values[i * N + c];
+                v = vmin[c] + v * vrange[c];
+            }
+        }
+        break;
     }
+    case ValueEncoding::Quat32:
+    {
+        RawVector<quat32> quats;
+        quats.resize_discard(n);
+        p = Consume(quats.data(), p, n);
+        // quat32 loses the sign. flip keys to keep the curve continuous, as keys are interpolated component-wise.
+        quatf prev = quatf::identity();
+        for (int i = 0; i < n; ++i) {
+            quatf q = to<quatf>(quats[i]);
+            if (i > 0 && dot((const float4&)q, (const float4&)prev) < 0.0f)
+                q = { -q.x, -q.y, -q.z, -q.w };
+            (quatf&)data[i].value = q;
+            prev = q;
+        }
+        break;
+    }
+    default:
+        for (int i = 0; i < n; ++i)
+            p = Consume(&data[i].value, p, 1);
+        break;
+    }
+
+    if (!values.empty()) {
+        for (int i = 0; i < n; ++i)
+            SetComponents(data[i].value, &values[i * N]);
+    }
+}
+template<> void DecodeKeyframes<void>(AnimationCurve& /*self*/) {}
+
+
+// SoA curves keep values only and refer to times that can be shared with other curves.
+// serialized data of SoA curves:
+// SoACurveHeader, [times (if time_ref is -1)], values
+struct SoACurveHeader
+{
+    uint32_t num_keys;
+    int32_t time_ref; // index of the preceding curve in the animation that has the same times, or -1
+};
+
+template<class T> static size_t GetValueSize() { return sizeof(T); }
+template<> size_t GetValueSize<void>() { return 0; }
+
+template<class T>
+static void GetTimes(const AnimationCurve& self, RawVector<float>& dst)
+{
+    TAnimationCurve<T> data(self);
+    size_t n = data.size();
+    dst.resize_discard(n);
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = data[i].time;
+}
+template<> void GetTimes<void>(const AnimationCurve& /*self*/, RawVector<float>& dst) { dst.clear(); }
+
+template<class T>
+static void ToSoA(AnimationCurve& self, std::shared_ptr<RawVector<float>> times)
+{
+    TAnimationCurve<T> data(self);
+    size_t n = data.size();
+    if (!times) {
+        times = std::make_shared<RawVector<float>>();
+        GetTimes<T>(self, *times);
+    }
+
+    RawVector<char> values;
+    values.resize_discard(sizeof(T) * n);
+    auto *v = (T*)values.data();
+    for (size_t i = 0; i < n; ++i)
+        v[i] = data[i].value;
+
+    self.data.swap(values);
+    self.times = times;
+    self.encoding = AnimationCurve::Encoding::SoA;
+}
+template<> void ToSoA<void>(AnimationCurve& /*self*/, std::shared_ptr<RawVector<float>> /*times*/) {}
+
+template<class T>
+static void FromSoA(AnimationCurve& self)
+{
+    RawVector<char> src;
+    src.swap(self.data);
+    auto times = std::move(self.times);
+    self.encoding = AnimationCurve::Encoding::Plain;
+    if (!times)
+        return;
+
+    size_t n = std::min(times->size(), src.size() / sizeof(T));
+    auto *v = (const T*)src.data();
+    TAnimationCurve<T> data(self);
+    data.resize_discard(n);
+    for (size_t i = 0; i < n; ++i) {
+        data[i].time = (*times)[i];
+        data[i].value = v[i];
+    }
+}
+template<> void FromSoA<void>(AnimationCurve& self)
+{
+    self.data.clear();
+    self.times.reset();
+    self.encoding = AnimationCurve::Encoding::Plain;
 }
-template<> void ReduceKeyframes<void>(AnimationCurve& /*self*/, bool /*keep_flat_curve*/) {}
 
 template<class T> static inline T handle_yz(const T& v) { return flip_z(swap_yz(v)); }
 template<> inline quatf handle_yz(const quatf& v) { return flip_z(swap_yz(v)) * rotate_x(-90.0f * DegToRad); }
@@ -118,20 +708,164 @@ template<> void ApplyScale<float3>(AnimationCurve& self, float v) { ApplyScaleIm
 template<> void ApplyScale<float4>(AnimationCurve& self, float v) { ApplyScaleImpl<float4>(self, v); }
 
 
+// index of the last key whose time is <= time, or 0 if time is before the first key. keys must not be empty.
+// walks a few keys forward from the cursor, which is all it takes for sequential playback, and falls back to binary search.
+// TimeAt: [](int i) -> float. it abstracts Plain (TVP<T>) and SoA (shared times) curves.
+template<class TimeAt>
+static inline int UpperBound(const TimeAt& time_at, int begin, int end, float time)
+{
+    while (begin < end) {
+        int mid = begin + (end - begin) / 2;
+        if (time < time_at(mid))
+            end = mid;
+        else
+            begin = mid + 1;
+    }
+    return begin;
+}
+
+template<class TimeAt>
+static inline int FindKey(const TimeAt& time_at, int num, float time, int& cursor)
+{
+    const int max_steps = 4;
+    int k = std::min(std::max(cursor, 0), num - 1);
+    if (time_at(k) <= time) {
+        int last = std::min(k + max_steps, num - 1);
+        while (k < last && time_at(k + 1) <= time)
+            ++k;
+        if (k == last && k < num - 1 && time_at(k + 1) <= time)
+            k = UpperBound(time_at, k + 1, num, time) - 1;
+    }
+    else {
+        k = std::max(UpperBound(time_at, 0, k, time) - 1, 0);
+    }
+    cursor = k;
+    return k;
+}
+
+template<class T, class TimeAt>
+static inline void StageKeysImpl(const TimeAt& time_at, const T *v0, size_t value_stride, int n,
+    float time, int& cursor, float4& v1, float4& v2, float& w)
+{
+    int k1 = FindKey(time_at, n, time, cursor);
+    int k2 = std::min(k1 + 1, n - 1);
+    float dt = time_at(k2) - time_at(k1);
+    if (dt > 0.0f)
+        w = clamp01((time - time_at(k1)) / dt);
+    memcpy(&v1, (const char*)v0 + value_stride * k1, sizeof(T));
+    memcpy(&v2, (const char*)v0 + value_stride * k2, sizeof(T));
+}
+
+// keys to interpolate and the weight of the later one are staged as float4 for Interpolate()
+template<class T>
+static void StageKeys(AnimationCurve& self, float time, int& cursor, float4& v1, float4& v2, float& w)
+{
+    v1 = v2 = float4::zero();
+    w = 0.0f;
+    if (self.encoding == AnimationCurve::Encoding::SoA) {
+        const float *times = self.times ? self.times->data() : nullptr;
+        int n = times ? (int)std::min(self.times->size(), self.data.size() / sizeof(T)) : 0;
+        if (n == 0)
+            return;
+        StageKeysImpl(
+            [times](int i) { return times[i]; }, (const T*)self.data.data(), sizeof(T), n,
+            time, cursor, v1, v2, w);
+    }
+    else {
+        TAnimationCurve<T> keys(self);
+        int n = (int)keys.size();
+        if (n == 0)
+            return;
+        const TVP<T> *k = keys.data();
+        StageKeysImpl(
+            [k](int i) { return k[i].time; }, &k->value, sizeof(TVP<T>), n,
+            time, cursor, v1, v2, w);
+    }
+}
+template<> void StageKeys<void>(AnimationCurve& /*self*/, float /*time*/, int& /*cursor*/, float4& v1, float4& v2, float& w)
+{
+    v1 = v2 = float4::zero();
+    w = 0.0f;
+}
+
+// float - float4 keys are lerped, quaternion keys are slerped and int keys are stepped.
+// the kernels pay off from a few elements. fewer ones (e.g. single evaluations) are interpolated inline.
+static const size_t kMinInterpolationBatch = 8;
+
+template<class T>
+static void Interpolate(float4 *dst, const float4 *v1, const float4 *v2, const float *w, size_t num)
+{
+    if (num < kMinInterpolationBatch) {
+        for (size_t i = 0; i < num; ++i)
+            dst[i] = lerp(v1[i], v2[i], w[i]);
+    }
+    else
+        mu::LerpWeighted(dst, v1, v2, w, num);
+}
+template<> void Interpolate<quatf>(float4 *dst, const float4 *v1, const float4 *v2, const float *w, size_t num)
+{
+    if (num < kMinInterpolationBatch) {
+        for (size_t i = 0; i < num; ++i)
+            (quatf&)dst[i] = slerp((const quatf&)v1[i], (const quatf&)v2[i], w[i]);
+    }
+    else
+        mu::Slerp((quatf*)dst, (const quatf*)v1, (const quatf*)v2, w, num);
+}
+template<> void Interpolate<int>(float4 *dst, const float4 *v1, const float4 * /*v2*/, const float * /*w*/, size_t num)
+{
+    memcpy(dst, v1, sizeof(float4) * num);
+}
+template<> void Interpolate<void>(float4 *dst, const float4 *v1, const float4 * /*v2*/, const float * /*w*/, size_t num)
+{
+    memcpy(dst, v1, sizeof(float4) * num);
+}
+
+template<class T>
+static void EvaluateKeys(AnimationCurve& self, const float *times, int num, void *dst_, int& cursor)
+{
+    // processed in chunks to keep the work buffers on the stack
+    const int chunk_size = 256;
+    float4 v1[chunk_size], v2[chunk_size], r[chunk_size];
+    float w[chunk_size];
+    char *dst = (char*)dst_;
+    for (int base = 0; base < num; base += chunk_size) {
+        int n = std::min(chunk_size, num - base);
+        for (int i = 0; i < n; ++i)
+            StageKeys<T>(self, times[base + i], cursor, v1[i], v2[i], w[i]);
+        Interpolate<T>(r, v1, v2, w, n);
+        for (int i = 0; i < n; ++i)
+            memcpy(dst + sizeof(T) * (base + i), &r[i], sizeof(T));
+    }
+}
+template<> void EvaluateKeys<void>(AnimationCurve& /*self*/, const float * /*times*/, int /*num*/, void * /*dst*/, int& /*cursor*/) {}
+
+
 struct AnimationCurveFunctionSet
 {
     size_t(*size)(const AnimationCurve& self);
     void*(*at)(const AnimationCurve& self, int i);
     void(*reserve_keyframes)(AnimationCurve& self, size_t n);
-    void(*reduce_keyframes)(AnimationCurve& self, bool keep_flat_curve);
+    void(*remove_redundant_keyframes)(AnimationCurve& self, bool keep_flat_curves);
+    void(*reduce_keyframes)(AnimationCurve& self, const KeyframeReductionSettings& settings);
     void(*convert_handedness)(AnimationCurve& self, bool x, bool yz);
     void(*apply_scale)(AnimationCurve& self, float v);
+    void(*encode_keyframes)(AnimationCurve& self, const CurveEncodingSettings& settings);
+    void(*decode_keyframes)(AnimationCurve& self);
+    void(*evaluate_keys)(AnimationCurve& self, const float *times, int num, void *dst, int& cursor);
+    void(*stage_keys)(AnimationCurve& self, float time, int& cursor, float4& v1, float4& v2, float& w);
+    void(*interpolate)(float4 *dst, const float4 *v1, const float4 *v2, const float *w, size_t num);
+    size_t(*value_size)();
+    void(*get_times)(const AnimationCurve& self, RawVector<float>& dst);
+    void(*to_soa)(AnimationCurve& self, std::shared_ptr<RawVector<float>> times);
+    void(*from_soa)(AnimationCurve& self);
 };
 
 #define EachDataTypes(Body)\
     Body(void) Body(int) Body(float) Body(float2) Body(float3) Body(float4) Body(quatf)
 
-#define DefFunctionSet(T) {&GetSize<T>, &At<T>, &ReserveKeyframes<T>, &ReduceKeyframes<T>, &ConvertHandedness<T>, &ApplyScale<T>},
+#define DefFunctionSet(T) {&GetSize<T>, &At<T>, &ReserveKeyframes<T>, &RemoveRedundantKeyframes<T>, &ReduceKeyframes<T>, &ConvertHandedness<T>, &ApplyScale<T>,\
+    &EncodeKeyframes<T>, &DecodeKeyframes<T>, &EvaluateKeys<T>, &StageKeys<T>, &Interpolate<T>,\
+    &GetValueSize<T>, &GetTimes<T>, &ToSoA<T>, &FromSoA<T>},
 
 static AnimationCurveFunctionSet g_curve_fs[] = {
     EachDataTypes(DefFunctionSet)
@@ -150,16 +884,82 @@ std::shared_ptr<AnimationCurve> AnimationCurve::create(std::istream& is)
 AnimationCurve::AnimationCurve() {}
 AnimationCurve::~AnimationCurve() {}
 
-#define EachMember(F) F(name) F(data) F(data_type) F(data_flags)
+#define EachMember(F) F(name) F(data) F(data_type) F(data_flags) F(encoding)
 
 void AnimationCurve::serialize(std::ostream& os) const
 {
-    EachMember(msWrite);
+    serialize(os, -1);
 }
 
 void AnimationCurve::deserialize(std::istream& is)
+{
+    deserialize(is, nullptr, 0);
+}
+
+void AnimationCurve::serialize(std::ostream& os, int time_ref) const
+{
+    if (encoding != Encoding::SoA) {
+        EachMember(msWrite);
+        return;
+    }
+
+    // SoA curves write the header and times in front of values as a part of data.
+    // the layout of the other members is unchanged.
+    SoACurveHeader header;
+    header.num_keys = (uint32_t)size();
+    header.time_ref = time_ref;
+    size_t times_size = time_ref < 0 ? sizeof(float) * header.num_keys : 0;
+    auto data_size = (uint32_t)(sizeof(header) + times_size + data.size());
+
+    write(os, name);
+    write(os, data_size);
+    os.write((const char*)&header, sizeof(header));
+    if (times_size > 0)
+        os.write((const char*)times->data(), times_size);
+    os.write(data.data(), data.size());
+    write(os, data_type);
+    write(os, data_flags);
+    write(os, encoding);
+}
+
+void AnimationCurve::deserialize(std::istream& is, const std::shared_ptr<AnimationCurve> *siblings, int num_siblings)
 {
     EachMember(msRead);
+    times.reset();
+    if (encoding != Encoding::SoA)
+        return;
+
+    // separate the header and times from values. curves with broken data are cleared.
+    SoACurveHeader header;
+    size_t value_size = g_curve_fs[(int)data_type].value_size();
+    bool valid = data.size() >= sizeof(header);
+    if (valid) {
+        memcpy(&header, data.data(), sizeof(header));
+        size_t times_size = header.time_ref < 0 ? sizeof(float) * header.num_keys : 0;
+        size_t values_offset = sizeof(header) + times_size;
+        valid = data.size() == values_offset + value_size * header.num_keys;
+        if (valid && header.time_ref < 0) {
+            times = std::make_shared<RawVector<float>>();
+            times->resize_discard(header.num_keys);
+            memcpy(times->data(), data.data() + sizeof(header), times_size);
+        }
+        else if (valid) {
+            valid = header.time_ref < num_siblings;
+            if (valid) {
+                auto& sibling = siblings[header.time_ref];
+                valid = sibling && sibling->times && sibling->times->size() == header.num_keys;
+                if (valid)
+                    times = sibling->times;
+            }
+        }
+        if (valid)
+            data.erase(data.begin(), data.begin() + values_offset);
+    }
+    if (!valid) {
+        data.clear();
+        times.reset();
+        encoding = Encoding::Plain;
+    }
 }
 
 void AnimationCurve::clear()
@@ -168,12 +968,16 @@ void AnimationCurve::clear()
     data.clear();
     data_type = DataType::Unknown;
     data_flags = {};
+    encoding = Encoding::Plain;
+    times.reset();
 }
 
 uint64_t AnimationCurve::hash() const
 {
     uint64_t ret = 0;
     ret += vhash(data);
+    if (times)
+        ret += vhash(*times);
     return ret;
 }
 
@@ -183,22 +987,40 @@ uint64_t AnimationCurve::checksum() const
 {
     uint64_t ret = 0;
     EachMember(msCSum);
+    if (times)
+        ret += csum(*times);
     return ret;
 }
 
 size_t AnimationCurve::size() const
 {
+    if (encoding == Encoding::SoA) {
+        size_t value_size = g_curve_fs[(int)data_type].value_size();
+        if (!times || value_size == 0)
+            return 0;
+        return std::min(times->size(), data.size() / value_size);
+    }
+    if (encoding == Encoding::Compressed) {
+        EncodedCurveHeader header;
+        if (data.size() < sizeof(header))
+            return 0;
+        memcpy(&header, data.data(), sizeof(header));
+        return header.num_keys;
+    }
     return g_curve_fs[(int)data_type].size(*this);
 }
 
 bool AnimationCurve::empty() const
 {
+    if (encoding != Encoding::Plain)
+        return size() == 0;
     return data.empty();
 }
 
 template<class T>
 TVP<T>& AnimationCurve::at(int i)
 {
+    decode();
     return *(TVP<T>*)g_curve_fs[(int)data_type].at(*this, i);
 }
 #define Instantiate(T) template TVP<T>& AnimationCurve::at(int i);
@@ -208,21 +1030,78 @@ EachDataTypes(Instantiate)
 
 void AnimationCurve::reserve(size_t n)
 {
+    decode();
     g_curve_fs[(int)data_type].reserve_keyframes(*this, n);
 }
 void AnimationCurve::reduction(bool keep_flat_curves)
 {
-    g_curve_fs[(int)data_type].reduce_keyframes(*this, keep_flat_curves);
+    decode();
+    g_curve_fs[(int)data_type].remove_redundant_keyframes(*this, keep_flat_curves);
+}
+void AnimationCurve::reduction(const KeyframeReductionSettings& settings)
+{
+    decode();
+    g_curve_fs[(int)data_type].reduce_keyframes(*this, settings);
 }
 
 void AnimationCurve::convertHandedness(bool x, bool yz)
 {
+    decode();
     g_curve_fs[(int)data_type].convert_handedness(*this, x, yz);
 }
 void AnimationCurve::applyScaleFactor(float scale)
 {
+    decode();
     g_curve_fs[(int)data_type].apply_scale(*this, scale);
 }
+
+void AnimationCurve::encode(const CurveEncodingSettings& settings)
+{
+    if (!settings.enabled) {
+        if (settings.share_times)
+            toSoA();
+        return;
+    }
+    if (encoding == Encoding::SoA)
+        decode();
+    if (encoding != Encoding::Plain)
+        return;
+    g_curve_fs[(int)data_type].encode_keyframes(*this, settings);
+}
+void AnimationCurve::decode()
+{
+    if (encoding == Encoding::SoA)
+        g_curve_fs[(int)data_type].from_soa(*this);
+    else if (encoding == Encoding::Compressed)
+        g_curve_fs[(int)data_type].decode_keyframes(*this);
+}
+void AnimationCurve::toSoA(std::shared_ptr<RawVector<float>> shared_times)
+{
+    if (encoding != Encoding::Plain)
+        return;
+    g_curve_fs[(int)data_type].to_soa(*this, shared_times);
+}
+
+bool AnimationCurve::evaluate(float time, void *dst, int *cursor)
+{
+    if (encoding == Encoding::Compressed)
+        decode();
+    if (size() == 0)
+        return false;
+    int tmp = 0;
+    g_curve_fs[(int)data_type].evaluate_keys(*this, &time, 1, dst, cursor ? *cursor : tmp);
+    return true;
+}
+bool AnimationCurve::evaluate(const float *times, int num, void *dst)
+{
+    if (encoding == Encoding::Compressed)
+        decode();
+    if (size() == 0)
+        return false;
+    int cursor = 0;
+    g_curve_fs[(int)data_type].evaluate_keys(*this, times, num, dst, cursor);
+    return true;
+}
 #undef EachMember
 
 
@@ -237,18 +1116,54 @@ std::shared_ptr<Animation> Animation::create(std::istream & is)
 Animation::Animation() {}
 Animation::~Animation() {}
 
+std::shared_ptr<Animation> Animation::clone() const
+{
+    auto ret = create();
+    ret->entity_type = entity_type;
+    ret->path = path;
+    ret->curves.resize(curves.size());
+    for (size_t i = 0; i < curves.size(); ++i) {
+        ret->curves[i] = AnimationCurve::create();
+        *ret->curves[i] = *curves[i];
+    }
+    return ret;
+}
+
 void Animation::serialize(std::ostream & os) const
 {
     write(os, entity_type);
     write(os, path);
-    write(os, curves);
+
+    // same layout as write(os, curves). times shared by SoA curves are written by the first one only.
+    std::map<const RawVector<float>*, int> time_refs;
+    auto num_curves = (uint32_t)curves.size();
+    write(os, num_curves);
+    for (uint32_t i = 0; i < num_curves; ++i) {
+        auto& curve = curves[i];
+        int time_ref = -1;
+        if (curve->encoding == AnimationCurve::Encoding::SoA && curve->times) {
+            auto it = time_refs.find(curve->times.get());
+            if (it != time_refs.end())
+                time_ref = it->second;
+            else
+                time_refs[curve->times.get()] = (int)i;
+        }
+        curve->serialize(os, time_ref);
+    }
 }
 
 void Animation::deserialize(std::istream & is)
 {
     read(is, entity_type);
     read(is, path);
-    read(is, curves);
+
+    uint32_t num_curves = 0;
+    read(is, num_curves);
+    curves.resize(num_curves);
+    for (uint32_t i = 0; i < num_curves; ++i) {
+        curves[i] = AnimationCurve::create();
+        curves[i]->deserialize(is, curves.data(), (int)i);
+    }
 }
 
 void Animation::clear()
@@ -276,14 +1191,26 @@ bool Animation::empty() const
 {
     return curves.empty();
 }
-void Animation::reduction(bool keep_flat_curves)
+static void EraseEmptyCurves(Animation& anim)
 {
-    for (auto& c : curves)
-        c->reduction(keep_flat_curves);
+    auto& curves = anim.curves;
     curves.erase(
         std::remove_if(curves.begin(), curves.end(), [](ms::AnimationCurvePtr& p) { return p->empty(); }),
         curves.end());
 }
+
+void Animation::reduction(bool keep_flat_curves)
+{
+    for (auto& c : curves)
+        c->reduction(keep_flat_curves);
+    EraseEmptyCurves(*this);
+}
+void Animation::reduction(const KeyframeReductionSettings& settings)
+{
+    for (auto& c : curves)
+        c->reduction(settings);
+    EraseEmptyCurves(*this);
+}
 void Animation::reserve(size_t n)
 {
     for (auto& c : curves)
@@ -303,6 +1230,48 @@ void Animation::applyScaleFactor(float scale)
     for (auto& c : curves)
         c->applyScaleFactor(scale);
 }
+void Animation::encode(const CurveEncodingSettings& settings)
+{
+    if (!settings.enabled) {
+        if (settings.share_times)
+            toSoA();
+        return;
+    }
+    for (auto& c : curves)
+        c->encode(settings);
+}
+void Animation::decode()
+{
+    for (auto& c : curves)
+        c->decode();
+}
+void Animation::toSoA()
+{
+    // curves of sampled clips usually have exactly the same times. they are found by hash and compared.
+    std::map<uint64_t, std::vector<std::shared_ptr<RawVector<float>>>> shared;
+    RawVector<float> times;
+    for (auto& c : curves) {
+        if (c->encoding != AnimationCurve::Encoding::Plain)
+            continue;
+        g_curve_fs[(int)c->data_type].get_times(*c, times);
+        if (times.empty())
+            continue;
+
+        auto& candidates = shared[csum(times) + times.size()];
+        std::shared_ptr<RawVector<float>> found;
+        for (auto& t : candidates) {
+            if (t->size() == times.size() && memcmp(t->data(), times.data(), sizeof(float) * times.size()) == 0) {
+                found = t;
+                break;
+            }
+        }
+        if (!found) {
+            found = std::make_shared<RawVector<float>>(times);
+            candidates.push_back(found);
+        }
+        c->toSoA(found);
+    }
+}
 
 bool Animation::isRoot() const
 {
@@ -379,6 +1348,15 @@ std::shared_ptr<AnimationClip> AnimationClip::create(std::istream& is)
 AnimationClip::AnimationClip() {}
 AnimationClip::~AnimationClip() {}
 
+std::shared_ptr<AnimationClip> AnimationClip::clone() const
+{
+    auto ret = create();
+    *ret = *this;
+    for (auto& anim : ret->animations)
+        anim = anim->clone();
+    return ret;
+}
+
 AssetType AnimationClip::getAssetType() const
 {
     return AssetType::Animation;
@@ -424,16 +1402,40 @@ bool AnimationClip::empty() const
     return animations.empty();
 }
 
-void AnimationClip::reduction(bool keep_flat_curves)
+// parallelize over curves rather than animations. the number of curves per animation varies a lot.
+template<class Body>
+static void EachCurveParallel(std::vector<AnimationPtr>& animations, const Body& body)
 {
-    mu::parallel_for_each(animations.begin(), animations.end(), [keep_flat_curves](ms::AnimationPtr& p) {
-        p->reduction(keep_flat_curves);
+    std::vector<AnimationCurve*> curves;
+    for (auto& anim : animations) {
+        for (auto& c : anim->curves)
+            curves.push_back(c.get());
+    }
+    mu::parallel_for(0, (int)curves.size(), [&body, &curves](int i) {
+        body(*curves[i]);
     });
+}
+
+static void EraseEmptyAnimations(std::vector<AnimationPtr>& animations)
+{
+    for (auto& anim : animations)
+        EraseEmptyCurves(*anim);
     animations.erase(
         std::remove_if(animations.begin(), animations.end(), [](ms::AnimationPtr& p) { return p->empty(); }),
         animations.end());
 }
 
+void AnimationClip::reduction(bool keep_flat_curves)
+{
+    EachCurveParallel(animations, [keep_flat_curves](AnimationCurve& c) { c.reduction(keep_flat_curves); });
+    EraseEmptyAnimations(animations);
+}
+void AnimationClip::reduction(const KeyframeReductionSettings& settings)
+{
+    EachCurveParallel(animations, [&settings](AnimationCurve& c) { c.reduction(settings); });
+    EraseEmptyAnimations(animations);
+}
+
 void AnimationClip::convertHandedness(bool x, bool yz)
 {
     for (auto& animation : animations)
@@ -446,6 +1448,27 @@ void AnimationClip::applyScaleFactor(float scale)
         animation->applyScaleFactor(scale);
 }
 
+void AnimationClip::encode(const CurveEncodingSettings& settings)
+{
+    if (!settings.enabled) {
+        if (settings.share_times)
+            toSoA();
+        return;
+    }
+    EachCurveParallel(animations, [&settings](AnimationCurve& c) { c.encode(settings); });
+}
+void AnimationClip::decode()
+{
+    EachCurveParallel(animations, [](AnimationCurve& c) { c.decode(); });
+}
+void AnimationClip::toSoA()
+{
+    // times are shared within animations, so animations are the unit of work
+    mu::parallel_for(0, (int)animations.size(), [this](int i) {
+        animations[i]->toSoA();
+    });
+}
+
 void AnimationClip::addAnimation(AnimationPtr v)
 {
     if (v)
@@ -566,4 +1589,79 @@ PointsAnimation::PointsAnimation(AnimationPtr host)
 }
 
 
+
+int CurveEvaluator::addCurve(AnimationCurvePtr curve)
+{
+    if (curve->encoding == AnimationCurve::Encoding::Compressed)
+        curve->decode();
+    int type = (int)curve->data_type;
+    auto& group = m_groups[type];
+    Channel ch;
+    ch.curve = curve;
+    group.channels.push_back(ch);
+    m_index.push_back({ type, (int)group.channels.size() - 1 });
+    return (int)m_index.size() - 1;
+}
+
+void CurveEvaluator::addAnimation(Animation& anim)
+{
+    for (auto& curve : anim.curves)
+        addCurve(curve);
+}
+
+void CurveEvaluator::addClip(AnimationClip& clip)
+{
+    for (auto& anim : clip.animations)
+        addAnimation(*anim);
+}
+
+void CurveEvaluator::clear()
+{
+    for (auto& group : m_groups) {
+        group.channels.clear();
+        group.values.clear();
+    }
+    m_index.clear();
+}
+
+int CurveEvaluator::getCurveCount() const
+{
+    return (int)m_index.size();
+}
+
+void CurveEvaluator::evaluate(float time)
+{
+    // keys of a block of channels are staged and then interpolated by one kernel call
+    const int block_size = 1024;
+    for (int type = 0; type < kNumDataTypes; ++type) {
+        auto& group = m_groups[type];
+        int n = (int)group.channels.size();
+        if (n == 0)
+            continue;
+
+        auto& fs = g_curve_fs[type];
+        m_v1.resize_discard(n);
+        m_v2.resize_discard(n);
+        m_weights.resize_discard(n);
+        group.values.resize_discard(sizeof(float4) * n);
+        auto *dst = (float4*)group.values.data();
+        mu::parallel_for_blocked(0, n, block_size, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                auto& ch = group.channels[i];
+                fs.stage_keys(*ch.curve, time, ch.cursor, m_v1[i], m_v2[i], m_weights[i]);
+            }
+            fs.interpolate(dst + begin, m_v1.data() + begin, m_v2.data() + begin, m_weights.data() + begin, end - begin);
+        });
+    }
+}
+
+const void* CurveEvaluator::getValueData(int i) const
+{
+    auto& idx = m_index[i];
+    auto& values = m_groups[idx.first].values;
+    if (values.empty())
+        return nullptr;
+    return values.data() + sizeof(float4) * idx.second;
+}
+
 } // namespace ms
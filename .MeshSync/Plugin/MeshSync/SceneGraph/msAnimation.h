@@ -14,6 +14,48 @@ struct TVP
     T value;
 };
 
+// keys that can be reconstructed from their neighbors within the tolerance are removed.
+// the first and last keys are always kept. a curve whose keys all have the same value is cleared, or reduced to
+// 2 keys if keep_flat_curves is true (Unity warns about curves with a single key).
+struct KeyframeReductionSettings
+{
+    // how the receiver interpolates keys.
+    // Smooth: Hermite with clamped auto tangents, which is what Unity uses for InterpolationMode.Smooth.
+    enum class Interpolation
+    {
+        Linear,
+        Smooth,
+    };
+
+    Interpolation interpolation = Interpolation::Smooth;
+    // max error of each component. int curves are stepped and ignore this: only keys equal to the previous key are removed.
+    float tolerance = 0.0f;
+    // max error of quaternion curves in radians (angle between the original and reconstructed rotations)
+    float rotation_tolerance = 0.0f;
+    bool keep_flat_curves = false;
+};
+
+// compressed encoding of curves for transfer and scene caches. see AnimationCurve::encode().
+struct CurveEncodingSettings
+{
+    enum class VectorEncoding
+    {
+        Float,
+        Half,
+        Quantize16, // 16 bit per component in the range of each component of the curve
+    };
+
+    bool enabled = false;
+    // quaternion curves are stored as quat32 (4 bytes per key). the error is around 0.1 degrees.
+    bool quat32_rotations = true;
+    // encoding of float - float4 curves (translations, scales, etc.)
+    VectorEncoding vector_encoding = VectorEncoding::Quantize16;
+    // if keys are evenly spaced, times are stored as the start time and the interval
+    bool uniform_time = true;
+    // if enabled is false, curves are converted to SoA instead (lossless). see Animation::toSoA().
+    bool share_times = false;
+};
+
 // this class holds untyped raw animation samples.
 // TAnimationCurve<> handle typed data operations.
 class AnimationCurve
@@ -37,6 +79,14 @@ public:
         uint32_t ignore_negate : 1; // for scale values
     };
 
+    // format of data. keys of Compressed and SoA curves can't be accessed until decode() is called.
+    enum class Encoding
+    {
+        Plain,      // array of TVP<T>
+        Compressed, // encoded by encode()
+        SoA,        // array of T. times are in times, which can be shared with other curves. made by toSoA()
+    };
+
 protected:
     AnimationCurve();
     virtual ~AnimationCurve();
@@ -46,6 +96,10 @@ public:
 
     void serialize(std::ostream& os) const;
     void deserialize(std::istream& is);
+    // for Animation. time_ref is the index of a preceding curve in siblings that has the same times, or -1.
+    // SoA curves with time_ref write the reference instead of their times.
+    void serialize(std::ostream& os, int time_ref) const;
+    void deserialize(std::istream& is, const std::shared_ptr<AnimationCurve> *siblings, int num_siblings);
     void clear();
     uint64_t hash() const;
     uint64_t checksum() const;
@@ -54,17 +108,40 @@ public:
     bool empty() const;
     template<class T> TVP<T>& at(int i);
 
+    // removes only keys that are equal to both of their neighbors (or to the previous key for int curves), which is
+    // safe regardless of how the receiver interpolates. use reduction(settings) for the tolerance based reduction.
     void reduction(bool keep_flat_curves);
+    void reduction(const KeyframeReductionSettings& settings);
     void reserve(size_t n);
 
     void convertHandedness(bool x, bool yz);
     void applyScaleFactor(float scale);
 
+    // Plain -> Compressed, or Plain -> SoA if settings.share_times is true and settings.enabled is false.
+    // does nothing if already encoded.
+    void encode(const CurveEncodingSettings& settings);
+    // Compressed / SoA -> Plain. at(), reserve(), reduction(), convertHandedness() and applyScaleFactor() decode
+    // implicitly. evaluate() decodes Compressed curves and reads SoA curves as they are.
+    void decode();
+    // Plain -> SoA. if shared_times is not null, it is used instead of making a new array. it must be the same as
+    // the times of keys.
+    void toSoA(std::shared_ptr<RawVector<float>> shared_times = nullptr);
+
+    // value at time. keys are linearly interpolated (quaternions are slerped) and int curves are stepped.
+    // time out of the range of keys is clamped. dst must be a value of data_type (e.g. float3 for Float3).
+    // cursor (can be null) is the key found by the previous call. the search starts from it, so sequential playback
+    // finds keys in O(1) instead of binary search. returns false if the curve has no keys.
+    bool evaluate(float time, void *dst, int *cursor = nullptr);
+    // values at many times in one call. ascending times are the fastest.
+    bool evaluate(const float *times, int num, void *dst);
+
 
     std::string name;
     RawVector<char> data;
     DataType data_type = DataType::Unknown;
     DataFlags data_flags = {};
+    Encoding encoding = Encoding::Plain;
+    std::shared_ptr<RawVector<float>> times; // SoA only
 };
 msSerializable(AnimationCurve);
 msDeclPtr(AnimationCurve);
@@ -86,17 +163,26 @@ protected:
 public:
     msDefinePool(Animation);
     static std::shared_ptr<Animation> create(std::istream& is);
+    // curves are copied. times of SoA curves are never modified in place and stay shared.
+    std::shared_ptr<Animation> clone() const;
     void serialize(std::ostream& os) const;
     void deserialize(std::istream& is);
     void clear();
     uint64_t hash() const;
     uint64_t checksum() const;
     bool empty() const;
+    // curves that become empty are erased
     void reduction(bool keep_flat_curves);
+    void reduction(const KeyframeReductionSettings& settings);
     void reserve(size_t n);
 
     void convertHandedness(bool x, bool yz);
     void applyScaleFactor(float scale);
+    void encode(const CurveEncodingSettings& settings);
+    void decode();
+    // Plain curves are converted to SoA. curves that have the same times share one time array, which is also
+    // serialized only once.
+    void toSoA();
 
     bool isRoot() const;
     AnimationCurvePtr findCurve(const char *name);
@@ -145,6 +231,13 @@ struct TAnimationCurve
     key_t& front() { return data()[0]; }
     key_t& back() { return data()[size() - 1]; }
 
+    T evaluate(float time, int *cursor = nullptr) const
+    {
+        T ret{};
+        curve->evaluate(time, &ret, cursor);
+        return ret;
+    }
+
     AnimationCurve *curve;
 };
 
@@ -276,6 +369,8 @@ protected:
 public:
     msDefinePool(AnimationClip);
     static std::shared_ptr<AnimationClip> create(std::istream& is);
+    // animations and their curves are copied
+    std::shared_ptr<AnimationClip> clone() const;
 
     AssetType getAssetType() const override;
     void serialize(std::ostream& os) const override;
@@ -285,9 +380,16 @@ public:
     uint64_t checksum() const override;
 
     bool empty() const;
+    // curves of all animations are reduced in parallel. curves and animations that become empty are erased.
     void reduction(bool keep_flat_curves = false);
+    void reduction(const KeyframeReductionSettings& settings);
     void convertHandedness(bool x, bool yz);
     void applyScaleFactor(float scale);
+    // curves of all animations are encoded / decoded in parallel
+    void encode(const CurveEncodingSettings& settings);
+    void decode();
+    // animations are converted in parallel. see Animation::toSoA().
+    void toSoA();
 
     void addAnimation(AnimationPtr v);
     void addAnimation(TransformAnimationPtr v);
@@ -295,4 +397,45 @@ public:
 msSerializable(AnimationClip);
 msDeclPtr(AnimationClip);
 
+
+// evaluates many curves at one time in one call. curves are grouped by data type and values of each group are
+// interpolated in batches by mu::LerpWeighted() and mu::Slerp(). each curve keeps its cursor between calls, so
+// sequential playback doesn't search keys.
+// curves are shared, not copied. they must not be modified while the evaluator is used.
+class CurveEvaluator
+{
+public:
+    // returns the index of the curve in the evaluator. compressed curves are decoded. SoA curves are kept.
+    int addCurve(AnimationCurvePtr curve);
+    // adds all curves. the indices are consecutive in the order of curves.
+    void addAnimation(Animation& anim);
+    void addClip(AnimationClip& clip);
+    void clear();
+    int getCurveCount() const;
+
+    void evaluate(float time);
+
+    // value of i-th curve at the last evaluate(). T must be the type of the curve (e.g. float3 for Float3).
+    template<class T> const T& getValue(int i) const { return *(const T*)getValueData(i); }
+    const void* getValueData(int i) const;
+
+private:
+    static const int kNumDataTypes = (int)AnimationCurve::DataType::Quaternion + 1;
+
+    struct Channel
+    {
+        AnimationCurvePtr curve;
+        int cursor = 0;
+    };
+    struct Group
+    {
+        std::vector<Channel> channels;
+        RawVector<char> values;
+    };
+    Group m_groups[kNumDataTypes];
+    std::vector<std::pair<int, int>> m_index; // curve index -> (data type, index in the group)
+    RawVector<float4> m_v1, m_v2; // work buffers
+    RawVector<float> m_weights;
+};
+
 } // namespace ms
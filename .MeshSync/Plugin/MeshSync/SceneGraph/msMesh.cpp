@@ -18,6 +18,9 @@ uint64_t MeshRefineSettings::checksum() const
     ret += csum(local2world);
     ret += csum(world2local);
     ret += csum(mirror_basis);
+    ret += csum(lod_count);
+    ret += csum(lod_ratio);
+    ret += csum((int&)vertex_format);
     return ret;
 }
 
@@ -32,7 +35,7 @@ BlendShapeFrameData::BlendShapeFrameData() {}
 BlendShapeFrameData::~BlendShapeFrameData() {}
 
 #define EachMember(F)\
-    F(weight) F(points) F(normals) F(tangents)
+    F(weight) F(points) F(normals) F(tangents) F(sparse_indices) F(sparse_points) F(sparse_normals) F(sparse_tangents)
 
 void BlendShapeFrameData::serialize(std::ostream& os) const
 {
@@ -48,22 +51,68 @@ void BlendShapeFrameData::clear()
     points.clear();
     normals.clear();
     tangents.clear();
+    sparse_indices.clear();
+    sparse_points.clear();
+    sparse_normals.clear();
+    sparse_tangents.clear();
+    num_vertices = 0;
 }
 
 #undef EachMember
 
+bool BlendShapeFrameData::isSparse() const
+{
+    return !sparse_indices.empty();
+}
+
+// convert per-vertex dense deltas to sparse deltas. zero deltas are dropped.
+// returns false if dense data is not convertible (empty, or not num_vertices long e.g. per-index normals or tangents).
+bool BlendShapeFrameData::sparsify(size_t num_vertices)
+{
+    size_t n = num_vertices;
+    auto convertible = [n](const RawVector<float3>& a) { return a.empty() || a.size() == n; };
+    if (n == 0 || (points.empty() && normals.empty() && tangents.empty()) ||
+        !convertible(points) || !convertible(normals) || !convertible(tangents))
+        return false;
+
+    auto is_zero = [](const RawVector<float3>& a, size_t i) { return a.empty() || a[i] == float3::zero(); };
+    sparse_indices.clear();
+    sparse_points.clear();
+    sparse_normals.clear();
+    sparse_tangents.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (is_zero(points, i) && is_zero(normals, i) && is_zero(tangents, i))
+            continue;
+        sparse_indices.push_back((int)i);
+        if (!points.empty())
+            sparse_points.push_back(points[i]);
+        if (!normals.empty())
+            sparse_normals.push_back(normals[i]);
+        if (!tangents.empty())
+            sparse_tangents.push_back(tangents[i]);
+    }
+    points.clear();
+    normals.clear();
+    tangents.clear();
+    return true;
+}
+
 void BlendShapeFrameData::convertHandedness(bool x, bool /*yz*/)
 {
     if (x) {
         for (auto& v : points) { v = flip_x(v); }
         for (auto& v : normals) { v = flip_x(v); }
         for (auto& v : tangents) { v = flip_x(v); }
+        for (auto& v : sparse_points) { v = flip_x(v); }
+        for (auto& v : sparse_normals) { v = flip_x(v); }
+        for (auto& v : sparse_tangents) { v = flip_x(v); }
     }
 }
 
 void BlendShapeFrameData::applyScaleFactor(float scale)
 {
     mu::Scale(points.data(), scale, points.size());
+    mu::Scale(sparse_points.data(), scale, sparse_points.size());
 }
 
 
@@ -179,6 +228,8 @@ void Mesh::serialize(std::ostream& os) const
 #undef Body
     write(os, root_bone);
     write(os, bones);
+    write(os, bone_influence_counts);
+    write(os, bone_influences);
     write(os, blendshapes);
 }
 
@@ -194,6 +245,8 @@ void Mesh::deserialize(std::istream& is)
 #undef Body
     read(is, root_bone);
     read(is, bones);
+    read(is, bone_influence_counts);
+    read(is, bone_influences);
     read(is, blendshapes);
 
     bones.erase(
@@ -214,6 +267,8 @@ void Mesh::clear()
 
     root_bone.clear();
     bones.clear();
+    vclear(bone_influence_counts);
+    vclear(bone_influences);
     blendshapes.clear();
 
     vclear(weights4);
@@ -222,6 +277,13 @@ void Mesh::clear()
     vclear(weights1);
     submeshes.clear();
     splits.clear();
+    vclear(lod_indices);
+    lod_submeshes.clear();
+    vclear(indices16);
+    vclear(vertices_interleaved);
+    vertex_format = VertexFormat::Unknown;
+    refine_peak_memory = 0;
+    refine_vertex_cache_before = refine_vertex_cache_after = VertexCacheStatistics();
 }
 
 uint64_t Mesh::hash() const
@@ -233,6 +295,8 @@ uint64_t Mesh::hash() const
     if (flags.has_bones) {
         for(auto& b : bones)
             ret += vhash(b->weights);
+        ret += vhash(bone_influence_counts);
+        ret += vhash(bone_influences);
     }
     if (flags.has_blendshape_weights) {
         for (auto& bs : blendshapes) {
@@ -240,6 +304,10 @@ uint64_t Mesh::hash() const
                 ret += vhash(b->points);
                 ret += vhash(b->normals);
                 ret += vhash(b->tangents);
+                ret += vhash(b->sparse_indices);
+                ret += vhash(b->sparse_points);
+                ret += vhash(b->sparse_normals);
+                ret += vhash(b->sparse_tangents);
             }
         }
     }
@@ -260,6 +328,8 @@ uint64_t Mesh::checksumGeom() const
             ret += csum(b->bindpose);
             ret += csum(b->weights);
         }
+        ret += csum(bone_influence_counts);
+        ret += csum(bone_influences);
     }
     if (flags.has_blendshape_weights) {
         for (auto& bs : blendshapes) {
@@ -270,12 +340,53 @@ uint64_t Mesh::checksumGeom() const
                 ret += csum(b->points);
                 ret += csum(b->normals);
                 ret += csum(b->tangents);
+                ret += csum(b->sparse_indices);
+                ret += csum(b->sparse_points);
+                ret += csum(b->sparse_normals);
+                ret += csum(b->sparse_tangents);
             }
         }
     }
     return ret;
 }
 
+template<class T>
+static inline size_t MemorySize(const RawVector<T>& v)
+{
+    return sizeof(T) * v.capacity();
+}
+
+// memory held by vertex data of the mesh in byte
+static size_t GetMemoryUsage(const Mesh& mesh)
+{
+    size_t ret = 0;
+#define Body(A) ret += MemorySize(mesh.A);
+    EachVertexProperty(Body);
+#undef Body
+    for (auto& b : mesh.bones)
+        ret += MemorySize(b->weights);
+    ret += MemorySize(mesh.bone_influence_counts);
+    ret += MemorySize(mesh.bone_influences);
+    for (auto& bs : mesh.blendshapes) {
+        for (auto& f : bs->frames) {
+            ret += MemorySize(f->points);
+            ret += MemorySize(f->normals);
+            ret += MemorySize(f->tangents);
+            ret += MemorySize(f->sparse_indices);
+            ret += MemorySize(f->sparse_points);
+            ret += MemorySize(f->sparse_normals);
+            ret += MemorySize(f->sparse_tangents);
+        }
+    }
+    ret += MemorySize(mesh.weights4);
+    ret += MemorySize(mesh.bone_counts);
+    ret += MemorySize(mesh.bone_offsets);
+    ret += MemorySize(mesh.weights1);
+    ret += MemorySize(mesh.lod_indices);
+    ret += MemorySize(mesh.indices16);
+    return ret;
+}
+
 #undef EachVertexProperty
 
 static inline float4 lerp_tangent(float4 a, float4 b, float w)
@@ -355,11 +466,20 @@ void Mesh::applyScaleFactor(float v)
 {
     super::applyScaleFactor(v);
     mu::Scale(points.data(), v, points.size());
-    for (auto& bone : bones)
-        bone->applyScaleFactor(v);
+    mu::Scale(velocities.data(), v, velocities.size());
+    applyScaleFactor_BlendShapes(v);
+    applyScaleFactor_Bones(v);
+}
+void Mesh::applyScaleFactor_BlendShapes(float v)
+{
     for (auto& bs : blendshapes)
         bs->applyScaleFactor(v);
 }
+void Mesh::applyScaleFactor_Bones(float v)
+{
+    for (auto& bone : bones)
+        bone->applyScaleFactor(v);
+}
 
 template<class T>
 static inline void Remap(RawVector<T>& dst, const RawVector<T>& src, const RawVector<int>& indices)
@@ -373,6 +493,59 @@ static inline void Remap(RawVector<T>& dst, const RawVector<T>& src, const RawVe
     }
 }
 
+// rough ratio of the peak memory of refine() to the size of the source data.
+// old and new vertex data and refiner intermediates are alive at the same time.
+static const size_t RefineMemoryFactor = 4;
+
+// build CSR table of new vertices that each old point was split into
+static void BuildOld2NewPoints(RawVector<int>& offsets, RawVector<int>& dst, const RawVector<int>& new2old, size_t num_points_old)
+{
+    offsets.resize_zeroclear(num_points_old + 1);
+    for (int pi : new2old)
+        ++offsets[pi + 1];
+    for (size_t pi = 0; pi < num_points_old; ++pi)
+        offsets[pi + 1] += offsets[pi];
+
+    RawVector<int> pos;
+    pos.assign(offsets.begin(), offsets.end() - 1);
+    dst.resize_discard(new2old.size());
+    int num_points_new = (int)new2old.size();
+    for (int vi = 0; vi < num_points_new; ++vi)
+        dst[pos[new2old[vi]]++] = vi;
+}
+
+// remap sparse deltas to refined vertices. only affected vertices are touched.
+static void RemapSparseDeltas(BlendShapeFrameData& f, const RawVector<int>& o2n_offsets, const RawVector<int>& o2n_indices)
+{
+    int num_points_old = (int)o2n_offsets.size() - 1;
+    size_t n = f.sparse_indices.size();
+    bool has_points = f.sparse_points.size() == n;
+    bool has_normals = f.sparse_normals.size() == n;
+    bool has_tangents = f.sparse_tangents.size() == n;
+
+    RawVector<int> indices;
+    RawVector<float3> points, normals, tangents;
+    indices.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        int pi = f.sparse_indices[i];
+        if (pi < 0 || pi >= num_points_old)
+            continue;
+        for (int oi = o2n_offsets[pi]; oi < o2n_offsets[pi + 1]; ++oi) {
+            indices.push_back(o2n_indices[oi]);
+            if (has_points)
+                points.push_back(f.sparse_points[i]);
+            if (has_normals)
+                normals.push_back(f.sparse_normals[i]);
+            if (has_tangents)
+                tangents.push_back(f.sparse_tangents[i]);
+        }
+    }
+    f.sparse_indices.swap(indices);
+    f.sparse_points.swap(points);
+    f.sparse_normals.swap(normals);
+    f.sparse_tangents.swap(tangents);
+}
+
 void Mesh::refine(const MeshRefineSettings& mrs)
 {
     if (mrs.flags.flip_u)
@@ -380,11 +553,18 @@ void Mesh::refine(const MeshRefineSettings& mrs)
     if (mrs.flags.flip_v)
         mu::InvertV(uv0.data(), uv0.size());
 
+    // transform, scale and handedness conversion are composed into one matrix and
+    // vertex attributes are transformed in one pass. mirroring splits it into two.
+    float4x4 vertex_transform = float4x4::identity();
     if (mrs.flags.apply_local2world)
-        applyTransform(mrs.local2world);
+        vertex_transform = mrs.local2world;
     if (mrs.flags.apply_world2local)
-        applyTransform(mrs.world2local);
+        vertex_transform *= mrs.world2local;
 
+    if (mrs.flags.mirror_x || mrs.flags.mirror_y || mrs.flags.mirror_z) {
+        applyTransform(vertex_transform);
+        vertex_transform = float4x4::identity();
+    }
     if (mrs.flags.mirror_x)
         applyMirror({ 1.0f, 0.0f, 0.0f }, 0.0f, true);
     if (mrs.flags.mirror_y)
@@ -392,83 +572,157 @@ void Mesh::refine(const MeshRefineSettings& mrs)
     if (mrs.flags.mirror_z)
         applyMirror({ 0.0f, 0.0f, 1.0f }, 0.0f, true);
 
-    if (mrs.scale_factor != 1.0f)
-        applyScaleFactor(mrs.scale_factor);
-    if (mrs.flags.flip_x || mrs.flags.flip_yz)
-        convertHandedness(mrs.flags.flip_x, mrs.flags.flip_yz);
+    if (mrs.scale_factor != 1.0f) {
+        super::applyScaleFactor(mrs.scale_factor);
+        applyScaleFactor_BlendShapes(mrs.scale_factor);
+        applyScaleFactor_Bones(mrs.scale_factor);
+        vertex_transform *= scale44(float3{ mrs.scale_factor, mrs.scale_factor, mrs.scale_factor });
+    }
+    if (mrs.flags.flip_x || mrs.flags.flip_yz) {
+        // the transform, blendshapes and bones are converted here and vertices are flipped by vertex_transform.
+        // flip_yz only changes the transform of root objects (see Transform::convertHandedness()), and vertices are
+        // left as they are, same as convertHandedness_Mesh().
+        super::convertHandedness(mrs.flags.flip_x, mrs.flags.flip_yz);
+        convertHandedness_BlendShapes(mrs.flags.flip_x, mrs.flags.flip_yz);
+        convertHandedness_Bones(mrs.flags.flip_x, mrs.flags.flip_yz);
+        if (mrs.flags.flip_x)
+            vertex_transform *= scale44(float3{ -1.0f, 1.0f, 1.0f });
+    }
+    applyTransform(vertex_transform);
 
-    if (!bones.empty()) {
+    if (!bones.empty() && (mrs.max_bone_influence == 4 || mrs.max_bone_influence == -1)) {
         if (mrs.max_bone_influence == 4)
             setupBoneWeights4();
-        else if (mrs.max_bone_influence == -1)
+        else
             setupBoneWeightsVariable();
+        // sparse influences are consumed. they are in the order of points before refine and must not be kept.
+        vclear(bone_influence_counts);
+        vclear(bone_influences);
     }
 
+    // index offsets of polygons. shared by normal generation and the refiner
+    RawVector<int> offsets;
+    auto update_offsets = [&]() {
+        offsets.resize_discard(counts.size());
+        ExclusiveScan(offsets.data(), counts.data(), (int)counts.size());
+    };
+    update_offsets();
+
     // normals
     bool flip_normals = mrs.flags.flip_normals ^ mrs.flags.flip_faces;
     if (mrs.flags.gen_normals || (mrs.flags.gen_normals_with_smooth_angle && mrs.smooth_angle >= 180.0f)) {
-        GenerateNormalsPoly(normals, points, counts, indices, flip_normals);
+        GenerateNormalsPoly(normals, points, counts, offsets, indices, flip_normals);
     }
     else if (mrs.flags.gen_normals_with_smooth_angle) {
-        GenerateNormalsWithSmoothAngle(normals, points, counts, indices, mrs.smooth_angle, flip_normals);
+        GenerateNormalsWithSmoothAngle(normals, points, counts, offsets, indices, mrs.smooth_angle, flip_normals);
     }
 
     // generate back faces
     // this must be after generating normals.
-    if (mrs.flags.make_double_sided)
+    if (mrs.flags.make_double_sided) {
         makeDoubleSided();
+        update_offsets();
+    }
 
     size_t num_indices_old = indices.size();
     size_t num_points_old = points.size();
 
+    // low memory mode: used when the peak of the refine is estimated to exceed low_memory_threshold.
+    // attribute values are gathered one by one and sources and intermediates are released as soon as they are remapped.
+    size_t low_memory_threshold = (size_t)mrs.low_memory_threshold * 1024 * 1024;
+    bool low_memory = low_memory_threshold > 0 && GetMemoryUsage(*this) * RefineMemoryFactor > low_memory_threshold;
+
     RawVector<float3> tmp_normals;
     RawVector<float2> tmp_uv0, tmp_uv1;
     RawVector<float4> tmp_colors;
-    RawVector<int> remap_normals, remap_uv0, remap_uv1, remap_colors;
+    RawVector<int> remap_normals;
 
     mu::MeshRefiner refiner;
+    size_t peak_memory = 0;
+    auto checkpoint = [&](size_t extra = 0) {
+        size_t usage = GetMemoryUsage(*this) + refiner.getMemoryUsage() + extra +
+            MemorySize(tmp_normals) + MemorySize(tmp_uv0) + MemorySize(tmp_uv1) + MemorySize(tmp_colors) + MemorySize(remap_normals) +
+            MemorySize(offsets);
+        peak_memory = std::max(peak_memory, usage);
+    };
+    checkpoint();
+
     refiner.split_unit = mrs.split_unit;
+    refiner.spatial_split = mrs.flags.spatial_split;
+    refiner.defer_gather = low_memory;
     refiner.points = points;
     refiner.indices = indices;
     refiner.counts = counts;
-    refiner.buildConnection();
+    refiner.offsets = offsets;
 
-    if (normals.size() == indices.size())
+    // per-index attributes are deduplicated and gathered by the refiner. per-vertex ones are remapped by new2old_points.
+    int num_attributes = 0;
+    int ai_normals = -1, ai_uv0 = -1, ai_uv1 = -1, ai_colors = -1;
+    if (normals.size() == indices.size()) {
         refiner.addExpandedAttribute<float3>(normals, tmp_normals, remap_normals);
-    if (uv0.size() == indices.size())
-        refiner.addExpandedAttribute<float2>(uv0, tmp_uv0, remap_uv0);
-    if (uv1.size() == indices.size())
-        refiner.addExpandedAttribute<float2>(uv1, tmp_uv1, remap_uv1);
-    if (colors.size() == indices.size())
-        refiner.addExpandedAttribute<float4>(colors, tmp_colors, remap_colors);
+        ai_normals = num_attributes++;
+    }
+    if (uv0.size() == indices.size()) {
+        refiner.addExpandedAttribute<float2>(uv0, tmp_uv0);
+        ai_uv0 = num_attributes++;
+    }
+    if (uv1.size() == indices.size()) {
+        refiner.addExpandedAttribute<float2>(uv1, tmp_uv1);
+        ai_uv1 = num_attributes++;
+    }
+    if (colors.size() == indices.size()) {
+        refiner.addExpandedAttribute<float4>(colors, tmp_colors);
+        ai_colors = num_attributes++;
+    }
 
     // refine
     {
         refiner.refine();
+        checkpoint();
         refiner.retopology(mrs.flags.flip_faces);
         refiner.genSubmeshes(material_ids);
+        if (mrs.flags.optimize_vertex_cache)
+            refiner.optimizeVertexCache();
+        refine_vertex_cache_before = refiner.vertex_cache_before;
+        refine_vertex_cache_after = refiner.vertex_cache_after;
+        checkpoint();
+        if (low_memory) {
+            refiner.releaseIntermediates();
+            vclear(offsets);
+        }
 
         // remap vertex attributes
+        if (material_ids.size() == counts.size()) {
+            RawVector<int> tmp_material_ids;
+            Remap(tmp_material_ids, material_ids, refiner.new2old_faces);
+            tmp_material_ids.swap(material_ids);
+        }
         refiner.new_points.swap(points);
         refiner.new_counts.swap(counts);
         refiner.new_indices_submeshes.swap(indices);
-        if (!normals.empty()) {
-            Remap(tmp_normals, normals, !remap_normals.empty() ? remap_normals : refiner.new2old_points);
-            tmp_normals.swap(normals);
-        }
-        if (!uv0.empty()) {
-            Remap(tmp_uv0, uv0, !remap_uv0.empty() ? remap_uv0 : refiner.new2old_points);
-            tmp_uv0.swap(uv0);
-        }
-        if (!uv1.empty()) {
-            Remap(tmp_uv1, uv1, !remap_uv1.empty() ? remap_uv1 : refiner.new2old_points);
-            tmp_uv1.swap(uv1);
-        }
-        if (!colors.empty()) {
-            Remap(tmp_colors, colors, !remap_colors.empty() ? remap_colors : refiner.new2old_points);
-            tmp_colors.swap(colors);
+        if (low_memory) {
+            vclear(refiner.new_points);
+            vclear(refiner.new_counts);
+            vclear(refiner.new_indices_submeshes);
         }
 
+        auto remap_attribute = [&](auto& values, auto& tmp, int ai) {
+            if (values.empty())
+                return;
+            if (ai < 0)
+                Remap(tmp, values, refiner.new2old_points);
+            else if (low_memory)
+                refiner.gatherAttribute(ai);
+            checkpoint();
+            tmp.swap(values);
+            if (low_memory)
+                vclear(tmp);
+        };
+        remap_attribute(normals, tmp_normals, ai_normals);
+        remap_attribute(uv0, tmp_uv0, ai_uv0);
+        remap_attribute(uv1, tmp_uv1, ai_uv1);
+        remap_attribute(colors, tmp_colors, ai_colors);
+
         // setup splits
         splits.clear();
         int offset_indices = 0;
@@ -520,17 +774,11 @@ void Mesh::refine(const MeshRefineSettings& mrs)
         split.bound_size = abs(bmax - bmin);
     }
 
-    // tangents
-    if (mrs.flags.gen_tangents && normals.size() == points.size() && uv0.size() == points.size()) {
-        tangents.resize(points.size());
-        GenerateTangentsTriangleIndexed(tangents.data(),
-            points.data(), uv0.data(), normals.data(), indices.data(), (int)indices.size() / 3, (int)points.size());
-    }
-
     // velocities
     if (velocities.size()== num_points_old) {
         RawVector<float3> tmp_velocities;
         Remap(tmp_velocities, velocities, refiner.new2old_points);
+        checkpoint(MemorySize(tmp_velocities));
         tmp_velocities.swap(velocities);
     }
 
@@ -538,6 +786,7 @@ void Mesh::refine(const MeshRefineSettings& mrs)
     if (weights4.size() == num_points_old) {
         RawVector<Weights4> tmp_weights;
         Remap(tmp_weights, weights4, refiner.new2old_points);
+        checkpoint(MemorySize(tmp_weights));
         weights4.swap(tmp_weights);
     }
     if (!weights1.empty() && bone_counts.size() == num_points_old && bone_offsets.size() == num_points_old) {
@@ -564,6 +813,7 @@ void Mesh::refine(const MeshRefineSettings& mrs)
             int old_offset = bone_offsets[refiner.new2old_points[i]];
             weights1[old_offset].copy_to(&tmp_weights[new_offset], tmp_bone_counts[i]);
         }
+        checkpoint(MemorySize(tmp_bone_counts) + MemorySize(tmp_bone_offsets) + MemorySize(tmp_weights));
 
         bone_counts.swap(tmp_bone_counts);
         bone_offsets.swap(tmp_bone_offsets);
@@ -581,12 +831,38 @@ void Mesh::refine(const MeshRefineSettings& mrs)
         }
     }
 
+    // tangents. generated after per-vertex data is remapped to keep the peak low.
+    if (mrs.flags.gen_tangents && normals.size() == points.size() && uv0.size() == points.size()) {
+        tangents.resize(points.size());
+        GenerateTangentsTriangleIndexed(tangents.data(),
+            points.data(), uv0.data(), normals.data(), indices.data(), (int)indices.size() / 3, (int)points.size());
+        checkpoint();
+    }
+
+    // LODs
+    if (mrs.lod_count > 0) {
+        generateLODs(mrs, refiner.new2old_points);
+        checkpoint();
+    }
+
+    // 16-bit indices. this must be after generating LODs.
+    if (mrs.flags.use_16bit_indices)
+        generateIndices16();
+
     if (!blendshapes.empty()) {
         RawVector<float3> tmp;
+        // old point -> new vertices. built on demand for sparse frames.
+        RawVector<int> o2n_offsets, o2n_indices;
         for (auto& bs : blendshapes) {
             bs->sort();
             for (auto& fp : bs->frames) {
                 auto& f = *fp;
+                if (f.isSparse()) {
+                    if (o2n_offsets.empty())
+                        BuildOld2NewPoints(o2n_offsets, o2n_indices, refiner.new2old_points, num_points_old);
+                    RemapSparseDeltas(f, o2n_offsets, o2n_indices);
+                }
+
                 if (f.points.size() == num_points_old) {
                     Remap(tmp, f.points, refiner.new2old_points);
                     f.points.swap(tmp);
@@ -605,10 +881,22 @@ void Mesh::refine(const MeshRefineSettings& mrs)
                     Remap(tmp, f.tangents, refiner.new2old_points);
                     f.tangents.swap(tmp);
                 }
+                checkpoint(MemorySize(tmp) + MemorySize(o2n_offsets) + MemorySize(o2n_indices));
             }
         }
     }
 
+    // interleaved vertices. this must be after all per-vertex attributes are settled.
+    if (mrs.vertex_format != VertexFormat::Unknown) {
+        generateInterleavedVertices(mrs.vertex_format);
+        checkpoint();
+    }
+
+    for (auto& bs : blendshapes)
+        for (auto& f : bs->frames)
+            f->num_vertices = (int)points.size();
+
+    refine_peak_memory = peak_memory;
     setupFlags();
 }
 
@@ -861,11 +1149,66 @@ void Mesh::applyMirror(const float3 & plane_n, float plane_d, bool /*welding*/)
         weights.resize(points.size());
         mu::CopyWithIndices(&weights[num_points_old], &weights[0], copylist);
     }
+    if (bone_influence_counts.size() == num_points_old) {
+        RawVector<int> offsets(num_points_old);
+        int total = 0;
+        for (size_t pi = 0; pi < num_points_old; ++pi) {
+            offsets[pi] = total;
+            total += bone_influence_counts[pi];
+        }
+        if (total > (int)bone_influences.size()) {
+            // malformed. drop the sparse influences rather than reading out of bounds.
+            vclear(bone_influence_counts);
+            vclear(bone_influences);
+        }
+        else {
+            bone_influence_counts.resize(points.size());
+            mu::CopyWithIndices(&bone_influence_counts[num_points_old], &bone_influence_counts[0], copylist);
+            for (int pi : copylist) {
+                int n = bone_influence_counts[pi];
+                size_t pos = bone_influences.size();
+                bone_influences.resize(pos + n);
+                bone_influences[offsets[pi]].copy_to(&bone_influences[pos], n);
+            }
+        }
+    }
 
     // blendshapes
     for (auto& bs : blendshapes) {
         for (auto& fp : bs->frames) {
             auto& f = *fp;
+            if (f.isSparse()) {
+                size_t n = f.sparse_indices.size();
+                bool has_points = f.sparse_points.size() == n;
+                bool has_normals = f.sparse_normals.size() == n;
+                bool has_tangents = f.sparse_tangents.size() == n;
+                for (size_t i = 0; i < n; ++i) {
+                    int pi = f.sparse_indices[i];
+                    if (pi < 0 || pi >= (int)num_points_old || indirect[pi] == pi)
+                        continue;
+                    f.sparse_indices.push_back(indirect[pi]);
+                    if (has_points) {
+                        float3 v = f.sparse_points[i];
+                        f.sparse_points.push_back(v);
+                    }
+                    if (has_normals) {
+                        float3 v = f.sparse_normals[i];
+                        f.sparse_normals.push_back(v);
+                    }
+                    if (has_tangents) {
+                        float3 v = f.sparse_tangents[i];
+                        f.sparse_tangents.push_back(v);
+                    }
+                }
+                size_t num_additional = f.sparse_indices.size() - n;
+                if (has_points)
+                    mu::MirrorVectors(f.sparse_points.data() + n, num_additional, plane_n);
+                if (has_normals)
+                    mu::MirrorVectors(f.sparse_normals.data() + n, num_additional, plane_n);
+                if (has_tangents)
+                    mu::MirrorVectors(f.sparse_tangents.data() + n, num_additional, plane_n);
+            }
+
             if (!f.points.empty()) {
                 f.points.resize(points.size());
                 mu::CopyWithIndices(&f.points[num_points_old], &f.points[0], copylist);
@@ -903,16 +1246,57 @@ void Mesh::applyMirror(const float3 & plane_n, float plane_d, bool /*welding*/)
     }
 }
 
+static const int TransformGranularity = 8192;
+
 void Mesh::applyTransform(const float4x4& m)
 {
     if (mu::near_equal(m, float4x4::identity()))
         return;
-    mu::MulPoints(m, points.data(), points.data(), points.size());
-    mu::MulVectors(m, normals.data(), normals.data(), normals.size());
-    mu::Normalize(normals.data(), normals.size());
-    mu::MulVectors(m, velocities.data(), velocities.data(), velocities.size());
+
+    auto each_block = [](size_t num, const std::function<void(size_t, size_t)>& body) {
+        parallel_for_blocked(0, (int)num, TransformGranularity, [&](int begin, int end) {
+            body(begin, end - begin);
+        });
+    };
+    each_block(points.size(), [&](size_t i, size_t n) {
+        mu::MulPoints(m, &points[i], &points[i], n);
+    });
+
+    // normals are transformed by inverse transpose to keep them perpendicular to the surface with non-uniform scale.
+    // normals and tangents are normalized in the same pass. zero-length ones stay zero.
+    auto nm = to_mat4x4(transpose(invert(to_mat3x3(m))));
+    each_block(normals.size(), [&](size_t i, size_t n) {
+        mu::MulNormals(nm, &normals[i], &normals[i], n);
+    });
+    each_block(tangents.size(), [&](size_t i, size_t n) {
+        mu::MulTangents(m, &tangents[i], &tangents[i], n);
+    });
+    each_block(velocities.size(), [&](size_t i, size_t n) {
+        mu::MulVectors(m, &velocities[i], &velocities[i], n);
+    });
+}
+
+bool Mesh::hasSparseBoneInfluences() const
+{
+    return !bone_influence_counts.empty() && bone_influence_counts.size() == points.size();
 }
 
+// keep dst sorted by descending weight. the weakest influence is dropped when all 4 slots are taken.
+static inline void InsertInfluence(Weights4& dst, int index, float weight)
+{
+    if (!(weight > dst.weights[3]))
+        return;
+    int i = 3;
+    for (; i > 0 && dst.weights[i - 1] < weight; --i) {
+        dst.weights[i] = dst.weights[i - 1];
+        dst.indices[i] = dst.indices[i - 1];
+    }
+    dst.weights[i] = weight;
+    dst.indices[i] = index;
+}
+
+static const int BoneWeightsGranularity = 1024;
+
 void Mesh::setupBoneWeights4()
 {
     if (bones.empty())
@@ -922,34 +1306,42 @@ void Mesh::setupBoneWeights4()
     int num_vertices = (int)points.size();
     weights4.resize_zeroclear(num_vertices);
 
-    RawVector<Weights1> tmp(num_bones);
-    for (int vi = 0; vi < num_vertices; ++vi) {
-        int num_influence = 0;
-        for (int bi = 0; bi < num_bones; ++bi) {
-            float w = bones[bi]->weights[vi];
-            if (w > 0.0f) {
-                tmp[num_influence].index = bi;
-                tmp[num_influence].weight = bones[bi]->weights[vi];
-                ++num_influence;
-            }
-        }
-        if (num_influence > 4) {
-            std::nth_element(&tmp[0], &tmp[4], &tmp[num_influence],
-                [&](auto& a, auto& b) { return a.weight > b.weight; });
-        }
-
-        int n = std::min(4, num_influence);
-        if (n == 0) {
-            // should do something?
+    if (hasSparseBoneInfluences()) {
+        RawVector<int> offsets(num_vertices);
+        int total = 0;
+        for (int vi = 0; vi < num_vertices; ++vi) {
+            offsets[vi] = total;
+            total += bone_influence_counts[vi];
         }
-        else {
-            auto& w4 = weights4[vi];
-            for (int bi = 0; bi < n; ++bi) {
-                w4.indices[bi] = tmp[bi].index;
-                w4.weights[bi] = tmp[bi].weight;
+        if (total > (int)bone_influences.size())
+            return;
+
+        parallel_for_blocked(0, num_vertices, BoneWeightsGranularity, [&](int begin, int end) {
+            for (int vi = begin; vi < end; ++vi) {
+                auto& w4 = weights4[vi];
+                const Weights1 *src = &bone_influences[offsets[vi]];
+                int n = bone_influence_counts[vi];
+                for (int i = 0; i < n; ++i) {
+                    if (src[i].index >= 0 && src[i].index < num_bones)
+                        InsertInfluence(w4, src[i].index, src[i].weight);
+                }
+                w4.normalize();
             }
-            w4.normalize();
-        }
+        });
+    }
+    else {
+        // iterate bone-major in each block to keep accesses to BoneData::weights sequential
+        parallel_for_blocked(0, num_vertices, BoneWeightsGranularity, [&](int begin, int end) {
+            for (int bi = 0; bi < num_bones; ++bi) {
+                if ((int)bones[bi]->weights.size() != num_vertices)
+                    continue;
+                const float *weights = bones[bi]->weights.data();
+                for (int vi = begin; vi < end; ++vi)
+                    InsertInfluence(weights4[vi], bi, weights[vi]);
+            }
+            for (int vi = begin; vi < end; ++vi)
+                weights4[vi].normalize();
+        });
     }
 }
 
@@ -963,49 +1355,493 @@ void Mesh::setupBoneWeightsVariable()
     bone_offsets.resize_discard(num_vertices);
     bone_counts.resize_discard(num_vertices);
 
-    // count bone influence and offset
-    int offset = 0;
-    for (int vi = 0; vi < num_vertices; ++vi) {
-        int num_influence = 0;
-        for (int bi = 0; bi < num_bones; ++bi) {
-            float weight = bones[bi]->weights[vi];
-            if (weight > 0.0f) {
-                if (++num_influence == 255)
-                    break;
+    bool sparse = hasSparseBoneInfluences();
+    RawVector<int> src_offsets;
+    if (sparse) {
+        src_offsets.resize_discard(num_vertices);
+        int total = 0;
+        for (int vi = 0; vi < num_vertices; ++vi) {
+            src_offsets[vi] = total;
+            total += bone_influence_counts[vi];
+        }
+        if (total > (int)bone_influences.size()) {
+            bone_counts.zeroclear();
+            bone_offsets.zeroclear();
+            weights1.clear();
+            return;
+        }
+    }
+    auto valid_influence = [num_bones](const Weights1& w) {
+        return w.weight > 0.0f && w.index >= 0 && w.index < num_bones;
+    };
+
+    // count bone influence
+    parallel_for_blocked(0, num_vertices, BoneWeightsGranularity, [&](int begin, int end) {
+        if (sparse) {
+            for (int vi = begin; vi < end; ++vi) {
+                const Weights1 *src = &bone_influences[src_offsets[vi]];
+                int n = bone_influence_counts[vi];
+                int num_influence = 0;
+                for (int i = 0; i < n; ++i) {
+                    if (valid_influence(src[i]))
+                        ++num_influence;
+                }
+                bone_counts[vi] = (uint8_t)num_influence;
+            }
+        }
+        else {
+            memset(&bone_counts[begin], 0, end - begin);
+            for (int bi = 0; bi < num_bones; ++bi) {
+                if ((int)bones[bi]->weights.size() != num_vertices)
+                    continue;
+                const float *weights = bones[bi]->weights.data();
+                for (int vi = begin; vi < end; ++vi) {
+                    if (weights[vi] > 0.0f && bone_counts[vi] < 255)
+                        ++bone_counts[vi];
+                }
             }
         }
+    });
+
+    // offsets
+    int offset = 0;
+    for (int vi = 0; vi < num_vertices; ++vi) {
         bone_offsets[vi] = offset;
-        bone_counts[vi] = (uint8_t)num_influence;
-        offset += num_influence;
+        offset += bone_counts[vi];
     }
     weights1.resize_zeroclear(offset);
 
     // calculate bone weights
-    offset = 0;
-    for (int vi = 0; vi < num_vertices; ++vi) {
-        auto *dst = &weights1[offset];
-        int num_influence = 0;
-        for (int bi = 0; bi < num_bones; ++bi) {
-            float weight = bones[bi]->weights[vi];
-            if (weight > 0.0f) {
-                auto& w1 = dst[num_influence];
-                w1.weight = weight;
-                w1.index = bi;
-                if (++num_influence == 255)
-                    break;
+    parallel_for_blocked(0, num_vertices, BoneWeightsGranularity, [&](int begin, int end) {
+        if (sparse) {
+            for (int vi = begin; vi < end; ++vi) {
+                const Weights1 *src = &bone_influences[src_offsets[vi]];
+                auto *dst = &weights1[bone_offsets[vi]];
+                int n = bone_influence_counts[vi];
+                for (int i = 0; i < n; ++i) {
+                    if (valid_influence(src[i]))
+                        *dst++ = src[i];
+                }
+            }
+        }
+        else {
+            RawVector<uint8_t> pos(end - begin);
+            pos.zeroclear();
+            for (int bi = 0; bi < num_bones; ++bi) {
+                if ((int)bones[bi]->weights.size() != num_vertices)
+                    continue;
+                const float *weights = bones[bi]->weights.data();
+                for (int vi = begin; vi < end; ++vi) {
+                    float weight = weights[vi];
+                    auto& p = pos[vi - begin];
+                    if (weight > 0.0f && p < bone_counts[vi]) {
+                        auto& w1 = weights1[bone_offsets[vi] + p++];
+                        w1.weight = weight;
+                        w1.index = bi;
+                    }
+                }
+            }
+        }
+
+        for (int vi = begin; vi < end; ++vi) {
+            int num_influence = bone_counts[vi];
+            if (num_influence == 0) {
+                // should do something?
+            }
+            else {
+                auto *dst = &weights1[bone_offsets[vi]];
+                dst->normalize(num_influence);
+                // Unity requires descending order of weights
+                std::stable_sort(dst, dst + num_influence,
+                    [&](auto& a, auto& b) { return a.weight > b.weight; });
             }
         }
-        offset += num_influence;
+    });
+}
+
+static const int SkinGranularity = 4096;
 
-        if (num_influence == 0) {
-            // should do something?
+void Mesh::bakeBlendShapes()
+{
+    size_t num_points = points.size();
+    bool has_normal_deltas = false, has_tangent_deltas = false;
+
+    // add deltas of a frame multiplied by s. normals and tangents can be per-vertex or per-index.
+    auto add_deltas = [&](const BlendShapeFrameData& f, float s) {
+        if (s == 0.0f)
+            return;
+        auto add = [s](auto *dst, const float3 *src, size_t num) {
+            parallel_for_blocked(0, (int)num, SkinGranularity, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i)
+                    (float3&)dst[i] += src[i] * s;
+            });
+        };
+        if (f.isSparse()) {
+            size_t n = f.sparse_indices.size();
+            bool has_points = f.sparse_points.size() == n;
+            bool has_normals = f.sparse_normals.size() == n && normals.size() == num_points;
+            bool has_tangents = f.sparse_tangents.size() == n && tangents.size() == num_points;
+            for (size_t i = 0; i < n; ++i) {
+                int vi = f.sparse_indices[i];
+                if (vi < 0 || vi >= (int)num_points)
+                    continue;
+                if (has_points)
+                    points[vi] += f.sparse_points[i] * s;
+                if (has_normals)
+                    normals[vi] += f.sparse_normals[i] * s;
+                if (has_tangents)
+                    (float3&)tangents[vi] += f.sparse_tangents[i] * s;
+            }
+            has_normal_deltas |= has_normals;
+            has_tangent_deltas |= has_tangents;
         }
         else {
-            dst->normalize(num_influence);
-            // Unity requires descending order of weights
-            std::sort(dst, dst + num_influence,
-                [&](auto& a, auto& b) { return a.weight > b.weight; });
+            if (f.points.size() == num_points)
+                add(points.data(), f.points.data(), num_points);
+            if (!normals.empty() && f.normals.size() == normals.size()) {
+                add(normals.data(), f.normals.data(), normals.size());
+                has_normal_deltas = true;
+            }
+            if (!tangents.empty() && f.tangents.size() == tangents.size()) {
+                add(tangents.data(), f.tangents.data(), tangents.size());
+                has_tangent_deltas = true;
+            }
+        }
+    };
+
+    for (auto& bs : blendshapes) {
+        bs->sort();
+        auto& frames = bs->frames;
+        if (frames.empty() || bs->weight == 0.0f)
+            continue;
+
+        // deltas are piecewise linear between (0, zero) and frames. the last segment is extrapolated.
+        int fi = 0;
+        while (fi < (int)frames.size() - 1 && frames[fi]->weight < bs->weight)
+            ++fi;
+        auto *f1 = fi > 0 ? frames[fi - 1].get() : nullptr;
+        auto *f2 = frames[fi].get();
+        float w1 = f1 ? f1->weight : 0.0f;
+        float t = f2->weight != w1 ? (bs->weight - w1) / (f2->weight - w1) : 1.0f;
+        if (f1)
+            add_deltas(*f1, 1.0f - t);
+        add_deltas(*f2, t);
+    }
+
+    if (has_normal_deltas)
+        mu::Normalize(normals.data(), normals.size());
+    if (has_tangent_deltas) {
+        parallel_for_blocked(0, (int)tangents.size(), SkinGranularity, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i)
+                (float3&)tangents[i] = normalize((float3&)tangents[i]);
+        });
+    }
+    blendshapes.clear();
+    flags.has_blendshape_weights = flags.has_blendshapes = 0;
+}
+
+void Mesh::bakeSkin(const IArray<float4x4> bone_matrices, const float4x4& world2local, int max_bone_influence)
+{
+    bakeBlendShapes();
+
+    int num_bones = (int)bones.size();
+    if (num_bones == 0 || (int)bone_matrices.size() != num_bones)
+        return;
+
+    // skinning matrices: bind pose -> bone -> mesh space.
+    // the extra identity matrix at the end is for vertices without influence, which are kept as is.
+    RawVector<float4x4> skin_matrices(num_bones + 1);
+    for (int bi = 0; bi < num_bones; ++bi)
+        skin_matrices[bi] = bones[bi]->bindpose * bone_matrices[bi] * world2local;
+    skin_matrices[num_bones] = float4x4::identity();
+
+    int num_points = (int)points.size();
+    int num_indices = (int)indices.size();
+    bool vertex_normals = normals.size() == num_points;
+    bool vertex_tangents = tangents.size() == num_points;
+    bool index_normals = !vertex_normals && normals.size() == num_indices;
+    bool index_tangents = !vertex_tangents && tangents.size() == num_indices;
+
+    if (max_bone_influence == -1) {
+        setupBoneWeightsVariable();
+        if (bone_counts.size() != num_points)
+            return;
+
+        auto blend = [&](int vi) {
+            int n = bone_counts[vi];
+            if (n == 0)
+                return skin_matrices[num_bones];
+            const Weights1 *w = &weights1[bone_offsets[vi]];
+            float4x4 m;
+            for (int r = 0; r < 4; ++r) {
+                m[r] = skin_matrices[w[0].index][r] * w[0].weight;
+                for (int i = 1; i < n; ++i)
+                    m[r] += skin_matrices[w[i].index][r] * w[i].weight;
+            }
+            return m;
+        };
+        parallel_for_blocked(0, num_points, SkinGranularity, [&](int begin, int end) {
+            for (int vi = begin; vi < end; ++vi) {
+                auto m = blend(vi);
+                points[vi] = mul_p(m, points[vi]);
+                if (vertex_normals)
+                    normals[vi] = normalize(mul_v(m, normals[vi]));
+                if (vertex_tangents)
+                    (float3&)tangents[vi] = normalize(mul_v(m, (float3&)tangents[vi]));
+            }
+        });
+        if (index_normals || index_tangents) {
+            parallel_for_blocked(0, num_indices, SkinGranularity, [&](int begin, int end) {
+                for (int ii = begin; ii < end; ++ii) {
+                    auto m = blend(indices[ii]);
+                    if (index_normals)
+                        normals[ii] = normalize(mul_v(m, normals[ii]));
+                    if (index_tangents)
+                        (float3&)tangents[ii] = normalize(mul_v(m, (float3&)tangents[ii]));
+                }
+            });
+        }
+    }
+    else {
+        setupBoneWeights4();
+        if (weights4.size() != num_points)
+            return;
+
+        parallel_for_blocked(0, num_points, SkinGranularity, [&](int begin, int end) {
+            for (int vi = begin; vi < end; ++vi) {
+                auto& w = weights4[vi];
+                if (w.weights[0] == 0.0f) {
+                    w.weights[0] = 1.0f;
+                    w.indices[0] = num_bones;
+                }
+            }
+            size_t n = end - begin;
+            mu::Skin4(skin_matrices.data(), &weights4[begin],
+                &points[begin], vertex_normals ? &normals[begin] : nullptr, vertex_tangents ? &tangents[begin] : nullptr,
+                &points[begin], vertex_normals ? &normals[begin] : nullptr, vertex_tangents ? &tangents[begin] : nullptr, n);
+        });
+        if (index_normals || index_tangents) {
+            parallel_for_blocked(0, num_indices, SkinGranularity, [&](int begin, int end) {
+                size_t n = end - begin;
+                RawVector<Weights4> weights(n);
+                CopyWithIndices(weights.data(), weights4.data(), indices, begin, end);
+                mu::Skin4(skin_matrices.data(), weights.data(),
+                    nullptr, index_normals ? &normals[begin] : nullptr, index_tangents ? &tangents[begin] : nullptr,
+                    nullptr, index_normals ? &normals[begin] : nullptr, index_tangents ? &tangents[begin] : nullptr, n);
+            });
+        }
+    }
+
+    bones.clear();
+    root_bone.clear();
+    vclear(bone_influence_counts);
+    vclear(bone_influences);
+    vclear(weights4);
+    vclear(bone_counts);
+    vclear(bone_offsets);
+    vclear(weights1);
+    flags.has_bones = 0;
+}
+
+void Mesh::generateLODs(const MeshRefineSettings& mrs, const RawVector<int>& new2old_points)
+{
+    int num_lods = (int)mrs.lod_count;
+    int num_vertices = (int)points.size();
+    int num_submeshes = (int)submeshes.size();
+    if (num_lods == 0 || num_submeshes == 0 || (int)new2old_points.size() != num_vertices)
+        return;
+
+    RawVector<int> submesh_to_split(num_submeshes);
+    for (int spi = 0; spi < (int)splits.size(); ++spi) {
+        auto& split = splits[spi];
+        int first = (int)(split.submeshes.data() - submeshes.data());
+        for (int i = 0; i < (int)split.submeshes.size(); ++i)
+            submesh_to_split[first + i] = spi;
+    }
+
+    // vertices that must be kept: UV/normal seams (vertices split from the same point) and material boundaries
+    RawVector<uint8_t> locks;
+    locks.resize_zeroclear(num_vertices);
+    {
+        int num_points_old = 0;
+        for (int pi : new2old_points)
+            num_points_old = std::max(num_points_old, pi + 1);
+        RawVector<int> first_vertex(num_points_old), stamps(num_points_old);
+        memset(stamps.data(), -1, sizeof(int) * num_points_old);
+        RawVector<int> used_by(num_vertices);
+        memset(used_by.data(), -1, sizeof(int) * num_vertices);
+
+        for (int spi = 0; spi < (int)splits.size(); ++spi) {
+            auto& split = splits[spi];
+            for (int vi = split.vertex_offset; vi < split.vertex_offset + split.vertex_count; ++vi) {
+                int pi = new2old_points[vi];
+                if (stamps[pi] == spi) {
+                    locks[vi] = 1;
+                    locks[first_vertex[pi]] = 1;
+                }
+                else {
+                    stamps[pi] = spi;
+                    first_vertex[pi] = vi;
+                }
+            }
+            for (int smi = 0; smi < (int)split.submeshes.size(); ++smi) {
+                auto& sm = split.submeshes[smi];
+                if (sm.topology != SubmeshData::Topology::Triangles)
+                    continue;
+                for (int i : sm.indices) {
+                    int& u = used_by[split.vertex_offset + i];
+                    if (u == -1)
+                        u = smi;
+                    else if (u != smi)
+                        locks[split.vertex_offset + i] = 1;
+                }
+            }
+        }
+    }
+
+    // vertices can be merged only if they are dominated by the same bone
+    RawVector<int> groups;
+    if (weights4.size() == num_vertices) {
+        groups.resize_discard(num_vertices);
+        for (int vi = 0; vi < num_vertices; ++vi)
+            groups[vi] = weights4[vi].weights[0] > 0.0f ? weights4[vi].indices[0] : -1;
+    }
+    else if (bone_counts.size() == num_vertices && bone_offsets.size() == num_vertices) {
+        groups.resize_discard(num_vertices);
+        for (int vi = 0; vi < num_vertices; ++vi)
+            groups[vi] = bone_counts[vi] > 0 ? weights1[bone_offsets[vi]].index : -1;
+    }
+
+    // simplify each submesh for each LOD in parallel
+    std::vector<RawVector<int>> results(num_lods * num_submeshes);
+    parallel_for(0, num_lods * num_submeshes, [&](int ti) {
+        int lod = ti / num_submeshes;
+        auto& sm = submeshes[ti % num_submeshes];
+        auto& split = splits[submesh_to_split[ti % num_submeshes]];
+        auto& dst = results[ti];
+        if (sm.topology != SubmeshData::Topology::Triangles) {
+            dst.assign(sm.indices.begin(), sm.indices.end());
+            return;
         }
+
+        int offset = split.vertex_offset;
+        int count = split.vertex_count;
+        int target = (int)((float)(sm.indices.size() / 3) * std::pow(mrs.lod_ratio, (float)(lod + 1))) * 3;
+        SimplifyTriangles(dst, sm.indices, IArray<float3>(points.data() + offset, count), target, FLT_MAX,
+            IArray<uint8_t>(locks.data() + offset, count),
+            groups.empty() ? IArray<int>() : IArray<int>(groups.data() + offset, count));
+        if (mrs.flags.optimize_vertex_cache)
+            OptimizeVertexCache(dst, count);
+    });
+
+    // gather. lod_submeshes are ordered by split, then LOD, then submesh.
+    size_t total = 0;
+    for (auto& r : results)
+        total += r.size();
+    lod_indices.resize_discard(total);
+    lod_submeshes.resize(num_lods * num_submeshes);
+
+    int *dst_indices = lod_indices.data();
+    int dst_submesh = 0;
+    for (auto& split : splits) {
+        int first = (int)(split.submeshes.data() - submeshes.data());
+        int n = (int)split.submeshes.size();
+        split.lod_submeshes.reset(&lod_submeshes[dst_submesh], num_lods * n);
+        for (int lod = 0; lod < num_lods; ++lod) {
+            for (int i = 0; i < n; ++i) {
+                auto& src = results[lod * num_submeshes + first + i];
+                auto& dst = lod_submeshes[dst_submesh++];
+                dst = submeshes[first + i];
+                src.copy_to(dst_indices);
+                dst.indices.reset(dst_indices, src.size());
+                dst_indices += src.size();
+            }
+        }
+    }
+}
+
+void Mesh::generateIndices16()
+{
+    // split local indices of a split with up to 65536 vertices fit in 16 bits.
+    // indices16 is laid out by split, then submeshes followed by LOD submeshes.
+    const int max_vertices = 0x10000;
+
+    int num_splits = (int)splits.size();
+    RawVector<int> offsets;
+    offsets.resize_discard(num_splits + 1);
+    int total = 0;
+    for (int si = 0; si < num_splits; ++si) {
+        offsets[si] = total;
+        auto& split = splits[si];
+        if (split.vertex_count > max_vertices)
+            continue;
+        for (auto& sm : split.submeshes)
+            total += (int)sm.indices.size();
+        for (auto& sm : split.lod_submeshes)
+            total += (int)sm.indices.size();
+    }
+    offsets[num_splits] = total;
+    indices16.resize_discard(total);
+
+    auto convert = [](SubmeshData& sm, uint16_t *dst) {
+        const int *src = sm.indices.data();
+        size_t n = sm.indices.size();
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = (uint16_t)src[i];
+        sm.indices16.reset(dst, n);
+        sm.index_format = IndexFormat::UInt16;
+        return dst + n;
+    };
+
+    parallel_for(0, num_splits, [&](int si) {
+        auto& split = splits[si];
+        if (split.vertex_count > max_vertices) {
+            split.index_format = IndexFormat::UInt32;
+            return;
+        }
+        uint16_t *dst = indices16.data() + offsets[si];
+        for (auto& sm : split.submeshes)
+            dst = convert(sm, dst);
+        for (auto& sm : split.lod_submeshes)
+            dst = convert(sm, dst);
+        split.index_format = IndexFormat::UInt16;
+    });
+}
+
+void Mesh::generateInterleavedVertices(VertexFormat format)
+{
+    vertex_format = format;
+    size_t stride = GetVertexSize(format);
+    size_t num_points = points.size();
+    if (stride == 0 || num_points == 0) {
+        vclear(vertices_interleaved);
+        return;
+    }
+    vertices_interleaved.resize_discard(stride * num_points);
+
+    // attributes the mesh doesn't have are filled with zero
+    auto get = [num_points](auto& v) { return v.size() == num_points ? v.data() : nullptr; };
+    const float3 *src_normals = get(normals);
+    const float4 *src_colors = get(colors);
+    const float2 *src_uv = get(uv0);
+    const float4 *src_tangents = get(tangents);
+
+    auto body = [&](int offset, int count) {
+        Interleave(&vertices_interleaved[stride * offset], format, count,
+            &points[offset],
+            src_normals ? src_normals + offset : nullptr,
+            src_colors ? src_colors + offset : nullptr,
+            src_uv ? src_uv + offset : nullptr,
+            src_tangents ? src_tangents + offset : nullptr);
+    };
+    if (splits.empty()) {
+        body(0, (int)num_points);
+    }
+    else {
+        parallel_for(0, (int)splits.size(), [&](int si) {
+            auto& split = splits[si];
+            body(split.vertex_offset, split.vertex_count);
+        });
     }
 }
 
@@ -53,7 +53,10 @@ struct MeshRefineFlags
     uint32_t mirror_basis : 1;
     uint32_t make_double_sided : 1;
     uint32_t quadify : 1;
-    uint32_t quadify_full_search : 1;
+    uint32_t quadify_full_search : 1; // unused. QuadifyTriangles() has no full search anymore. kept for the layout.
+    uint32_t optimize_vertex_cache : 1;
+    uint32_t spatial_split : 1;
+    uint32_t use_16bit_indices : 1; // 30
 };
 
 struct MeshRefineSettings
@@ -67,10 +70,22 @@ struct MeshRefineSettings
     float4x4 local2world = float4x4::identity();
     float4x4 world2local = float4x4::identity();
     float4x4 mirror_basis = float4x4::identity();
+    uint32_t lod_count = 0; // 0 == no LODs
+    float lod_ratio = 0.5f; // triangle count ratio of each LOD to the previous level
+    // in MB. 0 == never. refine() switches to low memory mode if its peak memory is estimated to exceed this.
+    // this is not a bound: low memory mode lowers the peak, but the result is still built as whole arrays.
+    uint32_t low_memory_threshold = 0;
+    VertexFormat vertex_format = VertexFormat::Unknown; // if not Unknown, refine() also generates interleaved vertices in this format
 
     uint64_t checksum() const;
 };
 
+enum class IndexFormat
+{
+    UInt32,
+    UInt16,
+};
+
 struct SubmeshData
 {
     enum class Topology
@@ -82,7 +97,9 @@ struct SubmeshData
     };
 
     IArray<int> indices;
+    IArray<uint16_t> indices16; // valid if index_format is UInt16
     Topology topology = Topology::Triangles;
+    IndexFormat index_format = IndexFormat::UInt32;
     int material_id = 0;
 };
 
@@ -95,6 +112,8 @@ struct SplitData
     int bone_weight_count = 0;
     int bone_weight_offset = 0;
     IArray<SubmeshData> submeshes;
+    IArray<SubmeshData> lod_submeshes; // [lod * submeshes.size() + submesh_index]
+    IndexFormat index_format = IndexFormat::UInt32;
     float3 bound_center = float3::zero();
     float3 bound_size = float3::zero();
 };
@@ -106,6 +125,16 @@ struct BlendShapeFrameData
     RawVector<float3> normals;  // can be empty, per-vertex or per-index data
     RawVector<float3> tangents; // can be empty, per-vertex or per-index data
 
+    // sparse deltas. alternative to the dense arrays above. only affected vertices are stored.
+    // all of them are per-vertex. per-index normals or tangents can't be sparse and must use the dense arrays.
+    RawVector<int>    sparse_indices;  // vertex indices
+    RawVector<float3> sparse_points;   // can be empty or per-sparse_indices data
+    RawVector<float3> sparse_normals;  // can be empty or per-sparse_indices data
+    RawVector<float3> sparse_tangents; // can be empty or per-sparse_indices data
+
+    // vertex count of the mesh. set by Mesh::refine() to expand sparse deltas to full length. not serialized.
+    int num_vertices = 0;
+
 protected:
     BlendShapeFrameData();
     ~BlendShapeFrameData();
@@ -116,6 +145,8 @@ public:
     void deserialize(std::istream& is);
     void clear();
 
+    bool isSparse() const;
+    bool sparsify(size_t num_vertices);
     void convertHandedness(bool x, bool yz);
     void applyScaleFactor(float scale);
 };
@@ -188,6 +219,10 @@ public:
 
     std::string root_bone;
     std::vector<BoneDataPtr> bones;
+    // sparse bone influences (CSR). alternative to BoneData::weights. can be empty or per-vertex data.
+    // influences of a vertex are stored contiguously in bone_influences. offsets are prefix sum of bone_influence_counts.
+    RawVector<uint8_t>  bone_influence_counts;
+    RawVector<Weights1> bone_influences;
     std::vector<BlendShapeDataPtr> blendshapes;
 
 
@@ -200,6 +235,14 @@ public:
     RawVector<Weights1> weights1;
     std::vector<SubmeshData> submeshes;
     std::vector<SplitData> splits;
+    RawVector<int> lod_indices;
+    std::vector<SubmeshData> lod_submeshes;
+    RawVector<uint16_t> indices16; // compact 16-bit copies of indices and lod_indices of splits that fit
+    RawVector<char> vertices_interleaved; // vertices in vertex_format. laid out by split as points
+    VertexFormat vertex_format = VertexFormat::Unknown;
+    uint64_t refine_peak_memory = 0; // in byte. peak memory of vertex data and temporaries measured in the last refine()
+    // ACMR / ATVR of the last refine() before and after optimize_vertex_cache. zero if it is not enabled.
+    VertexCacheStatistics refine_vertex_cache_before, refine_vertex_cache_after;
 
 
 protected:
@@ -224,14 +267,26 @@ public:
     void makeDoubleSided();
     void applyMirror(const float3& plane_n, float plane_d, bool welding = false);
     void applyTransform(const float4x4& t);
-
+    // apply weights of blendshapes to points, normals and tangents, and remove blendshapes.
+    void bakeBlendShapes();
+    // bake the current pose: bakeBlendShapes() and linear blend skinning, and remove bones.
+    // bone_matrices: local to world matrices of bones in the order of bones. world2local: from world to the space of baked vertices.
+    // max_bone_influence: 4 or -1 (variable) as MeshRefineSettings::max_bone_influence.
+    void bakeSkin(const IArray<float4x4> bone_matrices, const float4x4& world2local, int max_bone_influence = 4);
+
+    bool hasSparseBoneInfluences() const;
     void setupBoneWeights4();
     void setupBoneWeightsVariable();
+    void generateLODs(const MeshRefineSettings& mrs, const RawVector<int>& new2old_points);
+    void generateIndices16();
+    void generateInterleavedVertices(VertexFormat format);
     void setupFlags();
 
     void convertHandedness_Mesh(bool x, bool yz);
     void convertHandedness_BlendShapes(bool x, bool yz);
     void convertHandedness_Bones(bool x, bool yz);
+    void applyScaleFactor_BlendShapes(float scale);
+    void applyScaleFactor_Bones(float scale);
 
     BoneDataPtr addBone(const std::string& path);
     BlendShapeDataPtr addBlendShape(const std::string& name);
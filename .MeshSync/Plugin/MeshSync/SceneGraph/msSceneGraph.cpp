@@ -10,6 +10,183 @@
 namespace ms {
 
 
+// SceneHierarchy
+#pragma region SceneHierarchy
+
+// FNV-1a. hashes of ancestors' paths are intermediate values of the hash of the path.
+static const uint64_t kPathHashBasis = 0xcbf29ce484222325ull;
+static inline uint64_t PathHashStep(uint64_t h, char c)
+{
+    return (h ^ (uint8_t)c) * 0x100000001b3ull;
+}
+static inline uint64_t PathHash(const std::string& path)
+{
+    uint64_t h = kPathHashBasis;
+    for (char c : path)
+        h = PathHashStep(h, c);
+    return h;
+}
+
+void SceneHierarchy::clear()
+{
+    parents.clear();
+    depths.clear();
+    order.clear();
+    level_offsets.clear();
+    world_matrices.clear();
+    m_entities.clear();
+    m_path_table.clear();
+    m_sorted_parents.clear();
+    m_local.clear();
+    m_world.clear();
+    m_parent_world.clear();
+}
+
+bool SceneHierarchy::isValid(const std::vector<TransformPtr>& entities) const
+{
+    size_t n = entities.size();
+    if (n != m_entities.size())
+        return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (entities[i].get() != m_entities[i])
+            return false;
+    }
+    return true;
+}
+
+int SceneHierarchy::findEntityIndex(const std::string& path) const
+{
+    // if paths are duplicated, the first entity wins
+    auto range = m_path_table.equal_range(PathHash(path));
+    int ret = -1;
+    for (auto it = range.first; it != range.second; ++it) {
+        if (m_entities[it->second]->path == path && (ret == -1 || it->second < ret))
+            ret = it->second;
+    }
+    return ret;
+}
+
+void SceneHierarchy::build(const std::vector<TransformPtr>& entities)
+{
+    int n = (int)entities.size();
+    m_entities.resize(n);
+    for (int i = 0; i < n; ++i)
+        m_entities[i] = entities[i].get();
+
+    m_path_table.clear();
+    m_path_table.reserve(n);
+    for (int i = 0; i < n; ++i)
+        m_path_table.emplace(PathHash(m_entities[i]->path), i);
+
+    // parents. prefixes of the path that end before '/' are looked up from the longest.
+    parents.resize_discard(n);
+    parallel_for_blocked(0, n, 256, [&](int begin, int end) {
+        RawVector<std::pair<uint64_t, size_t>> prefixes; // hash, length
+        for (int i = begin; i < end; ++i) {
+            auto& path = m_entities[i]->path;
+            prefixes.clear();
+            uint64_t h = kPathHashBasis;
+            for (size_t ci = 0; ci < path.size(); ++ci) {
+                if (path[ci] == '/' && ci > 0)
+                    prefixes.push_back({ h, ci });
+                h = PathHashStep(h, path[ci]);
+            }
+
+            int parent = -1;
+            for (size_t pi = prefixes.size(); pi-- > 0 && parent == -1; ) {
+                auto range = m_path_table.equal_range(prefixes[pi].first);
+                size_t len = prefixes[pi].second;
+                for (auto it = range.first; it != range.second; ++it) {
+                    auto& ppath = m_entities[it->second]->path;
+                    if (ppath.size() == len && path.compare(0, len, ppath) == 0 && (parent == -1 || it->second < parent))
+                        parent = it->second;
+                }
+            }
+            parents[i] = parent;
+        }
+    });
+
+    // depths. parents always have shorter paths, so chains always end.
+    depths.resize_discard(n);
+    std::fill(depths.begin(), depths.end(), -1);
+    RawVector<int> chain;
+    for (int i = 0; i < n; ++i) {
+        int e = i;
+        while (e != -1 && depths[e] == -1) {
+            chain.push_back(e);
+            e = parents[e];
+        }
+        int d = e == -1 ? -1 : depths[e];
+        while (!chain.empty()) {
+            depths[chain.back()] = ++d;
+            chain.pop_back();
+        }
+    }
+
+    // sort by depth. the sort is stable, so entities in each level keep their order.
+    RawVector<uint32_t> keys;
+    keys.resize_discard(n);
+    order.resize_discard(n);
+    for (int i = 0; i < n; ++i) {
+        keys[i] = (uint32_t)depths[i];
+        order[i] = i;
+    }
+    RadixSort(keys.data(), order.data(), n);
+
+    int num_levels = n > 0 ? (int)keys[n - 1] + 1 : 0;
+    level_offsets.resize_discard(num_levels + 1);
+    Histogram(level_offsets.data(), num_levels, n, [&](int i) { return depths[i]; });
+    level_offsets[num_levels] = 0;
+    ExclusiveScan(level_offsets.data(), level_offsets.data(), num_levels + 1);
+
+    // parents in sorted order
+    RawVector<int> ranks;
+    ranks.resize_discard(n);
+    parallel_for_blocked(0, n, kParallelBlockSize, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            ranks[order[i]] = i;
+    });
+    m_sorted_parents.resize_discard(n);
+    parallel_for_blocked(0, n, kParallelBlockSize, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            int parent = parents[order[i]];
+            m_sorted_parents[i] = parent == -1 ? -1 : ranks[parent];
+        }
+    });
+}
+
+void SceneHierarchy::updateWorldMatrices()
+{
+    const int block_size = 1024;
+    int n = (int)m_entities.size();
+    m_local.resize_discard(n);
+    m_world.resize_discard(n);
+    m_parent_world.resize_discard(n);
+    world_matrices.resize_discard(n);
+    if (n == 0)
+        return;
+
+    parallel_for_blocked(0, n, block_size, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            m_local[i] = m_entities[order[i]]->toMatrix();
+    });
+
+    // roots. parents of the other levels are all in upper levels.
+    int num_roots = level_offsets[1];
+    std::copy(m_local.begin(), m_local.begin() + num_roots, m_world.begin());
+    int num_levels = (int)level_offsets.size() - 1;
+    for (int l = 1; l < num_levels; ++l) {
+        parallel_for_blocked(level_offsets[l], level_offsets[l + 1], block_size, [&](int begin, int end) {
+            Gather(&m_parent_world[begin], m_world.data(), &m_sorted_parents[begin], end - begin);
+            MulMatrices(&m_local[begin], &m_parent_world[begin], &m_world[begin], end - begin);
+        });
+    }
+    Scatter(world_matrices.data(), m_world.data(), order.data(), n);
+}
+
+#pragma endregion
+
+
 // Scene
 #pragma region Scene
 
@@ -41,6 +218,7 @@ void Scene::deserialize(std::istream& is)
     uint64_t validation_hash;
     read(is, validation_hash);
     EachMember(msRead);
+    invalidateHierarchy();
     if (validation_hash != hash()) {
         throw std::runtime_error("scene hash doesn't match");
     }
@@ -52,6 +230,8 @@ void Scene::clear()
     assets.clear();
     entities.clear();
     constraints.clear();
+    m_hierarchy.clear();
+    invalidateHierarchy();
 }
 
 uint64_t Scene::hash() const
@@ -66,10 +246,13 @@ uint64_t Scene::hash() const
 
 void Scene::lerp(const Scene& s1, const Scene& s2, float t)
 {
+    auto& h2 = s2.getHierarchy();
     entities.resize(s1.entities.size());
-    parallel_for(0, (int)entities.size(), 10, [this, &s1, &s2, t](int i) {
+    parallel_for(0, (int)entities.size(), 10, [this, &s1, &s2, &h2, t](int i) {
         auto e1 = s1.entities[i];
-        if (auto e2 = s2.findEntity(e1->path)) {
+        int i2 = h2.findEntityIndex(e1->path);
+        if (i2 != -1) {
+            auto e2 = s2.entities[i2];
             auto e3 = e1->clone();
             e3->lerp(*e1, *e2, t);
             entities[i] = std::static_pointer_cast<Transform>(e3);
@@ -78,6 +261,7 @@ void Scene::lerp(const Scene& s1, const Scene& s2, float t)
             entities[i] = e1;
         }
     });
+    invalidateWorldMatrices();
 }
 
 TransformPtr Scene::findEntity(const std::string& path) const
@@ -92,6 +276,70 @@ TransformPtr Scene::findEntity(const std::string& path) const
     return ret;
 }
 
+const SceneHierarchy& Scene::getHierarchy() const
+{
+    if (m_hierarchy_dirty || !m_hierarchy.isValid(entities)) {
+        m_hierarchy.build(entities);
+        m_hierarchy_dirty = false;
+        m_world_matrices_dirty = true;
+    }
+    return m_hierarchy;
+}
+
+const RawVector<float4x4>& Scene::getWorldMatrices() const
+{
+    getHierarchy();
+    if (m_world_matrices_dirty) {
+        m_hierarchy.updateWorldMatrices();
+        m_world_matrices_dirty = false;
+    }
+    return m_hierarchy.world_matrices;
+}
+
+void Scene::invalidateHierarchy()
+{
+    m_hierarchy_dirty = true;
+    m_world_matrices_dirty = true;
+}
+
+void Scene::invalidateWorldMatrices()
+{
+    m_world_matrices_dirty = true;
+}
+
+void Scene::bakeSkin()
+{
+    // transforms and paths may have been modified in place since the last call (e.g. by the C API setters)
+    invalidateHierarchy();
+    auto& hierarchy = getHierarchy();
+    auto& world_matrices = getWorldMatrices();
+
+    RawVector<float4x4> bone_matrices;
+    for (size_t ei = 0; ei < entities.size(); ++ei) {
+        auto& e = entities[ei];
+        if (e->getType() != Entity::Type::Mesh)
+            continue;
+        auto& mesh = static_cast<Mesh&>(*e);
+        if (mesh.bones.empty()) {
+            mesh.bakeBlendShapes();
+            continue;
+        }
+
+        bool complete = true;
+        bone_matrices.resize_discard(mesh.bones.size());
+        for (size_t bi = 0; bi < mesh.bones.size(); ++bi) {
+            int bone = hierarchy.findEntityIndex(mesh.bones[bi]->path);
+            if (bone == -1) {
+                complete = false;
+                break;
+            }
+            bone_matrices[bi] = world_matrices[bone];
+        }
+        if (complete)
+            mesh.bakeSkin(bone_matrices, invert(world_matrices[ei]), (int)mesh.refine_settings.max_bone_influence);
+    }
+}
+
 template<class AssetType>
 std::vector<std::shared_ptr<AssetType>> Scene::getAssets() const
 {
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include "MeshUtils/MeshUtils.h"
 #include "msFoundation.h"
 
@@ -38,6 +39,37 @@ struct SceneSettings
 };
 msSerializable(SceneSettings);
 
+// parent-index array of scene entities built from their paths, and local to world matrices computed from it.
+// entities are sorted by depth, and world matrices are computed level by level in parallel.
+class SceneHierarchy
+{
+public:
+    void clear();
+    // true if entities are the same objects in the same order as the last build()
+    bool isValid(const std::vector<TransformPtr>& entities) const;
+    void build(const std::vector<TransformPtr>& entities);
+    void updateWorldMatrices();
+    // index of the entity with path in the entities passed to build(), or -1
+    int findEntityIndex(const std::string& path) const;
+
+public:
+    // entity index -> parent entity index. the parent is the nearest ancestor (by path) that exists in entities. -1 if none.
+    RawVector<int> parents;
+    // entity index -> depth (number of ancestors that exist in entities)
+    RawVector<int> depths;
+    // entity indices sorted by depth. entities in level l are order[level_offsets[l] ... level_offsets[l+1]-1].
+    RawVector<int> order;
+    RawVector<int> level_offsets;
+    // entity index -> local to world matrix. valid after updateWorldMatrices().
+    RawVector<float4x4> world_matrices;
+
+private:
+    std::vector<Transform*> m_entities;
+    std::unordered_multimap<uint64_t, int> m_path_table; // path hash -> entity index
+    RawVector<int> m_sorted_parents; // position in order -> position of the parent in order
+    RawVector<float4x4> m_local, m_world, m_parent_world; // in sorted order
+};
+
 struct Scene
 {
 public:
@@ -56,8 +88,27 @@ public:
     void lerp(const Scene& src1, const Scene& src2, float t);
 
     TransformPtr findEntity(const std::string& path) const;
+
+    // these are built on demand and cached. the hierarchy is rebuilt automatically when entities are added, removed or
+    // replaced, but invalidateHierarchy() must be called after paths are modified in place, and invalidateWorldMatrices()
+    // after transforms are modified in place. not thread safe.
+    const SceneHierarchy& getHierarchy() const;
+    // local to world matrix of each entity in entities.
+    const RawVector<float4x4>& getWorldMatrices() const;
+    void invalidateHierarchy();
+    void invalidateWorldMatrices();
+
+    // bake the current pose of meshes: apply blendshape weights and skinning by transforms of bones in this scene.
+    // skinning of meshes whose bones are not all in this scene is skipped.
+    // the hierarchy and world matrices are always rebuilt, so in-place modifications don't need invalidation.
+    void bakeSkin();
     template<class AssetType> std::vector<std::shared_ptr<AssetType>> getAssets() const;
     template<class EntityType> std::vector<std::shared_ptr<EntityType>> getEntities() const;
+
+private:
+    mutable SceneHierarchy m_hierarchy;
+    mutable bool m_hierarchy_dirty = true;
+    mutable bool m_world_matrices_dirty = true;
 };
 msSerializable(Scene);
 msDeclPtr(Scene);
@@ -141,6 +141,9 @@ void AsyncSceneSender::send()
 
     // animations
     if (!animations.empty()) {
+        for (auto& clip : animations)
+            clip->encode(curve_encoding);
+
         ms::SetMessage mes;
         setup_message(mes);
         mes.scene.settings = scene_settings;
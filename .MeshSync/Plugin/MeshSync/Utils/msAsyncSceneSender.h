@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../msClient.h"
+#include "../SceneGraph/msAnimation.h"
 
 namespace ms {
 
@@ -18,6 +19,8 @@ public:
     std::vector<TransformPtr> transforms;
     std::vector<TransformPtr> geometries;
     std::vector<AnimationClipPtr> animations;
+    // animations are encoded in place before they are sent
+    CurveEncodingSettings curve_encoding;
 
     std::vector<Identifier> deleted_entities;
     std::vector<Identifier> deleted_materials;
@@ -497,6 +497,7 @@ void Server::recvSet(HTTPServerRequest& request, HTTPServerResponse& response)
                 mesh.refine_settings.flags.optimize_topology = 1;
                 mesh.refine_settings.split_unit = m_settings.mesh_split_unit;
                 mesh.refine_settings.max_bone_influence = m_settings.mesh_max_bone_influence;
+                mesh.refine_settings.vertex_format = m_settings.mesh_vertex_format;
                 mesh.refine(mesh.refine_settings);
             }
             else {
@@ -514,6 +515,7 @@ void Server::recvSet(HTTPServerRequest& request, HTTPServerResponse& response)
                 continue;
 
             auto clip = std::static_pointer_cast<AnimationClip>(asset);
+            clip->decode();
             parallel_for_each(clip->animations.begin(), clip->animations.end(), [this, &mes, flip_x, swap_yz](AnimationPtr& anim) {
                 sanitizeHierarchyPath(anim->path);
                 if (flip_x || swap_yz) {
@@ -24,6 +24,8 @@ struct ServerSettings
     uint16_t port = 8080;
     uint32_t mesh_split_unit = 0xffffffff;
     int mesh_max_bone_influence = 4; // -1 (variable) or 4
+    // if not Unknown, meshes also have interleaved vertices in this format. the Unity side doesn't consume them yet.
+    VertexFormat mesh_vertex_format = VertexFormat::Unknown;
 };
 
 class Server
@@ -706,6 +706,31 @@ msAPI ms::SubmeshData* msMeshGetSubmesh(ms::Mesh *self, int i)
 {
     return &self->submeshes[i];
 }
+msAPI int msMeshGetNumLODs(ms::Mesh *self)
+{
+    return self->submeshes.empty() ? 0 : (int)(self->lod_submeshes.size() / self->submeshes.size());
+}
+msAPI uint64_t msMeshGetRefinePeakMemory(ms::Mesh *self)
+{
+    return self->refine_peak_memory;
+}
+msAPI ms::VertexFormat msMeshGetVertexFormat(ms::Mesh *self)
+{
+    return self->vertex_format;
+}
+msAPI int msMeshGetVertexStride(ms::Mesh *self)
+{
+    return (int)mu::GetVertexSize(self->vertex_format);
+}
+// copy interleaved vertices. dst must have room for vertex count * stride bytes.
+msAPI void msMeshReadVertices(ms::Mesh *self, void *dst, ms::SplitData *split)
+{
+    size_t stride = mu::GetVertexSize(self->vertex_format);
+    if (split)
+        self->vertices_interleaved.copy_to((char*)dst, split->vertex_count * stride, split->vertex_offset * stride);
+    else
+        self->vertices_interleaved.copy_to((char*)dst);
+}
 
 msAPI void msMeshReadBoneWeights4(ms::Mesh *self, ms::Weights4 *dst, ms::SplitData *split)
 {
@@ -806,6 +831,10 @@ msAPI void msMeshWriteBindPoses(ms::Mesh *self, const float4x4 *v, int size)
         self->bones[bi]->bindpose = v[bi];
     }
 }
+msAPI void msMeshBakeSkin(ms::Mesh *self, const float4x4 *bone_matrices, int num_bones, const float4x4 *world2local)
+{
+    self->bakeSkin({ bone_matrices, (size_t)num_bones }, *world2local);
+}
 
 msAPI int msMeshGetNumBlendShapes(ms::Mesh *self)
 {
@@ -861,6 +890,14 @@ msAPI ms::SubmeshData* msSplitGetSubmesh(ms::SplitData *self, int i)
 {
     return &self->submeshes[i];
 }
+msAPI ms::SubmeshData* msSplitGetLODSubmesh(ms::SplitData *self, int lod, int i)
+{
+    return &self->lod_submeshes[lod * self->submeshes.size() + i];
+}
+msAPI ms::IndexFormat msSplitGetIndexFormat(ms::SplitData *self)
+{
+    return self->index_format;
+}
 
 msAPI int msSubmeshGetNumIndices(ms::SubmeshData *self)
 {
@@ -870,6 +907,14 @@ msAPI void msSubmeshReadIndices(ms::SubmeshData *self, int *dst)
 {
     self->indices.copy_to(dst);
 }
+msAPI ms::IndexFormat msSubmeshGetIndexFormat(ms::SubmeshData *self)
+{
+    return self->index_format;
+}
+msAPI void msSubmeshReadIndices16(ms::SubmeshData *self, uint16_t *dst)
+{
+    self->indices16.copy_to(dst);
+}
 msAPI int msSubmeshGetMaterialID(ms::SubmeshData *self)
 {
     return self->material_id;
@@ -903,11 +948,40 @@ msAPI float msBlendShapeGetFrameWeight(ms::BlendShapeData *self, int f)
 {
     return self ? self->frames[f]->weight : 0.0f;
 }
-msAPI void msBlendShapeReadPoints(ms::BlendShapeData *self, int f, float3 *dst, ms::SplitData *split)
+// expand dense or sparse frame data. sparse data is scattered into a zero-cleared buffer.
+// without split, dst must have the vertex count of the mesh.
+static void ReadBlendShapeFrameData(const ms::BlendShapeFrameData& frame, const RawVector<float3>& dense, const RawVector<float3>& sparse, float3 *dst, ms::SplitData *split)
 {
-    auto& frame = *self->frames[f];
     size_t size = std::max(frame.points.size(), std::max(frame.normals.size(), frame.tangents.size()));
-    auto& src = frame.points;
+    size = std::max(size, (size_t)frame.num_vertices);
+
+    if (frame.isSparse() && dense.empty()) {
+        int begin = 0, end = 0;
+        if (split) {
+            begin = split->vertex_offset;
+            end = split->vertex_offset + split->vertex_count;
+        }
+        else {
+            // the whole buffer is cleared. vertices after the last sparse index must not keep stale data.
+            // the vertex count is unknown until the frame is refined, so unrefined frames must be read with a split.
+            if (size == 0)
+                return;
+            end = (int)size;
+        }
+        memset(dst, 0, sizeof(float3)*(end - begin));
+        if (sparse.size() != frame.sparse_indices.size())
+            return;
+
+        size_t n = sparse.size();
+        for (size_t i = 0; i < n; ++i) {
+            int vi = frame.sparse_indices[i];
+            if (vi >= begin && vi < end)
+                dst[vi - begin] = sparse[i];
+        }
+        return;
+    }
+
+    auto& src = dense;
     if (split)
         if (src.empty())
             memset(dst, 0, sizeof(float3)*split->vertex_count);
@@ -919,37 +993,24 @@ msAPI void msBlendShapeReadPoints(ms::BlendShapeData *self, int f, float3 *dst,
         else
             src.copy_to(dst);
 }
+msAPI void msBlendShapeReadPoints(ms::BlendShapeData *self, int f, float3 *dst, ms::SplitData *split)
+{
+    auto& frame = *self->frames[f];
+    ReadBlendShapeFrameData(frame, frame.points, frame.sparse_points, dst, split);
+}
 msAPI void msBlendShapeReadNormals(ms::BlendShapeData *self, int f, float3 *dst, ms::SplitData *split)
 {
     auto& frame = *self->frames[f];
-    size_t size = std::max(frame.points.size(), std::max(frame.normals.size(), frame.tangents.size()));
-    auto& src = frame.normals;
-    if (split)
-        if (src.empty())
-            memset(dst, 0, sizeof(float3)*split->vertex_count);
-        else
-            src.copy_to(dst, split->vertex_count, split->vertex_offset);
-    else
-        if (src.empty())
-            memset(dst, 0, sizeof(float3)*size);
-        else
-            src.copy_to(dst);
+    ReadBlendShapeFrameData(frame, frame.normals, frame.sparse_normals, dst, split);
 }
 msAPI void msBlendShapeReadTangents(ms::BlendShapeData *self, int f, float3 *dst, ms::SplitData *split)
 {
     auto& frame = *self->frames[f];
-    size_t size = std::max(frame.points.size(), std::max(frame.normals.size(), frame.tangents.size()));
-    auto& src = frame.tangents;
-    if (split)
-        if (src.empty())
-            memset(dst, 0, sizeof(float3)*split->vertex_count);
-        else
-            src.copy_to(dst, split->vertex_count, split->vertex_offset);
-    else
-        if (src.empty())
-            memset(dst, 0, sizeof(float3)*size);
-        else
-            src.copy_to(dst);
+    ReadBlendShapeFrameData(frame, frame.tangents, frame.sparse_tangents, dst, split);
+}
+msAPI int msBlendShapeGetNumSparseDeltas(ms::BlendShapeData *self, int f)
+{
+    return self ? (int)self->frames[f]->sparse_indices.size() : 0;
 }
 msAPI void msBlendShapeAddFrame(ms::BlendShapeData *self, float weight, int num, const float3 *v, const float3 *n, const float3 *t)
 {
@@ -960,6 +1021,16 @@ msAPI void msBlendShapeAddFrame(ms::BlendShapeData *self, float weight, int num,
     if (n) frame.normals.assign(n, n + num);
     if (t) frame.tangents.assign(t, t + num);
 }
+msAPI void msBlendShapeAddSparseFrame(ms::BlendShapeData *self, float weight, int num, const int *indices, const float3 *v, const float3 *n, const float3 *t)
+{
+    self->frames.push_back(ms::BlendShapeFrameData::create());
+    auto& frame = *self->frames.back();
+    frame.weight = weight;
+    frame.sparse_indices.assign(indices, indices + num);
+    if (v) frame.sparse_points.assign(v, v + num);
+    if (n) frame.sparse_normals.assign(n, n + num);
+    if (t) frame.sparse_tangents.assign(t, t + num);
+}
 #pragma endregion
 
 #pragma region Points
@@ -1089,4 +1160,5 @@ msAPI int               msSceneGetNumEntities(ms::Scene *self)         { return
 msAPI ms::Transform*    msSceneGetEntity(ms::Scene *self, int i)       { return self->entities[i].get(); }
 msAPI int               msSceneGetNumConstraints(ms::Scene *self)      { return (int)self->constraints.size(); }
 msAPI ms::Constraint*   msSceneGetConstraint(ms::Scene *self, int i)   { return self->constraints[i].get(); }
+msAPI void              msSceneBakeSkin(ms::Scene *self)               { self->bakeSkin(); }
 #pragma endregion
@@ -255,6 +255,73 @@ static inline void UpdateTangents(IArray<KF>& curve, int index)
         key.out_tangent = std::numeric_limits<float>::infinity();
 }
 
+// division that returns 0 instead of inf. written with selects rather than a branch so that loops can be vectorized.
+static inline float SafeDivV(float y, float x)
+{
+    bool valid = std::abs(x) > kCurveTimeEpsilon;
+    float r = y / (valid ? x : 1.0f);
+    return valid ? r : 0.0f;
+}
+
+// tangents of all keys at once. gives the same results as calling UpdateTangents() for each key when all keys have
+// the same tangent mode, which is always the case in SetTangentMode().
+// keys are in SoA and each loop is free of branches and dependencies between iterations, so these are auto-vectorized.
+static void ComputeTangents(const float *times, const float *values, float *in_tangents, float *out_tangents, int n, InterpolationMode im)
+{
+    if (im == Constant) {
+        const float inf = std::numeric_limits<float>::infinity();
+        for (int i = 0; i < n; ++i) {
+            in_tangents[i] = inf;
+            out_tangents[i] = inf;
+        }
+        return;
+    }
+    if (n < 2)
+        return;
+
+    if (im == Linear) {
+        // in_tangents[0] and out_tangents[n-1] are left untouched as UpdateTangents() does
+        for (int i = 0; i < n - 1; ++i) {
+            float dt = times[i + 1] - times[i];
+            float t = (values[i + 1] - values[i]) / (std::abs(dt) < kTimeEpsilon ? 1.0f : dt);
+            t = std::abs(dt) < kTimeEpsilon ? 0.0f : t;
+            out_tangents[i] = t;
+            in_tangents[i + 1] = t;
+        }
+        return;
+    }
+
+    // clamped auto (SmoothTangents() with bias 0.5)
+    const float lower_bias = 0.25f;
+    const float upper_bias = 0.75f;
+    in_tangents[0] = out_tangents[0] = 0.0f;
+    in_tangents[n - 1] = out_tangents[n - 1] = 0.0f;
+    for (int i = 1; i < n - 1; ++i) {
+        float dx1 = times[i] - times[i - 1];
+        float dy1 = values[i] - values[i - 1];
+        float dx2 = times[i + 1] - times[i];
+        float dy2 = values[i + 1] - values[i];
+        float dx = dx1 + dx2;
+        float dy = dy1 + dy2;
+
+        float m1 = SafeDivV(dy1, dx1);
+        float m2 = SafeDivV(dy2, dx2);
+        float m = SafeDivV(dy, dx);
+
+        float lower_dy = dy * lower_bias;
+        float upper_dy = dy * upper_bias;
+        float mp_upper = (1.0f - SafeDivV(dy1 - upper_dy, lower_dy)) * m;
+        float mp_lower = SafeDivV(dy1, lower_dy) * m;
+
+        float mp = std::abs(dy1) >= std::abs(upper_dy) ? mp_upper :
+            (std::abs(dy1) < std::abs(lower_dy) ? mp_lower : m);
+        bool monotonic = (m1 > 0 && m2 > 0) || (m1 < 0 && m2 < 0);
+        mp = monotonic ? mp : 0.0f;
+        in_tangents[i] = mp;
+        out_tangents[i] = mp;
+    }
+}
+
 template<class KF>
 static void SetTangentMode(KF *key, int n, InterpolationMode im)
 {
@@ -265,6 +332,14 @@ static void SetTangentMode(KF *key, int n, InterpolationMode im)
     default: tangent_mode = kTangentModeClampedAuto; break;
     }
 
+    // keys are transposed to SoA, tangents are computed all at once and written back.
+    RawVector<float> buf;
+    buf.resize_discard(n * 4);
+    float *times = buf.data();
+    float *values = times + n;
+    float *in_tangents = values + n;
+    float *out_tangents = in_tangents + n;
+
     for (int i = 0; i < n; ++i) {
         auto& k = key[i];
         int tm = k.getTangentMode();
@@ -277,11 +352,20 @@ static void SetTangentMode(KF *key, int n, InterpolationMode im)
 
         k.setInWeight(kDefaultWeight);
         k.setOutWeight(kDefaultWeight);
+
+        times[i] = k.time;
+        values[i] = k.value;
+        in_tangents[i] = k.in_tangent;
+        out_tangents[i] = k.out_tangent;
     }
 
-    IArray<KF> curve{ key, (size_t)n };
-    for (int i = 0; i < n; ++i)
-        UpdateTangents(curve, i);
+    ComputeTangents(times, values, in_tangents, out_tangents, n, im);
+
+    for (int i = 0; i < n; ++i) {
+        auto& k = key[i];
+        k.in_tangent = in_tangents[i];
+        k.out_tangent = out_tangents[i];
+    }
 }
 
 template<class KF>
@@ -463,7 +547,7 @@ msAPI void msSetSizeOfKeyframe(int v)
 #define Switch(Func, ...)\
     switch (g_sizeof_keyframe) {\
         case sizeof(Keyframe_EW): Func<Keyframe_EW>(__VA_ARGS__); break;\
-        case sizeof(Keyframe_RW): Func<Keyframe_EW>(__VA_ARGS__); break;\
+        case sizeof(Keyframe_RW): Func<Keyframe_RW>(__VA_ARGS__); break;\
         case sizeof(Keyframe_E): Func<Keyframe_E>(__VA_ARGS__); break;\
         case sizeof(Keyframe_R): Func<Keyframe_R>(__VA_ARGS__); break;\
         default: return false;\
@@ -518,4 +602,122 @@ msAPI bool msCurveFillEuler(ms::AnimationCurve *self, void *x, void *y, void *z,
     Switch(FillCurvesEuler, ms::TAnimationCurve<quatf>(*self), x, y, z, it);
     return true;
 }
+
+
+// batched version of msCurveFill*(). fills all curves of a clip in one call, in parallel across curves.
+// keyframes of all curves are packed into one buffer in the order of animations and their curves. a curve occupies
+// (number of components * number of keys) keyframes and its components (x, y, z, w) are stored one after another.
+// quaternion curves are converted to euler unless it is Smooth, as AnimationData.GenCurves() on the C# side does.
+
+static int GetNumComponents(const ms::AnimationCurve& curve, InterpolationMode it)
+{
+    switch (curve.data_type) {
+    case ms::AnimationCurve::DataType::Int: return 1;
+    case ms::AnimationCurve::DataType::Float: return 1;
+    case ms::AnimationCurve::DataType::Float2: return 2;
+    case ms::AnimationCurve::DataType::Float3: return 3;
+    case ms::AnimationCurve::DataType::Float4: return 4;
+    case ms::AnimationCurve::DataType::Quaternion: return it == Smooth ? 4 : 3;
+    default: return 0;
+    }
+}
+
+static void GatherCurves(ms::AnimationClip& clip, std::vector<ms::AnimationCurve*>& dst)
+{
+    dst.clear();
+    for (auto& anim : clip.animations)
+        for (auto& curve : anim->curves)
+            dst.push_back(curve.get());
+}
+
+// offsets[i] = first keyframe of curves[i]. returns the total number of keyframes.
+static int GetCurveOffsets(ms::AnimationCurve * const *curves, int *offsets, int num_curves, InterpolationMode it)
+{
+    return ExclusiveScan(offsets, num_curves, [&](int ci) {
+        return GetNumComponents(*curves[ci], it) * (int)curves[ci]->size();
+    });
+}
+
+template<class KF>
+static void FillClipCurves(ms::AnimationCurve * const *curves, const int *offsets, int num_curves, void *dst_, InterpolationMode it)
+{
+    KF *dst = (KF*)dst_;
+    parallel_for(0, num_curves, [&](int ci) {
+        const auto& curve = *curves[ci];
+        int n = (int)curve.size();
+        if (n == 0)
+            return;
+
+        KF *x = dst + offsets[ci];
+        KF *y = x + n;
+        KF *z = y + n;
+        KF *w = z + n;
+        switch (curve.data_type) {
+        case ms::AnimationCurve::DataType::Int:
+            FillCurve<KF>(ms::TAnimationCurve<int>(curve), x, it);
+            break;
+        case ms::AnimationCurve::DataType::Float:
+            FillCurve<KF>(ms::TAnimationCurve<float>(curve), x, it);
+            break;
+        case ms::AnimationCurve::DataType::Float2:
+            FillCurves<KF>(ms::TAnimationCurve<float2>(curve), x, y, it);
+            break;
+        case ms::AnimationCurve::DataType::Float3:
+            FillCurves<KF>(ms::TAnimationCurve<float3>(curve), x, y, z, it);
+            break;
+        case ms::AnimationCurve::DataType::Float4:
+            FillCurves<KF>(ms::TAnimationCurve<float4>(curve), x, y, z, w, it);
+            break;
+        case ms::AnimationCurve::DataType::Quaternion:
+            if (GetNumComponents(curve, it) == 3)
+                FillCurvesEuler<KF>(ms::TAnimationCurve<quatf>(curve), x, y, z, it);
+            else
+                FillCurves<KF>(ms::TAnimationCurve<quatf>(curve), x, y, z, w, it);
+            break;
+        default:
+            break;
+        }
+    });
+}
+
+msAPI int msAnimationClipGetNumCurves(ms::AnimationClip *self)
+{
+    int ret = 0;
+    for (auto& anim : self->animations)
+        ret += (int)anim->curves.size();
+    return ret;
+}
+
+// curves and offsets must have msAnimationClipGetNumCurves() elements. returns the total number of keyframes.
+msAPI int msAnimationClipGetCurveLayout(ms::AnimationClip *self, ms::AnimationCurve **curves, int *offsets, InterpolationMode it)
+{
+    std::vector<ms::AnimationCurve*> tmp;
+    GatherCurves(*self, tmp);
+    int num_curves = (int)tmp.size();
+    if (curves)
+        std::copy(tmp.begin(), tmp.end(), curves);
+    if (offsets)
+        return GetCurveOffsets(tmp.data(), offsets, num_curves, it);
+
+    RawVector<int> tmp_offsets;
+    tmp_offsets.resize_discard(num_curves);
+    return GetCurveOffsets(tmp.data(), tmp_offsets.data(), num_curves, it);
+}
+
+// dst must have the number of keyframes msAnimationClipGetCurveLayout() returned with the same it.
+msAPI bool msAnimationClipFillCurves(ms::AnimationClip *self, void *dst, InterpolationMode it)
+{
+    // typed access requires plain curves
+    self->decode();
+
+    std::vector<ms::AnimationCurve*> curves;
+    GatherCurves(*self, curves);
+    int num_curves = (int)curves.size();
+    RawVector<int> offsets;
+    offsets.resize_discard(num_curves);
+    GetCurveOffsets(curves.data(), offsets.data(), num_curves, it);
+
+    Switch(FillClipCurves, curves.data(), offsets.data(), num_curves, dst, it);
+    return true;
+}
 #undef Switch
@@ -5,32 +5,62 @@
 
 namespace mu {
 
+// face normals are computed in parallel. accumulation to vertices stays serial and in face order,
+// so results don't depend on the number of threads.
+static void GenerateFaceNormals(RawVector<float3>& dst,
+    const IArray<float3> points, const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices, bool flip)
+{
+    const int num_faces = (int)counts.size();
+    const int i1 = flip ? 2 : 1;
+    const int i2 = flip ? 1 : 2;
+
+    dst.resize_discard(num_faces);
+    parallel_for_blocked(0, num_faces, kParallelBlockSize, [&](int begin, int end) {
+        for (int fi = begin; fi < end; ++fi) {
+            int count = counts[fi];
+            if (count < 3) {
+                dst[fi] = float3::zero();
+                continue;
+            }
+
+            const int *face = &indices[offsets[fi]];
+            float3 p0 = points[face[0]];
+            float3 p1 = points[face[i1]];
+            float3 p2 = points[face[i2]];
+            dst[fi] = cross(p1 - p0, p2 - p0);
+        }
+    });
+}
+
 bool GenerateNormalsPoly(RawVector<float3>& dst,
     const IArray<float3> points, const IArray<int> counts, const IArray<int> indices, bool flip)
+{
+    RawVector<int> offsets;
+    offsets.resize_discard(counts.size());
+    ExclusiveScan(offsets.data(), counts.data(), (int)counts.size());
+    return GenerateNormalsPoly(dst, points, counts, offsets, indices, flip);
+}
+
+bool GenerateNormalsPoly(RawVector<float3>& dst,
+    const IArray<float3> points, const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices, bool flip)
 {
     const size_t num_faces = counts.size();
-    const int i1 = flip ? 2 : 1;
-    const int i2 = flip ? 1 : 2;
+
+    RawVector<float3> face_normals;
+    GenerateFaceNormals(face_normals, points, counts, offsets, indices, flip);
 
     dst.resize_discard(points.size());
     dst.zeroclear();
-
-    int offset = 0;
-    for (size_t fi = 0; fi < num_faces; ++fi)
-    {
+    for (size_t fi = 0; fi < num_faces; ++fi) {
         int count = counts[fi];
         if (count < 3)
             continue;
 
-        const int *face = &indices[offset];
-        float3 p0 = points[face[0]];
-        float3 p1 = points[face[i1]];
-        float3 p2 = points[face[i2]];
-        float3 n = cross(p1 - p0, p2 - p0);
+        const int *face = &indices[offsets[fi]];
+        float3 n = face_normals[fi];
         for (int ci = 0; ci < count; ++ci) {
             dst[face[ci]] += n;
         }
-        offset += count;
     }
     Normalize(dst.data(), dst.size());
     return true;
@@ -38,60 +68,53 @@ bool GenerateNormalsPoly(RawVector<float3>& dst,
 
 void GenerateNormalsWithSmoothAngle(RawVector<float3>& dst,
     const IArray<float3> points, const IArray<int> counts, const IArray<int> indices, float smooth_angle, bool flip)
+{
+    RawVector<int> offsets;
+    offsets.resize_discard(counts.size());
+    ExclusiveScan(offsets.data(), counts.data(), (int)counts.size());
+    GenerateNormalsWithSmoothAngle(dst, points, counts, offsets, indices, smooth_angle, flip);
+}
+
+void GenerateNormalsWithSmoothAngle(RawVector<float3>& dst,
+    const IArray<float3> points, const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices,
+    float smooth_angle, bool flip)
 {
     MeshConnectionInfo connection;
     connection.buildConnection(indices, counts, points);
 
-    const size_t num_faces = counts.size();
-    const int i1 = flip ? 2 : 1;
-    const int i2 = flip ? 1 : 2;
+    const int num_faces = (int)counts.size();
 
     // gen face normals
-    int offset = 0;
     RawVector<float3> face_normals;
-    face_normals.resize_zeroclear(num_faces);
-    for (size_t fi = 0; fi < num_faces; ++fi)
-    {
-        int count = counts[fi];
-        if (count < 3)
-            continue;
-
-        const int *face = &indices[offset];
-        float3 p0 = points[face[0]];
-        float3 p1 = points[face[i1]];
-        float3 p2 = points[face[i2]];
-        float3 n = cross(p1 - p0, p2 - p0);
-        face_normals[fi] = n;
-        offset += count;
-    }
+    GenerateFaceNormals(face_normals, points, counts, offsets, indices, flip);
     Normalize(face_normals.data(), face_normals.size());
 
-    // gen vertex normals
+    // gen vertex normals. each corner is written once, so faces can be processed in parallel
     dst.resize_discard(indices.size());
     dst.zeroclear();
-    offset = 0;
     const float angle = std::cos(smooth_angle * DegToRad) - 0.001f;
-    for (size_t fi = 0; fi < num_faces; ++fi)
-    {
-        int count = counts[fi];
-        if (count < 3)
-            continue;
+    parallel_for_blocked(0, num_faces, kParallelBlockSize, [&](int begin, int end) {
+        for (int fi = begin; fi < end; ++fi) {
+            int count = counts[fi];
+            if (count < 3)
+                continue;
 
-        const int *face = &indices[offset];
-        auto& face_normal = face_normals[fi];
-        for (int ci = 0; ci < count; ++ci) {
-            int vi = face[ci];
-            auto normal = float3::zero();
-            connection.eachConnectedFaces(vi, [&](int fi2, int) {
-                float3 n = face_normals[fi2];
-                if (dot(face_normal, n) > angle) {
-                    normal += n;
-                }
-            });
-            dst[offset + ci] = normal;
+            int offset = offsets[fi];
+            const int *face = &indices[offset];
+            auto& face_normal = face_normals[fi];
+            for (int ci = 0; ci < count; ++ci) {
+                int vi = face[ci];
+                auto normal = float3::zero();
+                connection.eachConnectedFaces(vi, [&](int fi2, int) {
+                    float3 n = face_normals[fi2];
+                    if (dot(face_normal, n) > angle) {
+                        normal += n;
+                    }
+                });
+                dst[offset + ci] = normal;
+            }
         }
-        offset += count;
-    }
+    });
 
     // normalize
     Normalize(dst.data(), dst.size());
@@ -99,34 +122,24 @@ void GenerateNormalsWithSmoothAngle(RawVector<float3>& dst,
 
 
 
-void QuadifyTriangles(const IArray<float3> points, const IArray<int> indices, bool full_search, float threshold_angle,
+void QuadifyTriangles(const IArray<float3> points, const IArray<int> indices, float threshold_angle,
     RawVector<int>& dst_indices, RawVector<int>& dst_counts)
 {
-    struct Connection
+    struct Edge
+    {
+        uint64_t key; // sorted vertex pair
+        int tindex;
+
+        bool operator<(const Edge& v) const { return key < v.key || (key == v.key && tindex < v.tindex); }
+    };
+    struct Candidate
     {
-        int nindex;
-        float nangle;
+        int tindex1, tindex2;
+        float diff;
         int quad[4];
-        bool merged;
     };
+
     int num_triangles = (int)indices.size() / 3;
-    RawVector<Connection> connections(num_triangles);
-
-    auto make_unique = [](int *begin, int *end) {
-        for (auto i = begin; i + 1 < end; ++i) {
-            auto p = std::find(i + 1, end, *i);
-            if (p != end) {
-                // shift elements
-                auto q = p + 1;
-                while (q != end)
-                    *p++ = std::move(*q++);
-                --end;
-            }
-            else
-                break;
-        }
-        return end;
-    };
 
     auto overlapped = [](const int *a, const int *b) {
         int i00 = a[0], i01 = a[1], i02 = a[2];
@@ -144,96 +157,129 @@ void QuadifyTriangles(const IArray<float3> points, const IArray<int> indices, bo
         return ret;
     };
 
-    parallel_for(0, num_triangles, 8192, [&](int ti1) {
-        auto& cd = connections[ti1];
-        cd.nindex = -1;
-        cd.nangle = 180.0f;
-        cd.merged = false;
+    // build edge adjacency. triangles sharing an edge are adjacent after sorting by the edge key.
+    RawVector<Edge> edges;
+    edges.resize_discard(num_triangles * 3);
+    parallel_for(0, num_triangles, 8192, [&](int ti) {
+        auto *tri = indices.data() + (ti * 3);
+        for (int i = 0; i < 3; ++i) {
+            uint32_t i0 = tri[i], i1 = tri[(i + 1) % 3];
+            if (i0 > i1)
+                std::swap(i0, i1);
+            edges[ti * 3 + i] = { ((uint64_t)i0 << 32) | i1, ti };
+        }
+    });
+    std::sort(edges.begin(), edges.end());
+
+    RawVector<Candidate> candidates;
+    for (size_t eb = 0; eb < edges.size();) {
+        size_t ee = eb + 1;
+        while (ee < edges.size() && edges[ee].key == edges[eb].key)
+            ++ee;
+        for (size_t e1 = eb; e1 < ee; ++e1) {
+            for (size_t e2 = e1 + 1; e2 < ee; ++e2) {
+                int ti1 = edges[e1].tindex, ti2 = edges[e2].tindex;
+                if (overlapped(&indices[ti1 * 3], &indices[ti2 * 3]) == 2)
+                    candidates.push_back({ ti1, ti2, FLT_MAX, {} });
+            }
+        }
+        eb = ee;
+    }
 
-        auto *tri1 = indices.data() + (ti1 * 3);
+    // score candidates by how close the quad is to a rectangle
+    parallel_for(0, (int)candidates.size(), 8192, [&](int ci) {
+        auto& cd = candidates[ci];
+        auto *tri1 = indices.data() + (cd.tindex1 * 3);
+        auto *tri2 = indices.data() + (cd.tindex2 * 3);
         const float3 normal1 = normalize(cross(points[tri1[1]] - points[tri1[0]], points[tri1[2]] - points[tri1[0]]));
+        float3 normal2 = normalize(cross(points[tri2[1]] - points[tri2[0]], points[tri2[2]] - points[tri2[0]]));
+        if (dot(normal1, normal2) < 0.0f)
+            return;
+
+        int quad[6];
+        std::copy(tri1, tri1 + 3, quad);
+        std::copy(tri2, tri2 + 3, quad + 3);
+        std::sort(quad, quad + 6);
+        std::unique(quad, quad + 6);
+
+        float3 qpoints[4];
+        for (int i = 0; i < 4; ++i)
+            qpoints[i] = points[quad[i]];
+
+        float3 center = float3::zero();
+        for (auto& v : qpoints)
+            center += v;
+        center *= 0.25f;
+
+        float angles[4]{
+            0.0f,
+            angle_between2_signed(qpoints[0], qpoints[1], center, normal1) * RadToDeg,
+            angle_between2_signed(qpoints[0], qpoints[2], center, normal1) * RadToDeg,
+            angle_between2_signed(qpoints[0], qpoints[3], center, normal1) * RadToDeg,
+        };
+
+        int cwi[4], quad_tmp[4];
+        std::iota(cwi, cwi + 4, 0);
+        std::sort(cwi, cwi + 4, [&angles](int a, int b) {
+            return angles[a] < angles[b];
+        });
+        for (int i = 0; i < 4; ++i) {
+            quad_tmp[i] = quad[cwi[i]];
+            qpoints[i] = points[quad_tmp[i]];
+        }
 
-        int ti2begin, ti2end;
-        if (full_search) {
-            ti2begin = std::max(ti1 - 1, 0);
-            ti2end = num_triangles;
+        int corners[4][3]{
+            { 3, 0, 1 },
+            { 0, 1, 2 },
+            { 1, 2, 3 },
+            { 2, 3, 0 }
+        };
+        float diff = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+            float angle = angle_between2(
+                qpoints[corners[i][0]],
+                qpoints[corners[i][2]],
+                qpoints[corners[i][1]]) * RadToDeg;
+            diff = std::max(diff, abs(angle - 90.0f));
         }
-        else {
-            ti2begin = std::max(ti1 - 1, 0);
-            ti2end = std::min(ti1 + 2, num_triangles);
+        if (diff < threshold_angle) {
+            cd.diff = diff;
+            std::copy(quad_tmp, quad_tmp + 4, cd.quad);
         }
+    });
+    candidates.erase(
+        std::remove_if(candidates.begin(), candidates.end(), [](const Candidate& c) { return c.diff == FLT_MAX; }),
+        candidates.end());
+
+    // greedy merge, best candidates first. scores don't change by merging, so a sorted list serves as the priority queue.
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.diff != b.diff)
+            return a.diff < b.diff;
+        if (a.tindex1 != b.tindex1)
+            return a.tindex1 < b.tindex1;
+        return a.tindex2 < b.tindex2;
+    });
 
-        for (int ti2 = ti2begin; ti2 != ti2end; ++ti2) {
-            auto *tri2 = indices.data() + (ti2 * 3);
-
-            if (overlapped(tri1, tri2) != 2)
-                continue;
-
-            float3 normal2 = normalize(cross(points[tri2[1]] - points[tri2[0]], points[tri2[2]] - points[tri2[0]]));
-            if (dot(normal1, normal2) < 0.0f)
-                continue;
-
-            int quad[6];
-            std::copy(tri1, tri1 + 3, quad);
-            std::copy(tri2, tri2 + 3, quad + 3);
-            std::sort(quad, quad + 6);
-            std::unique(quad, quad + 6);
-
-            float3 qpoints[4];
-            for (int i = 0; i < 4; ++i)
-                qpoints[i] = points[quad[i]];
-
-            float3 center = float3::zero();
-            for (auto& v : qpoints)
-                center += v;
-            center *= 0.25f;
-
-            float angles[4]{
-                0.0f,
-                angle_between2_signed(qpoints[0], qpoints[1], center, normal1) * RadToDeg,
-                angle_between2_signed(qpoints[0], qpoints[2], center, normal1) * RadToDeg,
-                angle_between2_signed(qpoints[0], qpoints[3], center, normal1) * RadToDeg,
-            };
-
-            int cwi[4], quad_tmp[4];
-            std::iota(cwi, cwi + 4, 0);
-            std::sort(cwi, cwi + 4, [&angles](int a, int b) {
-                return angles[a] < angles[b];
-            });
-            for (int i = 0; i < 4; ++i) {
-                quad_tmp[i] = quad[cwi[i]];
-                qpoints[i] = points[quad_tmp[i]];
-            }
-
-            int corners[4][3]{
-                { 3, 0, 1 },
-                { 0, 1, 2 },
-                { 1, 2, 3 },
-                { 2, 3, 0 }
-            };
-            float diff = 0.0f;
-            for (int i = 0; i < 4; ++i) {
-                float angle = angle_between2(
-                    qpoints[corners[i][0]],
-                    qpoints[corners[i][2]],
-                    qpoints[corners[i][1]]) * RadToDeg;
-                diff = std::max(diff, abs(angle - 90.0f));
-            }
-            if (diff < threshold_angle && diff < cd.nangle) {
-                cd.nindex = ti2;
-                cd.nangle = diff;
-                std::copy(quad_tmp, quad_tmp + 4, cd.quad);
-            }
+    // merged[ti]: -1: not merged, -2: merged into another triangle, otherwise: index of the candidate
+    RawVector<int> merged;
+    merged.resize(num_triangles, -1);
+    for (int ci = 0; ci < (int)candidates.size(); ++ci) {
+        auto& cd = candidates[ci];
+        if (merged[cd.tindex1] == -1 && merged[cd.tindex2] == -1) {
+            merged[cd.tindex1] = ci;
+            merged[cd.tindex2] = -2;
         }
-    });
+    }
 
+    dst_indices.reserve(dst_indices.size() + indices.size());
+    dst_counts.reserve(dst_counts.size() + num_triangles);
     for (int ti1 = 0; ti1 < num_triangles; ++ti1) {
-        auto& cd = connections[ti1];
-        if (cd.merged)
+        int m = merged[ti1];
+        if (m == -2)
             continue;
 
-        if (cd.nindex != -1 && !connections[cd.nindex].merged) {
-            connections[cd.nindex].merged = true;
+        if (m >= 0) {
+            auto& cd = candidates[m];
             dst_indices.insert(dst_indices.end(), cd.quad, cd.quad + 4);
             dst_counts.push_back(4);
         }
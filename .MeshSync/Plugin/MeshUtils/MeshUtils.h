@@ -15,7 +15,10 @@
 #include "muTLS.h"
 #include "muMisc.h"
 #include "muConcurrency.h"
+#include "muParallel.h"
 #include "muCompression.h"
+#include "muMeshOptimizer.h"
+#include "muBVH.h"
 
 namespace mu {
 
@@ -23,11 +26,18 @@ struct MeshConnectionInfo;
 
 bool GenerateNormalsPoly(RawVector<float3>& dst,
     const IArray<float3> points, const IArray<int> counts, const IArray<int> indices, bool flip);
+// offsets: index offsets of polygons (exclusive scan of counts). avoids recomputing them when the caller already has them.
+bool GenerateNormalsPoly(RawVector<float3>& dst,
+    const IArray<float3> points, const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices, bool flip);
 
 void GenerateNormalsWithSmoothAngle(RawVector<float3>& dst,
     const IArray<float3> points,
     const IArray<int> counts, const IArray<int> indices,
     float smooth_angle, bool flip);
+void GenerateNormalsWithSmoothAngle(RawVector<float3>& dst,
+    const IArray<float3> points,
+    const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices,
+    float smooth_angle, bool flip);
 
 
 // PointsIter: indexed_iterator<const float3*, int*> or indexed_iterator_s<const float3*, int*>
@@ -44,7 +54,9 @@ void GenerateTangentsPoly(float4 *dst,
     const int *counts, const int *offsets, const int *indices,
     int num_faces, int num_vertices);
 
-void QuadifyTriangles(const IArray<float3> vertices, const IArray<int> triangle_indices, bool full_search, float threshold_angle,
+// merge pairs of triangles sharing an edge into quads if all corners of the quad are within threshold_angle of 90 degrees.
+// candidates are found by edge adjacency and merged greedily from the most rectangular one.
+void QuadifyTriangles(const IArray<float3> vertices, const IArray<int> triangle_indices, float threshold_angle,
     RawVector<int>& dst_indices, RawVector<int>& dst_counts);
 
 template<class Handler>
@@ -110,10 +122,7 @@ inline void CopyWithIndices(T *dst, const T *src, const IArray<int> indices, siz
     if (!dst || !src)
         return;
 
-    size_t size = end - beg;
-    for (int i = 0; i < (int)size; ++i) {
-        dst[i] = src[indices[beg + i]];
-    }
+    Gather(dst, src, indices.data() + beg, (int)(end - beg));
 }
 
 template<class T>
@@ -122,10 +131,7 @@ inline void CopyWithIndices(T *dst, const T *src, const IArray<int> indices)
     if (!dst || !src)
         return;
 
-    size_t size = indices.size();
-    for (int i = 0; i < (int)size; ++i) {
-        dst[i] = src[indices[i]];
-    }
+    Gather(dst, src, indices.data(), (int)indices.size());
 }
 
 template<class IntArray1, class IntArray2>
@@ -16,6 +16,9 @@ struct float3 { float x, y, z; };
 struct float4 { float x, y, z, w; };
 struct quatf  { float x, y, z, w; };
 struct float4x4 { float4 m[4]; };
+struct double3 { double x, y, z; };
+struct double4 { double x, y, z, w; };
+struct double4x4 { double4 m[4]; };
 
 static inline float2 float2_(float x, float y) { float2 r = { x,y }; return r; }
 static inline float3 float3_(float x, float y, float z) { float3 r = { x,y,z }; return r; }
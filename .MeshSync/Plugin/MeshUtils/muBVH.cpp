@@ -0,0 +1,504 @@
+#include "pch.h"
+#include "muMath.h"
+#include "muSIMD.h"
+#include "muConcurrency.h"
+#include "muBVH.h"
+
+namespace mu {
+
+namespace {
+
+const int kNumBins = 16;
+const int kMaxDepth = 64;       // also the size of traversal stacks
+const int kParallelBuildSize = 4096;
+const int kPacketSize = 8;
+const int kTriangleGranularity = 4096;
+
+// ray_triangle_intersection() accepts hits slightly outside of triangles.
+// triangle bounds are padded by this ratio of their size so that the BVH never misses those hits.
+const float kBoundsPadding = 1e-3f;
+
+struct AABB
+{
+    float3 bmin = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float3 bmax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    void expand(const float3& p)
+    {
+        bmin = min(bmin, p);
+        bmax = max(bmax, p);
+    }
+    void expand(const AABB& v)
+    {
+        bmin = min(bmin, v.bmin);
+        bmax = max(bmax, v.bmax);
+    }
+    float area() const
+    {
+        if (bmin.x > bmax.x)
+            return 0.0f;
+        auto s = bmax - bmin;
+        return s.x * s.y + s.y * s.z + s.z * s.x;
+    }
+};
+
+inline bool overlap_box(const float3& amin, const float3& amax, const float3& bmin, const float3& bmax)
+{
+    return amin.x <= bmax.x && amax.x >= bmin.x &&
+        amin.y <= bmax.y && amax.y >= bmin.y &&
+        amin.z <= bmax.z && amax.z >= bmin.z;
+}
+
+// zero components are replaced by a tiny value to avoid 0 * inf = NaN on slabs the ray lies on
+inline float3 safe_rcp(const float3& v)
+{
+    const float tiny = 1e-30f;
+    auto r = [tiny](float a) { return 1.0f / (std::abs(a) < tiny ? (a < 0.0f ? -tiny : tiny) : a); };
+    return { r(v.x), r(v.y), r(v.z) };
+}
+
+inline bool ray_box(const float3& pos, const float3& inv_dir, const TriangleBVH::Node& node, float tmax, float& tnear)
+{
+    auto t1 = (node.bmin - pos) * inv_dir;
+    auto t2 = (node.bmax - pos) * inv_dir;
+    auto tmin3 = min(t1, t2);
+    auto tmax3 = max(t1, t2);
+    float tn = std::max(std::max(tmin3.x, tmin3.y), std::max(tmin3.z, 0.0f));
+    float tf = std::min(std::min(tmax3.x, tmax3.y), std::min(tmax3.z, tmax));
+    tnear = tn;
+    return tn <= tf;
+}
+
+// ties are resolved by the original triangle index to give the same result as the linear kernels
+inline void update_nearest(int ti, float d, int& tindex, float& distance)
+{
+    if (d < distance || (d == distance && ti < tindex)) {
+        distance = d;
+        tindex = ti;
+    }
+}
+
+class BVHBuilder
+{
+public:
+    BVHBuilder(TriangleBVH& dst, const IArray<float3> vertices, const IArray<int> indices, int max_leaf_size);
+    void build();
+
+private:
+    void buildNode(int ni, int begin, int end, int depth);
+    void makeLeaf(TriangleBVH::Node& node, int begin, int end);
+
+    TriangleBVH& m_dst;
+    const IArray<float3> m_vertices;
+    const IArray<int> m_indices;
+    int m_max_leaf_size;
+    RawVector<AABB> m_bounds;
+    RawVector<float3> m_centers;
+    RawVector<int> m_refs;
+    std::atomic_int m_node_count;
+};
+
+BVHBuilder::BVHBuilder(TriangleBVH& dst, const IArray<float3> vertices, const IArray<int> indices, int max_leaf_size)
+    : m_dst(dst), m_vertices(vertices), m_indices(indices), m_max_leaf_size(std::max(max_leaf_size, 1))
+{
+}
+
+void BVHBuilder::build()
+{
+    int num_triangles = (int)m_indices.size() / 3;
+    m_dst.clear();
+    if (num_triangles == 0)
+        return;
+
+    m_bounds.resize_discard(num_triangles);
+    m_centers.resize_discard(num_triangles);
+    m_refs.resize_discard(num_triangles);
+    parallel_for_blocked(0, num_triangles, kTriangleGranularity, [this](int begin, int end) {
+        for (int ti = begin; ti < end; ++ti) {
+            const int *idx = &m_indices[ti * 3];
+            AABB b;
+            b.expand(m_vertices[idx[0]]);
+            b.expand(m_vertices[idx[1]]);
+            b.expand(m_vertices[idx[2]]);
+            auto size = b.bmax - b.bmin;
+            float pad = std::max(std::max(size.x, size.y), size.z) * kBoundsPadding;
+            b.bmin -= float3{ pad, pad, pad };
+            b.bmax += float3{ pad, pad, pad };
+            m_bounds[ti] = b;
+            m_centers[ti] = (b.bmin + b.bmax) * 0.5f;
+            m_refs[ti] = ti;
+        }
+    });
+
+    m_dst.nodes.resize_discard(num_triangles * 2 - 1);
+    m_node_count = 1;
+    buildNode(0, 0, num_triangles, 0);
+    m_dst.nodes.resize(m_node_count);
+    m_dst.nodes.shrink_to_fit();
+
+    // gather leaf triangles in SoA
+    m_dst.triangles.swap(m_refs);
+    m_dst.v1x.resize_discard(num_triangles); m_dst.v1y.resize_discard(num_triangles); m_dst.v1z.resize_discard(num_triangles);
+    m_dst.v2x.resize_discard(num_triangles); m_dst.v2y.resize_discard(num_triangles); m_dst.v2z.resize_discard(num_triangles);
+    m_dst.v3x.resize_discard(num_triangles); m_dst.v3y.resize_discard(num_triangles); m_dst.v3z.resize_discard(num_triangles);
+    parallel_for_blocked(0, num_triangles, kTriangleGranularity, [this](int begin, int end) {
+        auto& d = m_dst;
+        for (int i = begin; i < end; ++i) {
+            const int *idx = &m_indices[d.triangles[i] * 3];
+            auto p1 = m_vertices[idx[0]];
+            auto p2 = m_vertices[idx[1]];
+            auto p3 = m_vertices[idx[2]];
+            d.v1x[i] = p1.x; d.v1y[i] = p1.y; d.v1z[i] = p1.z;
+            d.v2x[i] = p2.x; d.v2y[i] = p2.y; d.v2z[i] = p2.z;
+            d.v3x[i] = p3.x; d.v3y[i] = p3.y; d.v3z[i] = p3.z;
+        }
+    });
+}
+
+void BVHBuilder::makeLeaf(TriangleBVH::Node& node, int begin, int end)
+{
+    // keep original order in leaves. the SoA kernel keeps the first of equally near hits.
+    std::sort(m_refs.data() + begin, m_refs.data() + end);
+    node.offset = begin;
+    node.count = end - begin;
+}
+
+void BVHBuilder::buildNode(int ni, int begin, int end, int depth)
+{
+    AABB bounds, cbounds;
+    for (int i = begin; i < end; ++i) {
+        int ti = m_refs[i];
+        bounds.expand(m_bounds[ti]);
+        cbounds.expand(m_centers[ti]);
+    }
+
+    auto& node = m_dst.nodes[ni];
+    node.bmin = bounds.bmin;
+    node.bmax = bounds.bmax;
+
+    int num = end - begin;
+    if (num <= m_max_leaf_size || depth >= kMaxDepth - 1) {
+        makeLeaf(node, begin, end);
+        return;
+    }
+
+    // pick the longest axis of the centroid bounds
+    auto extent = cbounds.bmax - cbounds.bmin;
+    int axis = 0;
+    if (extent.y > extent[axis]) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    int mid = begin;
+    if (extent[axis] > 0.0f) {
+        AABB bins[kNumBins];
+        int counts[kNumBins] = {};
+        float bmin = cbounds.bmin[axis];
+        float scale = (float)kNumBins / extent[axis];
+        auto bin_of = [&](int ti) {
+            return std::min((int)((m_centers[ti][axis] - bmin) * scale), kNumBins - 1);
+        };
+        for (int i = begin; i < end; ++i) {
+            int ti = m_refs[i];
+            int bi = bin_of(ti);
+            ++counts[bi];
+            bins[bi].expand(m_bounds[ti]);
+        }
+
+        // sweep from right to get costs of the right sides, then from left to find the best split
+        float right_area[kNumBins];
+        int right_count[kNumBins];
+        {
+            AABB b;
+            int c = 0;
+            for (int i = kNumBins - 1; i > 0; --i) {
+                b.expand(bins[i]);
+                c += counts[i];
+                right_area[i] = b.area();
+                right_count[i] = c;
+            }
+        }
+        float best_cost = FLT_MAX;
+        int best_split = -1;
+        {
+            AABB b;
+            int c = 0;
+            for (int i = 0; i < kNumBins - 1; ++i) {
+                b.expand(bins[i]);
+                c += counts[i];
+                if (c == 0 || right_count[i + 1] == 0)
+                    continue;
+                float cost = b.area() * c + right_area[i + 1] * right_count[i + 1];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_split = i;
+                }
+            }
+        }
+
+        // SAH with traversal cost equal to one triangle test
+        float leaf_cost = bounds.area() * num;
+        float split_cost = bounds.area() + best_cost;
+        bool force_split = num > m_max_leaf_size * 4;
+        if (best_split != -1 && (split_cost < leaf_cost || force_split)) {
+            mid = (int)(std::partition(m_refs.data() + begin, m_refs.data() + end,
+                [&](int ti) { return bin_of(ti) <= best_split; }) - m_refs.data());
+        }
+        else if (!force_split) {
+            makeLeaf(node, begin, end);
+            return;
+        }
+    }
+    if (mid == begin || mid == end) {
+        // all centroids are (almost) identical. split by count.
+        mid = begin + num / 2;
+    }
+
+    int c = m_node_count.fetch_add(2);
+    node.offset = c;
+    node.count = 0;
+    if (num > kParallelBuildSize) {
+        parallel_invoke(
+            [&]() { buildNode(c + 0, begin, mid, depth + 1); },
+            [&]() { buildNode(c + 1, mid, end, depth + 1); });
+    }
+    else {
+        buildNode(c + 0, begin, mid, depth + 1);
+        buildNode(c + 1, mid, end, depth + 1);
+    }
+}
+
+} // namespace
+
+
+void TriangleBVH::clear()
+{
+    nodes.clear();
+    triangles.clear();
+    v1x.clear(); v1y.clear(); v1z.clear();
+    v2x.clear(); v2y.clear(); v2z.clear();
+    v3x.clear(); v3y.clear(); v3z.clear();
+}
+
+void TriangleBVH::build(const IArray<float3> vertices, const IArray<int> indices, int max_leaf_size)
+{
+    BVHBuilder builder(*this, vertices, indices, max_leaf_size);
+    builder.build();
+}
+
+bool TriangleBVH::empty() const { return nodes.empty(); }
+int TriangleBVH::getNodeCount() const { return (int)nodes.size(); }
+int TriangleBVH::getTriangleCount() const { return (int)triangles.size(); }
+
+int TriangleBVH::getDepth() const
+{
+    if (nodes.empty())
+        return 0;
+
+    int ret = 0;
+    std::pair<int, int> stack[kMaxDepth + 1];
+    int sp = 0;
+    stack[sp++] = { 0, 1 };
+    while (sp > 0) {
+        auto s = stack[--sp];
+        ret = std::max(ret, s.second);
+        auto& node = nodes[s.first];
+        if (node.count == 0) {
+            stack[sp++] = { node.offset + 0, s.second + 1 };
+            stack[sp++] = { node.offset + 1, s.second + 1 };
+        }
+    }
+    return ret;
+}
+
+#define LeafArgs(O)\
+    &v1x[O], &v1y[O], &v1z[O],\
+    &v2x[O], &v2y[O], &v2z[O],\
+    &v3x[O], &v3y[O], &v3z[O]
+
+int TriangleBVH::rayIntersection(float3 pos, float3 dir, int& tindex, float& distance) const
+{
+    int num_hits = 0;
+    distance = FLT_MAX;
+    if (nodes.empty())
+        return num_hits;
+
+    auto inv_dir = safe_rcp(dir);
+    int stack[kMaxDepth + 1];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        auto& node = nodes[stack[--sp]];
+        float tnear;
+        if (!ray_box(pos, inv_dir, node, FLT_MAX, tnear))
+            continue;
+
+        if (node.count > 0) {
+            int ti;
+            float d;
+            int n = RayTrianglesIntersectionSoA(pos, dir, LeafArgs(node.offset), node.count, ti, d);
+            if (n > 0) {
+                num_hits += n;
+                update_nearest(triangles[node.offset + ti], d, tindex, distance);
+            }
+        }
+        else {
+            stack[sp++] = node.offset + 1;
+            stack[sp++] = node.offset + 0;
+        }
+    }
+    return num_hits;
+}
+
+bool TriangleBVH::rayNearest(float3 pos, float3 dir, int& tindex, float& distance) const
+{
+    tindex = -1;
+    distance = FLT_MAX;
+    if (nodes.empty())
+        return false;
+
+    auto inv_dir = safe_rcp(dir);
+    float tnear;
+    if (!ray_box(pos, inv_dir, nodes[0], FLT_MAX, tnear))
+        return false;
+
+    // stack entries hold the entry distance of the node to skip it if a nearer hit is found meanwhile
+    std::pair<int, float> stack[kMaxDepth + 1];
+    int sp = 0;
+    stack[sp++] = { 0, tnear };
+    while (sp > 0) {
+        auto s = stack[--sp];
+        if (s.second > distance)
+            continue;
+
+        auto& node = nodes[s.first];
+        if (node.count > 0) {
+            int ti;
+            float d;
+            if (RayTrianglesIntersectionSoA(pos, dir, LeafArgs(node.offset), node.count, ti, d) > 0)
+                update_nearest(triangles[node.offset + ti], d, tindex, distance);
+        }
+        else {
+            int c0 = node.offset, c1 = node.offset + 1;
+            float t0, t1;
+            bool h0 = ray_box(pos, inv_dir, nodes[c0], distance, t0);
+            bool h1 = ray_box(pos, inv_dir, nodes[c1], distance, t1);
+            if (h0 && h1) {
+                // push the far one first to visit the near one first
+                if (t1 < t0) {
+                    std::swap(c0, c1);
+                    std::swap(t0, t1);
+                }
+                stack[sp++] = { c1, t1 };
+                stack[sp++] = { c0, t0 };
+            }
+            else if (h0) {
+                stack[sp++] = { c0, t0 };
+            }
+            else if (h1) {
+                stack[sp++] = { c1, t1 };
+            }
+        }
+    }
+    return tindex != -1;
+}
+
+void TriangleBVH::rayNearest(const float3 *pos, const float3 *dir, int num_rays, int *tindices, float *distances) const
+{
+    int num_packets = ceildiv(num_rays, kPacketSize);
+    parallel_for(0, num_packets, [&](int pi) {
+        int rbegin = pi * kPacketSize;
+        int rn = std::min(kPacketSize, num_rays - rbegin);
+        const float3 *rpos = pos + rbegin;
+        const float3 *rdir = dir + rbegin;
+        int *rtindices = tindices + rbegin;
+        float *rdistances = distances + rbegin;
+
+        float3 inv_dir[kPacketSize];
+        float3 dir_sum = float3::zero();
+        for (int r = 0; r < rn; ++r) {
+            inv_dir[r] = safe_rcp(rdir[r]);
+            dir_sum += rdir[r];
+            rtindices[r] = -1;
+            rdistances[r] = FLT_MAX;
+        }
+        if (nodes.empty())
+            return;
+
+        // the whole packet goes down a node if any of its rays hits the node's bounds.
+        // children are visited in the order of the average direction of the packet.
+        int stack[kMaxDepth + 1];
+        int sp = 0;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            auto& node = nodes[stack[--sp]];
+            bool active[kPacketSize];
+            bool any = false;
+            for (int r = 0; r < rn; ++r) {
+                float tnear;
+                active[r] = ray_box(rpos[r], inv_dir[r], node, rdistances[r], tnear);
+                any |= active[r];
+            }
+            if (!any)
+                continue;
+
+            if (node.count > 0) {
+                for (int r = 0; r < rn; ++r) {
+                    if (!active[r])
+                        continue;
+                    int ti;
+                    float d;
+                    if (RayTrianglesIntersectionSoA(rpos[r], rdir[r], LeafArgs(node.offset), node.count, ti, d) > 0)
+                        update_nearest(triangles[node.offset + ti], d, rtindices[r], rdistances[r]);
+                }
+            }
+            else {
+                auto& n0 = nodes[node.offset + 0];
+                auto& n1 = nodes[node.offset + 1];
+                auto d = (n1.bmin + n1.bmax) - (n0.bmin + n0.bmax);
+                if (dot(d, dir_sum) >= 0.0f) {
+                    stack[sp++] = node.offset + 1;
+                    stack[sp++] = node.offset + 0;
+                }
+                else {
+                    stack[sp++] = node.offset + 0;
+                    stack[sp++] = node.offset + 1;
+                }
+            }
+        }
+    });
+}
+
+int TriangleBVH::overlap(float3 bmin, float3 bmax, RawVector<int>& dst) const
+{
+    if (nodes.empty())
+        return 0;
+
+    size_t prev_size = dst.size();
+    int stack[kMaxDepth + 1];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        auto& node = nodes[stack[--sp]];
+        if (!overlap_box(node.bmin, node.bmax, bmin, bmax))
+            continue;
+
+        if (node.count > 0) {
+            int end = node.offset + node.count;
+            for (int i = node.offset; i < end; ++i) {
+                float3 tmin = min(min(float3{ v1x[i], v1y[i], v1z[i] }, float3{ v2x[i], v2y[i], v2z[i] }), float3{ v3x[i], v3y[i], v3z[i] });
+                float3 tmax = max(max(float3{ v1x[i], v1y[i], v1z[i] }, float3{ v2x[i], v2y[i], v2z[i] }), float3{ v3x[i], v3y[i], v3z[i] });
+                if (overlap_box(tmin, tmax, bmin, bmax))
+                    dst.push_back(triangles[i]);
+            }
+        }
+        else {
+            stack[sp++] = node.offset + 1;
+            stack[sp++] = node.offset + 0;
+        }
+    }
+    return (int)(dst.size() - prev_size);
+}
+
+#undef LeafArgs
+
+} // namespace mu
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "muMath.h"
+#include "muRawVector.h"
+#include "muIntrusiveArray.h"
+
+namespace mu {
+
+// bounding volume hierarchy of triangles for ray and box queries.
+// built by binned SAH. nodes are stored in a flat array and siblings are adjacent, so an inner node only
+// needs the index of its first child. triangles are reordered so that each leaf is a contiguous range,
+// and stored in SoA to let leaves be tested by RayTrianglesIntersectionSoA().
+class TriangleBVH
+{
+public:
+    struct Node
+    {
+        float3 bmin;
+        int offset; // inner node: index of the first child (the second one is offset + 1). leaf: first triangle
+        float3 bmax;
+        int count;  // leaf: number of triangles. inner node: 0
+    };
+
+    void clear();
+    // max_leaf_size: leaves are not split further when they have this many triangles or less
+    void build(const IArray<float3> vertices, const IArray<int> indices, int max_leaf_size = 8);
+
+    // same as RayTrianglesIntersectionIndexed(): returns the number of hits, and tindex & distance of the nearest one.
+    // tindex is the index of the triangle in the indices passed to build().
+    int rayIntersection(float3 pos, float3 dir, int& tindex, float& distance) const;
+    // nearest hit only. faster than rayIntersection() as subtrees farther than the current nearest hit are skipped.
+    bool rayNearest(float3 pos, float3 dir, int& tindex, float& distance) const;
+    // nearest hits of multiple rays. rays are traversed in packets, which pays off when neighbor rays are coherent.
+    // tindices[i] is -1 and distances[i] is FLT_MAX if rays[i] hits nothing.
+    void rayNearest(const float3 *pos, const float3 *dir, int num_rays, int *tindices, float *distances) const;
+    // collect triangles whose bounds overlap [bmin, bmax]. returns the number of triangles added to dst.
+    int overlap(float3 bmin, float3 bmax, RawVector<int>& dst) const;
+
+    bool empty() const;
+    int getNodeCount() const;
+    int getTriangleCount() const;
+    int getDepth() const;
+
+public:
+    RawVector<Node> nodes;
+    RawVector<int> triangles; // leaf order -> original triangle index
+    RawVector<float> v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z;
+};
+
+} // namespace mu
@@ -29,10 +29,10 @@ inline void parallel_for(int begin, int end, int granularity, const Body& body)
     int num_elements = end - begin;
     int num_blocks = ceildiv(num_elements, granularity);
     parallel_for(0, num_blocks, [&](int i) {
-        int begin = granularity * i;
-        int end = std::min<int>(granularity * (i + 1), num_elements);
-        for (; begin != end; ++begin) {
-            body(begin);
+        int b = begin + granularity * i;
+        int e = begin + std::min<int>(granularity * (i + 1), num_elements);
+        for (; b != e; ++b) {
+            body(b);
         }
     });
 }
@@ -42,9 +42,9 @@ inline void parallel_for_blocked(int begin, int end, int granularity, const Body
     int num_elements = end - begin;
     int num_blocks = ceildiv(num_elements, granularity);
     parallel_for(0, num_blocks, [&](int i) {
-        int begin = granularity * i;
-        int end = std::min<int>(granularity * (i + 1), num_elements);
-        body(begin, end);
+        int b = begin + granularity * i;
+        int e = begin + std::min<int>(granularity * (i + 1), num_elements);
+        body(b, e);
     });
 }
 #else
@@ -56,7 +56,7 @@ inline void parallel_for(int begin, int end, int /*granularity*/, const Body& bo
 template<class Body>
 inline void parallel_for_blocked(int begin, int end, int /*granularity*/, const Body& body)
 {
-    for (; begin != end; ++begin) { body(begin); }
+    if (begin != end) { body(begin, end); }
 }
 #endif
 
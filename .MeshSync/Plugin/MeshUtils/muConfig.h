@@ -15,3 +15,6 @@
     #define muEnableSymbol
 #endif
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define muX86
+#endif
@@ -4,6 +4,7 @@
 namespace mu {
 
 // note: this half doesn't care about Inf nor NaN. simply round down minor bits of exponent and mantissa.
+// values out of range are clamped to +-65504 (including Inf and NaN), and too small ones are flushed to zero.
 struct half
 {
     uint16_t value;
@@ -15,7 +16,18 @@ struct half
     {
         uint32_t n = (uint32_t&)v;
         uint16_t sign_bit = (n >> 16) & 0x8000;
-        uint16_t exponent = (std::max<int>((n >> 23) - 127 + 15, 0) & 0x1f) << 10;
+        int e = (int)((n >> 23) & 0xff) - 127 + 15;
+        if (e <= 0) {
+            // too small. flush to zero
+            value = sign_bit;
+            return;
+        }
+        if (e >= 31) {
+            // too large. clamp to the max finite value
+            value = sign_bit | 0x7bff;
+            return;
+        }
+        uint16_t exponent = (e & 0x1f) << 10;
         uint16_t mantissa = (n >> (23 - 10)) & 0x3ff;
 
         value = sign_bit | exponent | mantissa;
@@ -30,6 +42,10 @@ struct half
     operator float() const
     {
         uint32_t sign_bit = (value & 0x8000) << 16;
+        if ((value & 0x7c00) == 0) {
+            // zero. denormals are not produced by the conversion above
+            return (float&)sign_bit;
+        }
         uint32_t exponent = ((((value >> 10) & 0x1f) - 15 + 127) & 0xff) << 23;
         uint32_t mantissa = (value & 0x3ff) << (23 - 10);
 
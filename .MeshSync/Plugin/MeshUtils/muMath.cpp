@@ -32,6 +32,12 @@ Def(F32ToS32_Generic, snorm32, float);
 Def(S32ToF32_Generic, float, snorm32);
 #undef Def
 
+void F64ToF32_Generic(float *dst, const double *src, size_t num)
+{
+    for (size_t i = 0; i < num; ++i)
+        dst[i] = (float)src[i];
+}
+
 
 void InvertX_Generic(float3 *dst, size_t num)
 {
@@ -79,6 +85,18 @@ void Lerp_Generic(float *dst, const float *src1, const float *src2, size_t num,
         dst[i] = src1[i] * w + src2[i] * iw;
 }
 
+void LerpWeighted_Generic(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num)
+{
+    for (size_t i = 0; i < num; ++i)
+        dst[i] = lerp(src1[i], src2[i], w[i]);
+}
+
+void Slerp_Generic(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num)
+{
+    for (size_t i = 0; i < num; ++i)
+        dst[i] = slerp(src1[i], src2[i], w[i]);
+}
+
 template<class T>
 static inline void MinMax_GenericImpl(const T *src, size_t num, T& dst_min, T& dst_max)
 {
@@ -121,6 +139,72 @@ void MulVectors_Generic(const float4x4& m, const float3 src[], float3 dst[], siz
         dst[i] = mul_v(m, src[i]);
     }
 }
+// zero-length vectors stay zero instead of becoming NaN
+static inline float3 NormalizeOrZero(const float3& v)
+{
+    float l2 = length_sq(v);
+    return l2 > 0.0f ? v / std::sqrt(l2) : v;
+}
+void MulNormals_Generic(const float4x4& m, const float3 src[], float3 dst[], size_t num_data)
+{
+    for (size_t i = 0; i < num_data; ++i) {
+        dst[i] = NormalizeOrZero(mul_v(m, src[i]));
+    }
+}
+void MulTangents_Generic(const float4x4& m, const float4 src[], float4 dst[], size_t num_data)
+{
+    for (size_t i = 0; i < num_data; ++i) {
+        float3 t = NormalizeOrZero(mul_v(m, (const float3&)src[i]));
+        dst[i] = { t.x, t.y, t.z, src[i].w };
+    }
+}
+void MulMatrices_Generic(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num)
+{
+    for (size_t i = 0; i < num; ++i) {
+        dst[i] = a[i] * b[i];
+    }
+}
+void MulPoints_Generic(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    for (size_t i = 0; i < num_data; ++i) {
+        dst[i] = to<float3>(mul_p(m, src[i]));
+    }
+}
+void MulVectors_Generic(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    for (size_t i = 0; i < num_data; ++i) {
+        dst[i] = to<float3>(mul_v(m, src[i]));
+    }
+}
+void MulNormals_Generic(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    for (size_t i = 0; i < num_data; ++i) {
+        dst[i] = to<float3>(normalize(mul_v(m, src[i])));
+    }
+}
+
+void Skin4_Generic(const float4x4 bones[], const Weights4 weights[],
+    const float3 src_points[], const float3 src_normals[], const float4 src_tangents[],
+    float3 dst_points[], float3 dst_normals[], float4 dst_tangents[], size_t num_data)
+{
+    for (size_t i = 0; i < num_data; ++i) {
+        auto& w = weights[i];
+        float4x4 m;
+        for (int r = 0; r < 4; ++r) {
+            m[r] =
+                bones[w.indices[0]][r] * w.weights[0] + bones[w.indices[1]][r] * w.weights[1] +
+                bones[w.indices[2]][r] * w.weights[2] + bones[w.indices[3]][r] * w.weights[3];
+        }
+        if (src_points && dst_points)
+            dst_points[i] = mul_p(m, src_points[i]);
+        if (src_normals && dst_normals)
+            dst_normals[i] = normalize(mul_v(m, src_normals[i]));
+        if (src_tangents && dst_tangents) {
+            float3 t = normalize(mul_v(m, (const float3&)src_tangents[i]));
+            dst_tangents[i] = { t.x, t.y, t.z, src_tangents[i].w };
+        }
+    }
+}
 
 int RayTrianglesIntersectionIndexed_Generic(float3 pos, float3 dir, const float3 *vertices, const int *indices, int num_triangles, int& tindex, float& distance)
 {
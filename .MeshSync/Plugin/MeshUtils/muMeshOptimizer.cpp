@@ -0,0 +1,471 @@
+#include "pch.h"
+#include <queue>
+#include "muMath.h"
+#include "muMeshOptimizer.h"
+
+namespace mu {
+
+namespace {
+
+const int kMaxCacheSize = 32;
+const float kCacheDecayPower = 1.5f;
+const float kLastTriScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+
+struct VertexCacheScoreTable
+{
+    float cache[kMaxCacheSize];
+    float valence[64];
+
+    VertexCacheScoreTable()
+    {
+        for (int i = 0; i < kMaxCacheSize; ++i) {
+            if (i < 3) {
+                // the last triangle's vertices get a fixed score so that strips are not favored too much
+                cache[i] = kLastTriScore;
+            }
+            else {
+                const float scaler = 1.0f / (kMaxCacheSize - 3);
+                cache[i] = std::pow(1.0f - (i - 3) * scaler, kCacheDecayPower);
+            }
+        }
+        for (int i = 0; i < 64; ++i)
+            valence[i] = i == 0 ? 0.0f : kValenceBoostScale * std::pow((float)i, -kValenceBoostPower);
+    }
+
+    float score(int cache_position, int remaining_valence) const
+    {
+        if (remaining_valence == 0)
+            return -1.0f; // no triangle needs this vertex
+        float ret = cache_position < 0 ? 0.0f : cache[cache_position];
+        ret += valence[std::min(remaining_valence, 63)];
+        return ret;
+    }
+};
+
+} // namespace
+
+void OptimizeVertexCache(IArray<int> triangle_indices, int num_vertices)
+{
+    static const VertexCacheScoreTable s_table;
+
+    int num_triangles = (int)triangle_indices.size() / 3;
+    if (num_triangles == 0 || num_vertices == 0)
+        return;
+
+    // vertex -> triangles
+    RawVector<int> v2t_offsets, v2t_triangles, valence;
+    v2t_offsets.resize_zeroclear(num_vertices + 1);
+    for (int i : triangle_indices)
+        ++v2t_offsets[i + 1];
+    for (int vi = 0; vi < num_vertices; ++vi)
+        v2t_offsets[vi + 1] += v2t_offsets[vi];
+    valence.resize_discard(num_vertices);
+    for (int vi = 0; vi < num_vertices; ++vi)
+        valence[vi] = v2t_offsets[vi + 1] - v2t_offsets[vi];
+    {
+        RawVector<int> pos;
+        pos.assign(v2t_offsets.begin(), v2t_offsets.end() - 1);
+        v2t_triangles.resize_discard(triangle_indices.size());
+        for (int ti = 0; ti < num_triangles; ++ti) {
+            for (int c = 0; c < 3; ++c)
+                v2t_triangles[pos[triangle_indices[ti * 3 + c]]++] = ti;
+        }
+    }
+
+    RawVector<int> cache_position;
+    RawVector<float> vertex_score, triangle_score;
+    RawVector<bool> emitted;
+    cache_position.resize_discard(num_vertices);
+    vertex_score.resize_discard(num_vertices);
+    triangle_score.resize_discard(num_triangles);
+    emitted.resize_zeroclear(num_triangles);
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        cache_position[vi] = -1;
+        vertex_score[vi] = s_table.score(-1, valence[vi]);
+    }
+    for (int ti = 0; ti < num_triangles; ++ti) {
+        const int *tri = &triangle_indices[ti * 3];
+        triangle_score[ti] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+    }
+
+    RawVector<int> dst;
+    dst.resize_discard(num_triangles * 3);
+
+    int cache[kMaxCacheSize + 3];
+    int cache_size = 0;
+    int best_triangle = -1;
+    int input_cursor = 0;
+
+    for (int oi = 0; oi < num_triangles; ++oi) {
+        if (best_triangle < 0) {
+            // no candidate in the cache. take the next unprocessed triangle in input order.
+            while (emitted[input_cursor])
+                ++input_cursor;
+            best_triangle = input_cursor;
+        }
+
+        const int *tri = &triangle_indices[best_triangle * 3];
+        dst[oi * 3 + 0] = tri[0];
+        dst[oi * 3 + 1] = tri[1];
+        dst[oi * 3 + 2] = tri[2];
+        emitted[best_triangle] = true;
+
+        // remove the triangle from adjacency of its vertices
+        for (int c = 0; c < 3; ++c) {
+            int vi = tri[c];
+            int *begin = &v2t_triangles[v2t_offsets[vi]];
+            int *end = begin + valence[vi];
+            *std::find(begin, end, best_triangle) = end[-1];
+            --valence[vi];
+        }
+
+        // push the triangle's vertices to the front of the LRU cache
+        int new_cache[kMaxCacheSize + 3];
+        int new_cache_size = 0;
+        for (int c = 0; c < 3; ++c)
+            new_cache[new_cache_size++] = tri[c];
+        for (int ci = 0; ci < cache_size; ++ci) {
+            int vi = cache[ci];
+            if (vi != tri[0] && vi != tri[1] && vi != tri[2])
+                new_cache[new_cache_size++] = vi;
+        }
+
+        // update scores of vertices in the cache and their triangles
+        best_triangle = -1;
+        float best_score = -1.0f;
+        for (int ci = 0; ci < new_cache_size; ++ci) {
+            int vi = new_cache[ci];
+            int position = ci < kMaxCacheSize ? ci : -1;
+            cache_position[vi] = position;
+
+            float score = s_table.score(position, valence[vi]);
+            float diff = score - vertex_score[vi];
+            vertex_score[vi] = score;
+
+            const int *adjacent = &v2t_triangles[v2t_offsets[vi]];
+            for (int ai = 0; ai < valence[vi]; ++ai) {
+                int ti = adjacent[ai];
+                float& ts = triangle_score[ti];
+                ts += diff;
+                if (ts > best_score) {
+                    best_score = ts;
+                    best_triangle = ti;
+                }
+            }
+        }
+
+        cache_size = std::min(new_cache_size, kMaxCacheSize);
+        memcpy(cache, new_cache, sizeof(int) * cache_size);
+    }
+
+    dst.copy_to(triangle_indices.data());
+}
+
+void OptimizeVertexFetch(IArray<int> indices, int num_vertices, RawVector<int>& new2old)
+{
+    RawVector<int> old2new;
+    old2new.resize_discard(num_vertices);
+    memset(old2new.data(), -1, sizeof(int) * num_vertices);
+    new2old.resize_discard(num_vertices);
+
+    int n = 0;
+    for (int& i : indices) {
+        int& ni = old2new[i];
+        if (ni == -1) {
+            ni = n++;
+            new2old[ni] = i;
+        }
+        i = ni;
+    }
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        if (old2new[vi] == -1)
+            new2old[n++] = vi;
+    }
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const IArray<int> triangle_indices, int num_vertices, int cache_size)
+{
+    VertexCacheStatistics ret;
+    int num_triangles = (int)triangle_indices.size() / 3;
+    if (num_triangles == 0 || num_vertices == 0)
+        return ret;
+
+    // timestamp of the vertex being pushed to the FIFO cache
+    RawVector<int> timestamps;
+    timestamps.resize_zeroclear(num_vertices);
+    RawVector<bool> referenced;
+    referenced.resize_zeroclear(num_vertices);
+
+    int misses = 0;
+    int num_referenced = 0;
+    for (int i : triangle_indices) {
+        if (!referenced[i]) {
+            referenced[i] = true;
+            ++num_referenced;
+        }
+        // 'misses' works as the clock of the FIFO
+        if (timestamps[i] == 0 || misses - timestamps[i] + 1 > cache_size) {
+            ++misses;
+            timestamps[i] = misses;
+        }
+    }
+
+    ret.vertices_transformed = misses;
+    ret.vertices_referenced = num_referenced;
+    ret.triangles = num_triangles;
+    ret.acmr = (float)misses / (float)num_triangles;
+    ret.atvr = (float)misses / (float)num_referenced;
+    return ret;
+}
+
+VertexCacheStatistics& VertexCacheStatistics::operator+=(const VertexCacheStatistics& v)
+{
+    vertices_transformed += v.vertices_transformed;
+    vertices_referenced += v.vertices_referenced;
+    triangles += v.triangles;
+    acmr = triangles > 0 ? (float)vertices_transformed / (float)triangles : 0.0f;
+    atvr = vertices_referenced > 0 ? (float)vertices_transformed / (float)vertices_referenced : 0.0f;
+    return *this;
+}
+
+namespace {
+
+// symmetric 4x4 matrix
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+
+    void addPlane(const float3& n, float d, float w)
+    {
+        double a = n.x, b = n.y, c = n.z, dd = d;
+        a00 += w * a * a; a01 += w * a * b; a02 += w * a * c; a03 += w * a * dd;
+        a11 += w * b * b; a12 += w * b * c; a13 += w * b * dd;
+        a22 += w * c * c; a23 += w * c * dd;
+        a33 += w * dd * dd;
+    }
+
+    Quadric& operator+=(const Quadric& v)
+    {
+        a00 += v.a00; a01 += v.a01; a02 += v.a02; a03 += v.a03;
+        a11 += v.a11; a12 += v.a12; a13 += v.a13;
+        a22 += v.a22; a23 += v.a23;
+        a33 += v.a33;
+        return *this;
+    }
+
+    float error(const float3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double r =
+            a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+            a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+            a22 * z * z + 2.0 * a23 * z +
+            a33;
+        return (float)std::abs(r);
+    }
+};
+
+struct Collapse
+{
+    float error;
+    int from, to;
+    int version; // sum of versions of from and to when this is evaluated
+
+    bool operator<(const Collapse& v) const { return error > v.error; } // for min-heap
+};
+
+} // namespace
+
+float SimplifyTriangles(RawVector<int>& dst,
+    const IArray<int> triangle_indices, const IArray<float3> points, int target_index_count, float max_error,
+    const IArray<uint8_t> vertex_locks, const IArray<int> vertex_groups)
+{
+    int num_triangles = (int)triangle_indices.size() / 3;
+    int num_vertices = (int)points.size();
+
+    RawVector<int> tris;
+    tris.assign(triangle_indices.begin(), triangle_indices.begin() + num_triangles * 3);
+    RawVector<bool> dead;
+    dead.resize_zeroclear(num_triangles);
+
+    // vertex -> triangles
+    std::vector<std::vector<int>> v2t(num_vertices);
+    for (int ti = 0; ti < num_triangles; ++ti) {
+        for (int c = 0; c < 3; ++c)
+            v2t[tris[ti * 3 + c]].push_back(ti);
+    }
+
+    // quadrics
+    std::vector<Quadric> quadrics(num_vertices);
+    for (int ti = 0; ti < num_triangles; ++ti) {
+        const int *t = &tris[ti * 3];
+        float3 p0 = points[t[0]], p1 = points[t[1]], p2 = points[t[2]];
+        float3 n = cross(p1 - p0, p2 - p0);
+        float area2 = length(n);
+        if (area2 == 0.0f)
+            continue;
+        n /= area2;
+        float d = -dot(n, p0);
+        for (int c = 0; c < 3; ++c)
+            quadrics[t[c]].addPlane(n, d, area2 * 0.5f);
+    }
+
+    // lock vertices on open edges
+    RawVector<uint8_t> locked;
+    locked.resize_zeroclear(num_vertices);
+    if (!vertex_locks.empty())
+        memcpy(locked.data(), vertex_locks.data(), num_vertices);
+    {
+        RawVector<uint64_t> edges;
+        edges.resize_discard(num_triangles * 3);
+        for (int ti = 0; ti < num_triangles; ++ti) {
+            for (int c = 0; c < 3; ++c) {
+                uint64_t a = (uint32_t)tris[ti * 3 + c];
+                uint64_t b = (uint32_t)tris[ti * 3 + (c + 1) % 3];
+                edges[ti * 3 + c] = a < b ? (a << 32) | b : (b << 32) | a;
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        size_t n = edges.size();
+        for (size_t i = 0; i < n;) {
+            size_t j = i + 1;
+            while (j < n && edges[j] == edges[i])
+                ++j;
+            if (j - i == 1) {
+                locked[(int)(edges[i] >> 32)] = 1;
+                locked[(int)(edges[i] & 0xffffffff)] = 1;
+            }
+            i = j;
+        }
+    }
+
+    RawVector<int> versions;
+    versions.resize_zeroclear(num_vertices);
+
+    auto can_collapse = [&](int from, int to) {
+        return !locked[from] && (vertex_groups.empty() || vertex_groups[from] == vertex_groups[to]);
+    };
+    auto evaluate = [&](int from, int to) {
+        Quadric q = quadrics[from];
+        q += quadrics[to];
+        return Collapse{ q.error(points[to]), from, to, versions[from] + versions[to] };
+    };
+
+    std::priority_queue<Collapse> candidates;
+    auto push_candidates = [&](int a, int b) {
+        if (can_collapse(a, b))
+            candidates.push(evaluate(a, b));
+        if (can_collapse(b, a))
+            candidates.push(evaluate(b, a));
+    };
+    for (int ti = 0; ti < num_triangles; ++ti) {
+        for (int c = 0; c < 3; ++c) {
+            int a = tris[ti * 3 + c];
+            int b = tris[ti * 3 + (c + 1) % 3];
+            // each interior edge is shared by two triangles. push it once.
+            if (a < b)
+                push_candidates(a, b);
+        }
+    }
+
+    // moving 'from' to 'to' must not flip or degenerate remaining triangles
+    auto flips = [&](int from, int to) {
+        const float3& pt = points[to];
+        for (int ti : v2t[from]) {
+            if (dead[ti])
+                continue;
+            const int *t = &tris[ti * 3];
+            if (t[0] == to || t[1] == to || t[2] == to)
+                continue;
+            float3 p[3] = { points[t[0]], points[t[1]], points[t[2]] };
+            float3 n0 = cross(p[1] - p[0], p[2] - p[0]);
+            for (int c = 0; c < 3; ++c) {
+                if (t[c] == from)
+                    p[c] = pt;
+            }
+            float3 n1 = cross(p[1] - p[0], p[2] - p[0]);
+            if (dot(n0, n1) <= 0.0f)
+                return true;
+        }
+        return false;
+    };
+
+    int num_alive = num_triangles;
+    float last_error = 0.0f;
+    while (num_alive * 3 > target_index_count && !candidates.empty()) {
+        Collapse cl = candidates.top();
+        candidates.pop();
+        if (cl.error > max_error)
+            break;
+
+        int from = cl.from, to = cl.to;
+        if (versions[from] < 0 || versions[to] < 0)
+            continue; // removed vertex
+        if (cl.version != versions[from] + versions[to]) {
+            // quadric has changed. re-evaluate if the edge still exists.
+            bool connected = false;
+            for (int ti : v2t[from]) {
+                const int *t = &tris[ti * 3];
+                if (!dead[ti] && (t[0] == to || t[1] == to || t[2] == to)) {
+                    connected = true;
+                    break;
+                }
+            }
+            if (connected)
+                candidates.push(evaluate(from, to));
+            continue;
+        }
+        if (flips(from, to))
+            continue;
+
+        // collapse
+        auto& from_tris = v2t[from];
+        auto& to_tris = v2t[to];
+        for (int ti : from_tris) {
+            if (dead[ti])
+                continue;
+            int *t = &tris[ti * 3];
+            if (t[0] == to || t[1] == to || t[2] == to) {
+                dead[ti] = true;
+                --num_alive;
+            }
+            else {
+                for (int c = 0; c < 3; ++c) {
+                    if (t[c] == from)
+                        t[c] = to;
+                }
+                to_tris.push_back(ti);
+            }
+        }
+        from_tris.clear();
+        to_tris.erase(std::remove_if(to_tris.begin(), to_tris.end(), [&](int ti) { return dead[ti]; }), to_tris.end());
+
+        quadrics[to] += quadrics[from];
+        versions[from] = -1;
+        ++versions[to];
+        last_error = cl.error;
+
+        for (int ti : to_tris) {
+            const int *t = &tris[ti * 3];
+            for (int c = 0; c < 3; ++c) {
+                if (t[c] != to)
+                    push_candidates(t[c], to);
+            }
+        }
+    }
+
+    dst.clear();
+    dst.reserve(num_alive * 3);
+    for (int ti = 0; ti < num_triangles; ++ti) {
+        if (!dead[ti])
+            dst.push_back(&tris[ti * 3], 3);
+    }
+    return last_error;
+}
+
+} // namespace mu
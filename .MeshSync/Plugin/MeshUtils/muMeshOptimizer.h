@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cfloat>
+#include "muMath.h"
+#include "muRawVector.h"
+#include "muIntrusiveArray.h"
+
+namespace mu {
+
+struct VertexCacheStatistics
+{
+    float acmr = 0.0f; // average cache miss ratio. transformed vertices per triangle (0.5 - 3.0)
+    float atvr = 0.0f; // average transformed vertex ratio. transformed vertices per referenced vertex (1.0 - )
+    int vertices_transformed = 0;
+    int vertices_referenced = 0;
+    int triangles = 0;
+
+    // accumulate statistics of another index buffer (e.g. other submeshes). acmr and atvr are recalculated.
+    VertexCacheStatistics& operator+=(const VertexCacheStatistics& v);
+};
+
+// reorder triangles for post-transform vertex cache (Tom Forsyth's linear-speed vertex cache optimization).
+// triangle_indices is modified in place. num_vertices must be greater than any index.
+void OptimizeVertexCache(IArray<int> triangle_indices, int num_vertices);
+
+// renumber vertices in order of first reference to improve vertex fetch locality.
+// indices is modified in place. new2old receives the new vertex order. vertices not referenced are placed last.
+void OptimizeVertexFetch(IArray<int> indices, int num_vertices, RawVector<int>& new2old);
+
+// simulate FIFO post-transform vertex cache
+VertexCacheStatistics AnalyzeVertexCache(const IArray<int> triangle_indices, int num_vertices, int cache_size = 16);
+
+// quadric error metric simplification by half-edge collapse.
+// dst refers to the input vertices, so multiple LODs can share one vertex buffer.
+// vertex_locks (can be empty): non-zero for vertices that must be kept (UV/normal seams, material boundaries, etc).
+// vertex_groups (can be empty): collapse is allowed only between vertices in the same group (e.g. dominant bone).
+// vertices on open edges are always kept.
+// stops when the index count reaches target_index_count or the error of the next collapse exceeds max_error.
+// returns the error of the last collapse.
+float SimplifyTriangles(RawVector<int>& dst,
+    const IArray<int> triangle_indices, const IArray<float3> points, int target_index_count, float max_error = FLT_MAX,
+    const IArray<uint8_t> vertex_locks = {}, const IArray<int> vertex_groups = {});
+
+} // namespace mu
@@ -100,191 +100,244 @@ int MeshRefiner::getPointsIndexCountTotal() const
 }
 
 
+namespace {
+
+// running offsets of indices by topology. summed up by ExclusiveScan()
+struct TopologyOffsets
+{
+    int indices = 0;
+    int tri = 0;
+    int lines = 0;
+    int points = 0;
+
+    TopologyOffsets& operator+=(const TopologyOffsets& v)
+    {
+        indices += v.indices;
+        tri += v.tri;
+        lines += v.lines;
+        points += v.points;
+        return *this;
+    }
+};
+
+} // namespace
+
 void MeshRefiner::retopology(bool flip_faces)
 {
     new_indices_tri.resize_discard(getTrianglesIndexCountTotal());
     new_indices_lines.resize_discard(getLinesIndexCountTotal());
     new_indices_points.resize_discard(getPointsIndexCountTotal());
 
-    auto& src = new_indices;
-    auto dst_tri = new_indices_tri.data();
-    auto dst_lines = new_indices_lines.data();
-    auto dst_points = new_indices_points.data();
+    // where each face reads from new_indices and writes to new_indices_*
+    int num_faces = (int)new_counts.size();
+    RawVector<TopologyOffsets> offsets;
+    offsets.resize_discard(num_faces);
+    ExclusiveScan(offsets.data(), num_faces, [this](int fi) {
+        TopologyOffsets r;
+        int count = new_counts[fi];
+        r.indices = count;
+        if (count >= 3 && gen_triangles)
+            r.tri = (count - 2) * 3;
+        else if (count == 2 && gen_lines)
+            r.lines = 2;
+        else if (count == 1 && gen_points)
+            r.points = 1;
+        return r;
+    });
 
     const int i1 = flip_faces ? 2 : 1;
     const int i2 = flip_faces ? 1 : 2;
-    size_t num_faces = new_counts.size();
-
-    int n = 0;
-    for (size_t fi = 0; fi < num_faces; ++fi) {
-        int count = new_counts[fi];
-        if (count >= 3) {
-            if (!gen_triangles)continue;
-            for (int ni = 0; ni < count - 2; ++ni) {
-                *(dst_tri++) = src[n + 0];
-                *(dst_tri++) = src[n + ni + i1];
-                *(dst_tri++) = src[n + ni + i2];
+    parallel_for_blocked(0, num_faces, kParallelBlockSize, [&](int begin, int end) {
+        for (int fi = begin; fi < end; ++fi) {
+            int count = new_counts[fi];
+            auto& o = offsets[fi];
+            const int *src = new_indices.data() + o.indices;
+            if (count >= 3) {
+                if (!gen_triangles)
+                    continue;
+                int *dst = new_indices_tri.data() + o.tri;
+                for (int ni = 0; ni < count - 2; ++ni) {
+                    *(dst++) = src[0];
+                    *(dst++) = src[ni + i1];
+                    *(dst++) = src[ni + i2];
+                }
+            }
+            else if (count == 2) {
+                if (!gen_lines)
+                    continue;
+                new_indices_lines[o.lines + 0] = src[0];
+                new_indices_lines[o.lines + 1] = src[1];
+            }
+            else if (count == 1) {
+                if (!gen_points)
+                    continue;
+                new_indices_points[o.points] = src[0];
             }
         }
-        else if (count == 2) {
-            if (!gen_lines)continue;
-            for (int ni = 0; ni < 2; ++ni)
-                *(dst_lines++) = src[n + ni];
-        }
-        else if (count == 1) {
-            if (!gen_points)continue;
-            *(dst_points++) = src[n];
-        }
-        n += count;
-    }
+    });
 }
 
 void MeshRefiner::genSubmeshes(IArray<int> material_ids)
 {
-    if (material_ids.empty()) {
-        genSubmeshes();
-        return;
-    }
-    submeshes.clear();
+    genSubmeshesImpl(material_ids);
+}
+
+void MeshRefiner::genSubmeshes()
+{
+    genSubmeshesImpl({});
+}
 
-    new_indices_submeshes.resize_discard(new_indices_tri.size() + new_indices_lines.size() + new_indices_points.size());
-    const int *src_tri = new_indices_tri.data();
-    const int *src_lines = new_indices_lines.data();
-    const int *src_points = new_indices_points.data();
-    int *dst_indices = new_indices_submeshes.data();
+void MeshRefiner::genSubmeshesImpl(const IArray<int>& material_ids)
+{
+    submeshes.clear();
 
+    // splits are processed in parallel. each split reads and writes contiguous ranges of indices
     int num_splits = (int)splits.size();
-    int offset_faces = 0;
-    RawVector<Submesh> tmp_submeshes;
+    RawVector<TopologyOffsets> offsets;
+    offsets.resize_discard(num_splits);
+    int total = ExclusiveScan(offsets.data(), num_splits, [this](int spi) {
+        auto& split = splits[spi];
+        TopologyOffsets r;
+        r.indices = split.index_count_tri + split.index_count_lines + split.index_count_points;
+        r.tri = split.index_count_tri;
+        r.lines = split.index_count_lines;
+        r.points = split.index_count_points;
+        return r;
+    }).indices;
+    new_indices_submeshes.resize_discard(total);
+
+    // material ids are shifted by 1 so that -1 (no material) is 0
+    int num_materials = 1;
+    if (!material_ids.empty()) {
+        int mid_min, mid_max;
+        MinMax(material_ids.data(), material_ids.size(), mid_min, mid_max);
+        num_materials = std::max(mid_max + 2, 1);
+    }
 
-    for (int spi = 0; spi < num_splits; ++spi) {
+    std::vector<RawVector<Submesh>> split_submeshes(num_splits);
+    parallel_for(0, num_splits, [&](int spi) {
         auto& split = splits[spi];
+        auto& o = offsets[spi];
+        auto& dst_submeshes = split_submeshes[spi];
         int offset_vertices = split.vertex_offset;
+        int *dst_indices = new_indices_submeshes.data() + o.indices;
+
+        auto add_submesh = [&](Topology topology, const int *src, int index_count) {
+            Submesh sm;
+            sm.topology = topology;
+            sm.index_count = index_count;
+            sm.index_offset = (int)std::distance(new_indices_submeshes.data(), dst_indices);
+            for (int ii = 0; ii < index_count; ++ii)
+                *(dst_indices++) = *(src++) - offset_vertices;
+            dst_submeshes.push_back(sm);
+        };
 
         // triangles
         if (split.index_count_tri > 0) {
-            // gen submeshes by material ids
-            for (int fi = 0; fi < split.face_count; ++fi) {
-                int count = new_counts[offset_faces + fi];
-                if (count >= 3) {
-                    int mid = material_ids[offset_faces + fi] + 1; // -1 == no material. adjust to zero based
-                    while (mid >= (int)tmp_submeshes.size()) {
-                        int id = (int)tmp_submeshes.size();
-                        tmp_submeshes.push_back({});
-                        tmp_submeshes.back().material_id = id - 1;
-                    }
-                    tmp_submeshes[mid].index_count += (new_counts[fi] - 2) * 3;
-                }
-            }
-
-            for (int mi = 0; mi < (int)tmp_submeshes.size(); ++mi) {
-                auto& sm = tmp_submeshes[mi];
-                sm.dst_indices = dst_indices;
-                sm.index_offset = (int)std::distance(new_indices_submeshes.data(), dst_indices);
-                dst_indices += sm.index_count;
+            if (material_ids.empty()) {
+                add_submesh(Topology::Triangles, new_indices_tri.data() + o.tri, split.index_count_tri);
             }
+            else {
+                // gen submeshes by material ids
+                const int *face_counts = new_counts.data() + split.face_offset;
+                const int *face_olds = new2old_faces.data() + split.face_offset;
+                auto material_of = [&](int fi) { return material_ids[face_olds[fi]] + 1; };
+                auto index_count_of = [&](int fi) { return face_counts[fi] >= 3 ? (face_counts[fi] - 2) * 3 : 0; };
+
+                RawVector<int> material_counts;
+                material_counts.resize_discard(num_materials);
+                Histogram(material_counts.data(), num_materials, split.face_count, material_of, index_count_of);
+
+                RawVector<Submesh> tmp_submeshes;
+                tmp_submeshes.resize_discard(num_materials);
+                for (int mi = 0; mi < num_materials; ++mi) {
+                    auto& sm = tmp_submeshes[mi];
+                    sm = Submesh();
+                    sm.material_id = mi - 1;
+                    sm.index_count = material_counts[mi];
+                    sm.dst_indices = dst_indices;
+                    sm.index_offset = (int)std::distance(new_indices_submeshes.data(), dst_indices);
+                    dst_indices += sm.index_count;
+                }
 
-            // copy indices
-            for (int fi = 0; fi < split.face_count; ++fi) {
-                int count = new_counts[offset_faces + fi];
-                if (count >= 3) {
-                    int mid = material_ids[offset_faces + fi] + 1;
-                    int nidx = (count - 2) * 3;
-                    for (int i = 0; i < nidx; ++i)
-                        *(tmp_submeshes[mid].dst_indices++) = *(src_tri++) - offset_vertices;
+                // copy indices
+                const int *src_tri = new_indices_tri.data() + o.tri;
+                for (int fi = 0; fi < split.face_count; ++fi) {
+                    int nidx = index_count_of(fi);
+                    int mid = material_of(fi);
+                    if (mid >= 0 && mid < num_materials) {
+                        int *dst = tmp_submeshes[mid].dst_indices;
+                        for (int i = 0; i < nidx; ++i)
+                            *(dst++) = src_tri[i] - offset_vertices;
+                        tmp_submeshes[mid].dst_indices = dst;
+                    }
+                    src_tri += nidx;
                 }
-            }
 
-            for (int mi = 0; mi < (int)tmp_submeshes.size(); ++mi) {
-                auto& sm = tmp_submeshes[mi];
-                if (sm.index_count > 0) {
-                    ++split.submesh_count;
-                    submeshes.push_back(sm);
+                for (auto& sm : tmp_submeshes) {
+                    if (sm.index_count > 0)
+                        dst_submeshes.push_back(sm);
                 }
             }
         }
 
         // lines
-        if (split.index_count_lines > 0) {
-            Submesh sm;
-            sm.topology = Topology::Lines;
-            sm.index_count = split.index_count_lines;
-            sm.index_offset = (int)std::distance(new_indices_submeshes.data(), dst_indices);
-            for (int ii = 0; ii < sm.index_count; ++ii)
-                *(dst_indices++) = *(src_lines++) - offset_vertices;
-            submeshes.push_back(sm);
-            ++split.submesh_count;
-        }
+        if (split.index_count_lines > 0)
+            add_submesh(Topology::Lines, new_indices_lines.data() + o.lines, split.index_count_lines);
 
         // points
-        if (split.index_count_points > 0) {
-            Submesh sm;
-            sm.topology = Topology::Points;
-            sm.index_count = split.index_count_points;
-            sm.index_offset = (int)std::distance(new_indices_submeshes.data(), dst_indices);
-            for (int ii = 0; ii < sm.index_count; ++ii)
-                *(dst_indices++) = *(src_points++) - offset_vertices;
-            submeshes.push_back(sm);
-            ++split.submesh_count;
-        }
+        if (split.index_count_points > 0)
+            add_submesh(Topology::Points, new_indices_points.data() + o.points, split.index_count_points);
 
-        offset_faces += split.face_count;
-        tmp_submeshes.clear();
-    }
+        split.submesh_count = (int)dst_submeshes.size();
+    });
+
+    for (auto& sms : split_submeshes)
+        submeshes.insert(submeshes.end(), sms.begin(), sms.end());
     setupSubmeshes();
 }
 
-void MeshRefiner::genSubmeshes()
+void MeshRefiner::optimizeVertexCache()
 {
-    submeshes.clear();
-
-    new_indices_submeshes.resize_discard(new_indices_tri.size() + new_indices_lines.size() + new_indices_points.size());
-    const int *src_tri = new_indices_tri.data();
-    const int *src_lines = new_indices_lines.data();
-    const int *src_points = new_indices_points.data();
-    int *dst_indices = new_indices_submeshes.data();
-
     int num_splits = (int)splits.size();
-    for (int spi = 0; spi < num_splits; ++spi) {
+    RawVector<VertexCacheStatistics> split_before(num_splits), split_after(num_splits);
+    parallel_for(0, num_splits, [&](int spi) {
         auto& split = splits[spi];
-        int offset_vertices = split.vertex_offset;
+        split_before[spi] = split_after[spi] = VertexCacheStatistics();
+        if (split.submesh_count == 0)
+            return;
 
-        // triangles
-        if (split.index_count_tri > 0) {
-            Submesh sm;
-            sm.index_count = split.index_count_tri;
-            sm.index_offset = (int)std::distance(new_indices_submeshes.data(), dst_indices);
-            for (int ii = 0; ii < sm.index_count; ++ii)
-                *(dst_indices++) = *(src_tri++) - offset_vertices;
-            submeshes.push_back(sm);
-            ++split.submesh_count;
-        }
+        // indices of submeshes in a split are contiguous
+        auto& first = submeshes[split.submesh_offset];
+        auto& last = submeshes[split.submesh_offset + split.submesh_count - 1];
+        IArray<int> split_indices{
+            new_indices_submeshes.data() + first.index_offset,
+            size_t(last.index_offset + last.index_count - first.index_offset) };
 
-        // lines
-        if (split.index_count_lines > 0) {
-            Submesh sm;
-            sm.topology = Topology::Lines;
-            sm.index_count = split.index_count_lines;
-            sm.index_offset = (int)std::distance(new_indices_submeshes.data(), dst_indices);
-            for (int ii = 0; ii < sm.index_count; ++ii)
-                *(dst_indices++) = *(src_lines++) - offset_vertices;
-            submeshes.push_back(sm);
-            ++split.submesh_count;
+        for (int smi = 0; smi < split.submesh_count; ++smi) {
+            auto& sm = submeshes[split.submesh_offset + smi];
+            if (sm.topology == Topology::Triangles) {
+                IArray<int> triangles{ new_indices_submeshes.data() + sm.index_offset, (size_t)sm.index_count };
+                split_before[spi] += AnalyzeVertexCache(triangles, split.vertex_count);
+                OptimizeVertexCache(triangles, split.vertex_count);
+                split_after[spi] += AnalyzeVertexCache(triangles, split.vertex_count);
+            }
         }
 
-        // points
-        if (split.index_count_points > 0) {
-            Submesh sm;
-            sm.topology = Topology::Points;
-            sm.index_count = split.index_count_points;
-            sm.index_offset = (int)std::distance(new_indices_submeshes.data(), dst_indices);
-            for (int ii = 0; ii < sm.index_count; ++ii)
-                *(dst_indices++) = *(src_points++) - offset_vertices;
-            submeshes.push_back(sm);
-            ++split.submesh_count;
-        }
+        RawVector<int> order;
+        OptimizeVertexFetch(split_indices, split.vertex_count, order);
+        PermuteRange(new_points, order.data(), split.vertex_offset, split.vertex_count);
+        PermuteRange(new2old_points, order.data(), split.vertex_offset, split.vertex_count);
+        PermuteRange(new2old_corners, order.data(), split.vertex_offset, split.vertex_count);
+        for (auto& attr : attributes)
+            attr->permute(order.data(), split.vertex_offset, split.vertex_count);
+    });
+
+    vertex_cache_before = vertex_cache_after = VertexCacheStatistics();
+    for (int spi = 0; spi < num_splits; ++spi) {
+        vertex_cache_before += split_before[spi];
+        vertex_cache_after += split_after[spi];
     }
-    setupSubmeshes();
 }
 
 void MeshRefiner::setupSubmeshes()
@@ -308,6 +361,7 @@ void MeshRefiner::clear()
 {
     split_unit = 0;
     counts.reset();
+    offsets.reset();
     indices.reset();
     points.reset();
     for (auto& attr : attributes) {
@@ -319,6 +373,7 @@ void MeshRefiner::clear()
 
     old2new_indices.clear();
     new2old_points.clear();
+    new2old_faces.clear();
 
     new_counts.clear();
     new_indices.clear();
@@ -331,20 +386,35 @@ void MeshRefiner::clear()
     splits.clear();
     submeshes.clear();
     connection.clear();
+    vertex_cache_before = vertex_cache_after = VertexCacheStatistics();
+
+    new_keys.clear();
+    new2old_corners.clear();
+    vertex_table.clear();
+    tmp_offsets.clear();
+    key_stride = 0;
 }
 
 void MeshRefiner::refine()
 {
-    buildConnection();
-
     int num_indices = (int)indices.size();
     new_points.reserve(num_indices);
     new_indices.reserve(num_indices);
-    for (auto& attr : attributes) { attr->prepare((int)points.size(), (int)indices.size()); }
+    new2old_corners.reserve(num_indices);
 
-    old2new_indices.resize(num_indices, -1);
+    key_stride = 0;
+    for (auto& attr : attributes)
+        key_stride += attr->getKeySize();
+    old2new_indices.resize_discard(num_indices);
+    memset(old2new_indices.data(), -1, old2new_indices.size() * sizeof(int));
 
     int num_faces_total = (int)counts.size();
+    if (offsets.size() != counts.size()) {
+        tmp_offsets.resize_discard(num_faces_total);
+        ExclusiveScan(tmp_offsets.data(), counts.data(), num_faces_total);
+        offsets = tmp_offsets;
+    }
+
     int offset_faces = 0;
     int offset_indices = 0;
     int offset_vertices = 0;
@@ -374,64 +444,253 @@ void MeshRefiner::refine()
         num_indices_tri = 0;
         num_indices_lines = 0;
         num_indices_points = 0;
+        new_keys.clear();
     };
 
-    auto compare_all_attributes = [&](int ni, int ii) -> bool {
-        for (auto& attr : attributes)
-            if (!attr->compare(ni, ii)) { return false; }
-        return true;
-    };
-
-    auto find_or_emit_vertex = [&](int vi, int ii) -> int {
-        int offset = connection.v2f_offsets[vi];
-        int connection_count = connection.v2f_counts[vi];
-        for (int ci = 0; ci < connection_count; ++ci) {
-            int& ni = old2new_indices[connection.v2f_indices[offset + ci]];
-            if (ni != -1 && compare_all_attributes(ni, ii)) {
-                return ni;
-            }
-            else {
+    // open addressing hash table of emitted vertices keyed by (point index, attribute hash).
+    // entries of previous splits (new index < offset_vertices) are treated as empty, so the table needs no clearing on split.
+    // keys are kept only for vertices of the current split.
+    {
+        int max_vertices = num_indices;
+        if (split_unit > 0) {
+            int max_count = 0;
+            for (int c : counts)
+                max_count = std::max(max_count, c);
+            max_vertices = std::min(max_vertices, split_unit + max_count);
+        }
+        int capacity = 16;
+        while (capacity < max_vertices * 2)
+            capacity <<= 1;
+        vertex_table.resize_discard(capacity);
+        memset(vertex_table.data(), -1, vertex_table.size() * sizeof(VertexEntry));
+        new_keys.reserve((size_t)key_stride * max_vertices);
+    }
+    const uint32_t table_mask = (uint32_t)vertex_table.size() - 1;
+    VertexEntry *table = vertex_table.data();
+    const size_t stride = key_stride;
+
+    auto find_or_emit_vertex = [&](int vi, int ii, const char *key, uint32_t key_hash) -> int {
+        uint32_t h = ((uint32_t)vi * 0x9e3779b1u) ^ key_hash;
+        h ^= h >> 15;
+        for (uint32_t slot = h & table_mask;; slot = (slot + 1) & table_mask) {
+            auto& entry = table[slot];
+            int ni = entry.new_index;
+            if (ni < offset_vertices) {
                 ni = (int)new_points.size();
+                entry.new_index = ni;
+                entry.hash = h;
                 new_points.push_back(points[vi]);
                 new2old_points.push_back(vi);
-                for (auto& attr : attributes) { attr->emit(ii); }
+                new2old_corners.push_back(ii);
+                new_keys.insert(new_keys.end(), key, key + stride);
                 return ni;
             }
+            if (entry.hash == h && new2old_points[ni] == vi && (stride == 0 || memcmp(&new_keys[stride * (ni - offset_vertices)], key, stride) == 0))
+                return ni;
         }
-        return 0;
     };
 
+    // face order. input order by default
+    RawVector<int> face_order;
+    if (spatial_split && split_unit > 0)
+        buildSpatialFaceOrder(face_order);
+
+    // attributes are packed per block of corners to keep keys in cache
+    const int block_size = 4096;
+    RawVector<int> block_corners;
+    RawVector<char> block_keys;
+    RawVector<uint32_t> block_hashes;
+    block_corners.reserve(block_size);
+
     new_counts.reserve(counts.size());
-    int offset = 0;
-    for (int fi = 0; fi < num_faces_total; ++fi) {
-        int count = counts[fi];
-        if ((count >= 3 && gen_triangles) || (count == 2 && gen_lines) || (count == 1 && gen_points))
-        {
-            if (split_unit > 0 && (int)new_points.size() - offset_vertices + count > split_unit) {
-                add_new_split();
-
-                // clear vertex cache
-                memset(old2new_indices.data(), -1, old2new_indices.size() * sizeof(int));
-            }
+    new2old_faces.reserve(counts.size());
+    for (int fo = 0; fo < num_faces_total;) {
+        int fo_end = fo;
+        block_corners.clear();
+        for (; fo_end < num_faces_total && (int)block_corners.size() < block_size; ++fo_end) {
+            int fi = face_order.empty() ? fo_end : face_order[fo_end];
+            int first = offsets[fi];
+            int count = counts[fi];
+            for (int ci = 0; ci < count; ++ci)
+                block_corners.push_back(first + ci);
+        }
+        packKeys(block_corners, block_keys, block_hashes);
+
+        int bi = 0;
+        for (; fo < fo_end; ++fo) {
+            int fi = face_order.empty() ? fo : face_order[fo];
+            int offset = offsets[fi];
+            int count = counts[fi];
+            if ((count >= 3 && gen_triangles) || (count == 2 && gen_lines) || (count == 1 && gen_points))
+            {
+                if (split_unit > 0 && (int)new_points.size() - offset_vertices + count > split_unit)
+                    add_new_split();
+
+                for (int ci = 0; ci < count; ++ci) {
+                    int ii = offset + ci;
+                    int ki = bi + ci;
+                    int ni = find_or_emit_vertex(indices[ii], ii, block_keys.data() + stride * ki, block_hashes[ki]);
+                    old2new_indices[ii] = ni;
+                    new_indices.push_back(ni);
+                }
+                ++num_faces;
+                new_counts.push_back(count);
+                new2old_faces.push_back(fi);
+                if (count >= 3)
+                    num_indices_tri += (count - 2) * 3;
+                else if (count == 2)
+                    num_indices_lines += 2;
+                else if (count == 1)
+                    num_indices_points += 1;
 
-            for (int ci = 0; ci < count; ++ci) {
-                int ii = offset + ci;
-                int vi = indices[ii];
-                new_indices.push_back(find_or_emit_vertex(vi, ii));
             }
-            ++num_faces;
-            new_counts.push_back(count);
-            if (count >= 3)
-                num_indices_tri += (count - 2) * 3;
-            else if (count == 2)
-                num_indices_lines += 2;
-            else if (count == 1)
-                num_indices_points += 1;
-
+            bi += count;
         }
-        offset += count;
     }
     add_new_split();
+
+    if (!defer_gather)
+        gatherAttributes();
+}
+
+void MeshRefiner::gatherAttributes()
+{
+    for (int i = 0; i < (int)attributes.size(); ++i)
+        gatherAttribute(i);
+}
+
+void MeshRefiner::gatherAttribute(int i)
+{
+    attributes[i]->gather(new2old_corners);
+}
+
+void MeshRefiner::releaseIntermediates()
+{
+    auto release = [](auto& v) {
+        v.clear();
+        v.shrink_to_fit();
+    };
+    release(old2new_indices);
+    release(new_indices);
+    release(new_indices_tri);
+    release(new_indices_lines);
+    release(new_indices_points);
+    release(new_keys);
+    release(vertex_table);
+    release(tmp_offsets);
+    offsets.reset();
+
+    // outputs are reserved for the worst case. trim them
+    new_points.shrink_to_fit();
+    new2old_points.shrink_to_fit();
+    new2old_corners.shrink_to_fit();
+    new2old_faces.shrink_to_fit();
+    new_counts.shrink_to_fit();
+}
+
+size_t MeshRefiner::getMemoryUsage() const
+{
+    auto size = [](const auto& v) { return v.capacity() * sizeof(v[0]); };
+    size_t ret = 0;
+    ret += size(old2new_indices);
+    ret += size(new2old_points);
+    ret += size(new2old_faces);
+    ret += size(new_counts);
+    ret += size(new_indices);
+    ret += size(new_indices_tri);
+    ret += size(new_indices_lines);
+    ret += size(new_indices_points);
+    ret += size(new_indices_submeshes);
+    ret += size(new_points);
+    ret += size(splits);
+    ret += size(submeshes);
+    ret += size(new_keys);
+    ret += size(new2old_corners);
+    ret += size(vertex_table);
+    ret += size(tmp_offsets);
+    return ret;
+}
+
+void MeshRefiner::packKeys(const RawVector<int>& corners, RawVector<char>& dst_keys, RawVector<uint32_t>& dst_hashes)
+{
+    int num_corners = (int)corners.size();
+    dst_keys.resize_discard((size_t)key_stride * num_corners);
+    dst_hashes.resize_zeroclear(num_corners);
+    if (key_stride == 0)
+        return;
+
+    int key_offset = 0;
+    for (auto& attr : attributes) {
+        attr->pack(dst_keys.data(), key_stride, key_offset, corners.data(), num_corners);
+        key_offset += attr->getKeySize();
+    }
+
+    // hash 8 bytes at a time. multiplies are independent of the running hash to keep the dependency chain short.
+    int num_words = key_stride / 8;
+    for (int i = 0; i < num_corners; ++i) {
+        const char *key = &dst_keys[(size_t)key_stride * i];
+        uint64_t h = 0;
+        for (int wi = 0; wi < num_words; ++wi) {
+            uint64_t w;
+            memcpy(&w, key + wi * 8, 8);
+            h = ((h << 7) | (h >> 57)) ^ (w * 0x9e3779b97f4a7c15ull);
+        }
+        for (int bi = num_words * 8; bi < key_stride; ++bi)
+            h = ((h << 7) | (h >> 57)) ^ ((uint8_t)key[bi] * 0x9e3779b97f4a7c15ull);
+        h ^= h >> 32;
+        h *= 0xd6e8feb86659fd93ull;
+        dst_hashes[i] = (uint32_t)(h >> 32);
+    }
+}
+
+void MeshRefiner::buildSpatialFaceOrder(RawVector<int>& dst)
+{
+    int num_faces = (int)counts.size();
+
+    RawVector<float3> centroids;
+    centroids.resize_discard(num_faces);
+    parallel_for_blocked(0, num_faces, 4096, [&](int begin, int end) {
+        for (int fi = begin; fi < end; ++fi) {
+            int count = counts[fi];
+            const int *idx = &indices[offsets[fi]];
+            float3 c = float3::zero();
+            for (int ci = 0; ci < count; ++ci)
+                c += points[idx[ci]];
+            centroids[fi] = count > 0 ? c / (float)count : c;
+        }
+    });
+
+    float3 bmin, bmax;
+    MinMax(centroids.data(), centroids.size(), bmin, bmax);
+    float3 size = bmax - bmin;
+    float3 scale = {
+        size.x > 0.0f ? 1023.0f / size.x : 0.0f,
+        size.y > 0.0f ? 1023.0f / size.y : 0.0f,
+        size.z > 0.0f ? 1023.0f / size.z : 0.0f,
+    };
+
+    // 30 bit Morton code (10 bit per axis). faces with the same code keep the input order as the sort is stable.
+    auto spread_bits = [](uint32_t v) {
+        v = (v | (v << 16)) & 0x030000ff;
+        v = (v | (v << 8)) & 0x0300f00f;
+        v = (v | (v << 4)) & 0x030c30c3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    };
+    RawVector<uint32_t> keys;
+    keys.resize_discard(num_faces);
+    dst.resize_discard(num_faces);
+    parallel_for_blocked(0, num_faces, 4096, [&](int begin, int end) {
+        for (int fi = begin; fi < end; ++fi) {
+            float3 q = (centroids[fi] - bmin) * scale;
+            keys[fi] =
+                spread_bits((uint32_t)q.x) |
+                (spread_bits((uint32_t)q.y) << 1) |
+                (spread_bits((uint32_t)q.z) << 2);
+            dst[fi] = fi;
+        }
+    });
+    RadixSort(keys.data(), dst.data(), num_faces);
 }
 
 void MeshRefiner::buildConnection()
@@ -3,6 +3,7 @@
 #include "muMath.h"
 #include "muRawVector.h"
 #include "muIntrusiveArray.h"
+#include "muMeshOptimizer.h"
 
 namespace mu {
 
@@ -95,17 +96,21 @@ struct MeshRefiner
 
     // inputs
     int split_unit = 0; // 0 == no split
+    bool spatial_split = false; // process faces in Morton order of their centroids to make splits spatially compact
     bool gen_points = true;
     bool gen_lines = true;
     bool gen_triangles = true;
+    bool defer_gather = false; // if true, refine() doesn't gather attribute values. call gatherAttribute() for each attribute later
 
     IArray<int> counts;
+    IArray<int> offsets; // index offsets of faces (exclusive scan of counts). can be empty. refine() computes them if empty
     IArray<int> indices;
     IArray<float3> points;
 
     // outputs
-    RawVector<int> old2new_indices; // old index to new index
+    RawVector<int> old2new_indices; // old index to new index. -1 for corners of skipped faces
     RawVector<int> new2old_points;  // new index to old vertex
+    RawVector<int> new2old_faces;   // new face index to old face
     RawVector<int> new_counts;
     RawVector<int> new_indices;     // non-triangulated new indices
     RawVector<int> new_indices_tri;
@@ -116,6 +121,8 @@ struct MeshRefiner
     RawVector<Split> splits;
     RawVector<Submesh> submeshes;
     MeshConnectionInfo connection;
+    // post-transform vertex cache statistics of triangles of all splits before and after optimizeVertexCache()
+    VertexCacheStatistics vertex_cache_before, vertex_cache_after;
 
     // attributes
     template<class T>
@@ -137,11 +144,30 @@ struct MeshRefiner
         attr->new2old = &new2old;
     }
 
+    // new2old is equal to new vertex -> source corner. this version omits it
+    template<class T>
+    void addExpandedAttribute(const IArray<T>& values, RawVector<T>& new_values)
+    {
+        auto attr = newAttribute<ExpandedAttribute<T>>();
+        attr->values = values;
+        attr->new_values = &new_values;
+    }
+
     void refine();
+    // gather new values of attributes. i is the order of addition. must be called after optimizeVertexCache() if it is used.
+    void gatherAttributes();
+    void gatherAttribute(int i);
+    // free buffers that are no longer needed after genSubmeshes() and optimizeVertexCache(), and trim outputs
+    void releaseIntermediates();
+    size_t getMemoryUsage() const; // in byte
     void buildConnection();
     void retopology(bool flip_faces);
     void genSubmeshes(IArray<int> material_ids);
     void genSubmeshes();
+    // reorder triangles for vertex cache and vertices for vertex fetch in each split. must be called after genSubmeshes().
+    // new_indices_submeshes, new_points, new2old_points and attributes are updated. new_indices* are not.
+    // vertex_cache_before and vertex_cache_after are updated.
+    void optimizeVertexCache();
     void clear();
 
     int getTrianglesIndexCountTotal() const;
@@ -149,15 +175,54 @@ struct MeshRefiner
     int getPointsIndexCountTotal() const;
 
 private:
+    void genSubmeshesImpl(const IArray<int>& material_ids);
     void setupSubmeshes();
+    void buildSpatialFaceOrder(RawVector<int>& dst);
+    void packKeys(const RawVector<int>& corners, RawVector<char>& dst_keys, RawVector<uint32_t>& dst_hashes);
+
+    // reorder [offset, offset + count) of data. order is new to old index relative to offset.
+    template<class T>
+    static void PermuteRange(RawVector<T>& data, const int *order, int offset, int count)
+    {
+        if (data.size() < size_t(offset + count))
+            return;
+        RawVector<T> tmp;
+        tmp.assign(data.data() + offset, data.data() + offset + count);
+        T *dst = data.data() + offset;
+        for (int i = 0; i < count; ++i)
+            dst[i] = tmp[order[i]];
+    }
 
+    // -0.0 and +0.0 are the same value but differ in bits. zeros of float keys are made positive so that they are welded.
+    static void PackKeyFloats(char *dst, const float *src, int num)
+    {
+        for (int i = 0; i < num; ++i) {
+            uint32_t bits;
+            memcpy(&bits, &src[i], sizeof(bits));
+            if (bits == 0x80000000u)
+                bits = 0;
+            memcpy(dst + sizeof(bits) * i, &bits, sizeof(bits));
+        }
+    }
+    template<class T> static void PackKey(char *dst, const T& v) { memcpy(dst, &v, sizeof(T)); }
+    static void PackKey(char *dst, const float& v) { PackKeyFloats(dst, &v, 1); }
+    static void PackKey(char *dst, const float2& v) { PackKeyFloats(dst, (const float*)&v, 2); }
+    static void PackKey(char *dst, const float3& v) { PackKeyFloats(dst, (const float*)&v, 3); }
+    static void PackKey(char *dst, const float4& v) { PackKeyFloats(dst, (const float*)&v, 4); }
+
+    // vertex identity is decided by comparing packed keys (all attribute values of a corner laid out contiguously).
+    // keys are packed per block of corners and new values are gathered per attribute after refine,
+    // so no virtual calls are made per corner.
     class IAttribute
     {
     public:
         virtual ~IAttribute() {}
-        virtual void prepare(int vertex_count, int index_count) = 0;
-        virtual bool compare(int vertex_index, int index_index) = 0;
-        virtual void emit(int index_index) = 0;
+        virtual int getKeySize() const = 0;
+        // write values of corners into keys. key_offset is byte offset of this attribute in a key.
+        virtual void pack(char *keys, int key_stride, int key_offset, const int *corners, int num_corners) const = 0;
+        // new2old_corners: new vertex index -> source corner index
+        virtual void gather(const RawVector<int>& new2old_corners) = 0;
+        virtual void permute(const int *order, int offset, int count) = 0;
         virtual void clear() = 0;
     };
 
@@ -165,21 +230,36 @@ private:
     class IndexedAttribute : public IAttribute
     {
     public:
-        void prepare(int /*vertex_count*/, int /*index_count*/) override
+        int getKeySize() const override
+        {
+            return sizeof(T);
+        }
+
+        void pack(char *keys, int key_stride, int key_offset, const int *corners, int num_corners) const override
         {
-            clear();
+            char *dst = keys + key_offset;
+            for (int i = 0; i < num_corners; ++i, dst += key_stride)
+                PackKey(dst, values[indices[corners[i]]]);
         }
 
-        bool compare(int ni, int ii) override
+        void gather(const RawVector<int>& new2old_corners) override
         {
-            return (*new_values)[ni] == values[indices[ii]];
+            size_t n = new2old_corners.size();
+            new_values->resize_discard(n);
+            new2old->resize_discard(n);
+            T *dst_values = new_values->data();
+            int *dst_new2old = new2old->data();
+            for (size_t ni = 0; ni < n; ++ni) {
+                int i = indices[new2old_corners[ni]];
+                dst_values[ni] = values[i];
+                dst_new2old[ni] = i;
+            }
         }
 
-        void emit(int ii) override
+        void permute(const int *order, int offset, int count) override
         {
-            int i = indices[ii];
-            new_values->push_back(values[i]);
-            new2old->push_back(i);
+            PermuteRange(*new_values, order, offset, count);
+            PermuteRange(*new2old, order, offset, count);
         }
 
         void clear() override
@@ -198,25 +278,41 @@ private:
     class ExpandedAttribute : public IAttribute
     {
     public:
-        void prepare(int /*vertex_count*/, int /*index_count*/) override
+        int getKeySize() const override
         {
-            clear();
+            return sizeof(T);
         }
 
-        bool compare(int ni, int ii) override
+        void pack(char *keys, int key_stride, int key_offset, const int *corners, int num_corners) const override
         {
-            return (*new_values)[ni] == values[ii];
+            char *dst = keys + key_offset;
+            for (int i = 0; i < num_corners; ++i, dst += key_stride)
+                PackKey(dst, values[corners[i]]);
         }
 
-        void emit(int ii) override
+        void gather(const RawVector<int>& new2old_corners) override
         {
-            new_values->push_back(values[ii]);
-            new2old->push_back(ii);
+            size_t n = new2old_corners.size();
+            new_values->resize_discard(n);
+            T *dst_values = new_values->data();
+            for (size_t ni = 0; ni < n; ++ni)
+                dst_values[ni] = values[new2old_corners[ni]];
+            if (new2old)
+                new2old->assign(new2old_corners.begin(), new2old_corners.end());
+        }
+
+        void permute(const int *order, int offset, int count) override
+        {
+            PermuteRange(*new_values, order, offset, count);
+            if (new2old)
+                PermuteRange(*new2old, order, offset, count);
         }
 
         void clear() override
         {
             new_values->clear();
+            if (new2old)
+                new2old->clear();
         }
 
         IArray<T> values;
@@ -241,6 +337,16 @@ private:
 
     RawVector<IAttribute*> attributes;
     RawVector<char> buf_attributes;
+    RawVector<char> new_keys;        // packed attributes per new vertex
+    RawVector<int> new2old_corners;  // new vertex index -> corner index the vertex was emitted from
+    struct VertexEntry
+    {
+        int new_index;
+        uint32_t hash;
+    };
+    RawVector<VertexEntry> vertex_table; // open addressing hash table of new vertices
+    RawVector<int> tmp_offsets;      // face offsets computed by refine() when offsets is not given
+    int key_stride = 0;
     static const int max_attributes = 8; // you can increase this if needed
 };
 
@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "muParallel.h"
+
+namespace mu {
+
+namespace {
+
+const int kRadixBits = 8;
+const int kRadixSize = 1 << kRadixBits;
+
+// stable LSD radix sort by 8 bit digits.
+// each pass counts digits per block, scans the counts in (digit, block) order and scatters blocks in parallel.
+// as blocks write to disjoint ranges in input order, the result is stable regardless of the number of threads.
+template<class Key>
+void RadixSortImpl(Key *keys, int *values, int num)
+{
+    if (num <= 1)
+        return;
+
+    const int num_passes = (int)sizeof(Key) * 8 / kRadixBits;
+    int num_blocks = ceildiv(num, kParallelBlockSize);
+
+    RawVector<Key> tmp_keys;
+    RawVector<int> tmp_values;
+    tmp_keys.resize_discard(num);
+    if (values)
+        tmp_values.resize_discard(num);
+    RawVector<int> counts;
+    counts.resize_discard((size_t)kRadixSize * num_blocks);
+
+    Key *src_keys = keys, *dst_keys = tmp_keys.data();
+    int *src_values = values, *dst_values = values ? tmp_values.data() : nullptr;
+
+    // bits that differ among keys. passes on other digits are no-ops and skipped.
+    Key diff = 0;
+    {
+        Key first = keys[0];
+        for (int i = 1; i < num; ++i)
+            diff |= keys[i] ^ first;
+    }
+
+    for (int pass = 0; pass < num_passes; ++pass) {
+        int shift = pass * kRadixBits;
+        if (((diff >> shift) & (kRadixSize - 1)) == 0)
+            continue;
+
+        parallel_for(0, num_blocks, [&](int bi) {
+            int begin = bi * kParallelBlockSize;
+            int end = std::min(begin + kParallelBlockSize, num);
+            int c[kRadixSize] = {};
+            for (int i = begin; i < end; ++i)
+                ++c[(src_keys[i] >> shift) & (kRadixSize - 1)];
+            for (int d = 0; d < kRadixSize; ++d)
+                counts[(size_t)d * num_blocks + bi] = c[d];
+        });
+        ExclusiveScan(counts.data(), counts.data(), (int)counts.size());
+
+        parallel_for(0, num_blocks, [&](int bi) {
+            int begin = bi * kParallelBlockSize;
+            int end = std::min(begin + kParallelBlockSize, num);
+            int o[kRadixSize];
+            for (int d = 0; d < kRadixSize; ++d)
+                o[d] = counts[(size_t)d * num_blocks + bi];
+            for (int i = begin; i < end; ++i) {
+                int di = o[(src_keys[i] >> shift) & (kRadixSize - 1)]++;
+                dst_keys[di] = src_keys[i];
+                if (src_values)
+                    dst_values[di] = src_values[i];
+            }
+        });
+        std::swap(src_keys, dst_keys);
+        std::swap(src_values, dst_values);
+    }
+
+    // odd number of passes leaves the result in the temporary buffers
+    if (src_keys != keys) {
+        memcpy(keys, src_keys, sizeof(Key) * num);
+        if (values)
+            memcpy(values, src_values, sizeof(int) * num);
+    }
+}
+
+} // namespace
+
+void RadixSort(uint32_t *keys, int *values, int num)
+{
+    RadixSortImpl(keys, values, num);
+}
+
+void RadixSort(uint64_t *keys, int *values, int num)
+{
+    RadixSortImpl(keys, values, num);
+}
+
+} // namespace mu
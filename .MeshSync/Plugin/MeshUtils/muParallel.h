@@ -0,0 +1,227 @@
+#pragma once
+
+#include "muMath.h"
+#include "muRawVector.h"
+#include "muConcurrency.h"
+
+namespace mu {
+
+// data-parallel primitives.
+// input is split into blocks of kParallelBlockSize elements and blocks are processed by parallel_for().
+// results don't depend on the number of threads. without PPL or TBB, blocks are processed serially.
+const int kParallelBlockSize = 16384;
+
+// dst[i] = sum of value(0 ... i-1). returns the total. Value: [](int i) -> T
+template<class T, class Value>
+T ExclusiveScan(T *dst, int num, const Value& value);
+// dst[i] = sum of src[0 ... i-1]. dst can be src. returns the total.
+template<class T>
+T ExclusiveScan(T *dst, const T *src, int num);
+
+// dst[i] = src[indices[i]]
+template<class T>
+void Gather(T *dst, const T *src, const int *indices, int num);
+// dst[indices[i]] = src[i]. indices must not have duplicates.
+template<class T>
+void Scatter(T *dst, const T *src, const int *indices, int num);
+
+// copy elements that satisfy pred to dst keeping the order. returns the number of copied elements.
+// dst must not overlap src.
+// Pred: [](const T& v) -> bool
+template<class T, class Pred>
+int Compact(T *dst, const T *src, int num, const Pred& pred);
+// store indices that satisfy pred to dst in ascending order. returns the number of stored indices.
+// Pred: [](int i) -> bool
+template<class Pred>
+int CompactIndices(int *dst, int num, const Pred& pred);
+
+// count elements for each bin. dst must have num_bins elements.
+// Bin: [](int i) -> int (0 ... num_bins-1. elements out of range are ignored)
+template<class Bin>
+void Histogram(int *dst, int num_bins, int num, const Bin& bin);
+// sum of weight(i) for each bin instead of count. Weight: [](int i) -> int
+template<class Bin, class Weight>
+void Histogram(int *dst, int num_bins, int num, const Bin& bin, const Weight& weight);
+
+// stable LSD radix sort. values (can be null) are permuted along with keys.
+// passes whose digits are the same for all keys are skipped, so narrow keys sort faster.
+void RadixSort(uint32_t *keys, int *values, int num);
+void RadixSort(uint64_t *keys, int *values, int num);
+
+
+
+// ------------------------------------------------------------
+// impl
+// ------------------------------------------------------------
+
+template<class T, class Value>
+inline T ExclusiveScan(T *dst, int num, const Value& value)
+{
+    if (num <= 0)
+        return T();
+
+    int num_blocks = ceildiv(num, kParallelBlockSize);
+    if (num_blocks == 1) {
+        T sum = T();
+        for (int i = 0; i < num; ++i) {
+            T v = value(i);
+            dst[i] = sum;
+            sum += v;
+        }
+        return sum;
+    }
+
+    // sum of blocks -> scan of block sums -> scan in blocks
+    RawVector<T> block_sums;
+    block_sums.resize_discard(num_blocks);
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = bi * kParallelBlockSize;
+        int end = std::min(begin + kParallelBlockSize, num);
+        T sum = T();
+        for (int i = begin; i < end; ++i)
+            sum += value(i);
+        block_sums[bi] = sum;
+    });
+
+    T total = T();
+    for (int bi = 0; bi < num_blocks; ++bi) {
+        T v = block_sums[bi];
+        block_sums[bi] = total;
+        total += v;
+    }
+
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = bi * kParallelBlockSize;
+        int end = std::min(begin + kParallelBlockSize, num);
+        T sum = block_sums[bi];
+        for (int i = begin; i < end; ++i) {
+            T v = value(i);
+            dst[i] = sum;
+            sum += v;
+        }
+    });
+    return total;
+}
+
+template<class T>
+inline T ExclusiveScan(T *dst, const T *src, int num)
+{
+    // each element is read before it is overwritten, so dst can be src
+    return ExclusiveScan(dst, num, [src](int i) { return src[i]; });
+}
+
+template<class T>
+inline void Gather(T *dst, const T *src, const int *indices, int num)
+{
+    parallel_for_blocked(0, num, kParallelBlockSize, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            dst[i] = src[indices[i]];
+    });
+}
+
+template<class T>
+inline void Scatter(T *dst, const T *src, const int *indices, int num)
+{
+    parallel_for_blocked(0, num, kParallelBlockSize, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            dst[indices[i]] = src[i];
+    });
+}
+
+template<class Pred>
+inline int CompactIndices(int *dst, int num, const Pred& pred)
+{
+    if (num <= 0)
+        return 0;
+
+    int num_blocks = ceildiv(num, kParallelBlockSize);
+    RawVector<int> block_offsets;
+    block_offsets.resize_discard(num_blocks);
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = bi * kParallelBlockSize;
+        int end = std::min(begin + kParallelBlockSize, num);
+        int n = 0;
+        for (int i = begin; i < end; ++i)
+            n += pred(i) ? 1 : 0;
+        block_offsets[bi] = n;
+    });
+    int total = ExclusiveScan(block_offsets.data(), block_offsets.data(), num_blocks);
+
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = bi * kParallelBlockSize;
+        int end = std::min(begin + kParallelBlockSize, num);
+        int *d = dst + block_offsets[bi];
+        for (int i = begin; i < end; ++i) {
+            if (pred(i))
+                *d++ = i;
+        }
+    });
+    return total;
+}
+
+template<class T, class Pred>
+inline int Compact(T *dst, const T *src, int num, const Pred& pred)
+{
+    if (num <= 0)
+        return 0;
+
+    int num_blocks = ceildiv(num, kParallelBlockSize);
+    RawVector<int> block_offsets;
+    block_offsets.resize_discard(num_blocks);
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = bi * kParallelBlockSize;
+        int end = std::min(begin + kParallelBlockSize, num);
+        int n = 0;
+        for (int i = begin; i < end; ++i)
+            n += pred(src[i]) ? 1 : 0;
+        block_offsets[bi] = n;
+    });
+    int total = ExclusiveScan(block_offsets.data(), block_offsets.data(), num_blocks);
+
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = bi * kParallelBlockSize;
+        int end = std::min(begin + kParallelBlockSize, num);
+        T *d = dst + block_offsets[bi];
+        for (int i = begin; i < end; ++i) {
+            if (pred(src[i]))
+                *d++ = src[i];
+        }
+    });
+    return total;
+}
+
+template<class Bin>
+inline void Histogram(int *dst, int num_bins, int num, const Bin& bin)
+{
+    Histogram(dst, num_bins, num, bin, [](int) { return 1; });
+}
+
+template<class Bin, class Weight>
+inline void Histogram(int *dst, int num_bins, int num, const Bin& bin, const Weight& weight)
+{
+    memset(dst, 0, sizeof(int) * num_bins);
+    if (num <= 0 || num_bins <= 0)
+        return;
+
+    // per-block histograms are summed up at the end
+    int num_blocks = ceildiv(num, kParallelBlockSize);
+    RawVector<int> block_bins;
+    block_bins.resize_zeroclear((size_t)num_blocks * num_bins);
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = bi * kParallelBlockSize;
+        int end = std::min(begin + kParallelBlockSize, num);
+        int *bins = block_bins.data() + (size_t)num_bins * bi;
+        for (int i = begin; i < end; ++i) {
+            int b = bin(i);
+            if (b >= 0 && b < num_bins)
+                bins[b] += weight(i);
+        }
+    });
+    for (int bi = 0; bi < num_blocks; ++bi) {
+        const int *bins = block_bins.data() + (size_t)num_bins * bi;
+        for (int i = 0; i < num_bins; ++i)
+            dst[i] += bins[i];
+    }
+}
+
+} // namespace mu
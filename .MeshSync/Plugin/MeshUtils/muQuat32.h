@@ -87,7 +87,7 @@ struct quat32
         const float a0 = unpack(value.x0);
         const float a1 = unpack(value.x1);
         const float a2 = unpack(value.x2);
-        const float iss = sqrt(1.0f - (square(a0) + square(a1) + square(a2)));
+        const float iss = sqrt(std::max(1.0f - (square(a0) + square(a1) + square(a2)), 0.0f)); // can be slightly negative by quantization
 
         switch (value.drop) {
         case 0: return { (T)iss, (T)a0, (T)a1, (T)a2 };
@@ -2,9 +2,686 @@
 #include "muMath.h"
 #include "muSIMD.h"
 #include "muRawVector.h"
+#ifdef muX86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    // allow intrinsics of the given instruction sets in a function without changing the compile options of the file
+    #define muTarget(...) __attribute__((target(__VA_ARGS__)))
+#else
+    #define muTarget(...)
+#endif
 
 namespace mu {
 
+#ifdef muX86
+static void CPUID(uint32_t (&dst)[4], uint32_t leaf, uint32_t subleaf)
+{
+#ifdef _MSC_VER
+    __cpuidex((int*)dst, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, dst[0], dst[1], dst[2], dst[3]);
+#endif
+}
+
+static uint64_t XGETBV0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+static CPUFeatures DetectCPUFeatures()
+{
+    CPUFeatures ret;
+#ifdef muX86
+    uint32_t r[4];
+    CPUID(r, 0, 0);
+    uint32_t max_leaf = r[0];
+    if (max_leaf < 1)
+        return ret;
+
+    CPUID(r, 1, 0);
+    ret.sse41 = (r[2] >> 19) & 1;
+    ret.sse42 = (r[2] >> 20) & 1;
+    bool fma = (r[2] >> 12) & 1;
+    bool osxsave = (r[2] >> 27) & 1;
+    bool avx = (r[2] >> 28) & 1;
+    bool f16c = (r[2] >> 29) & 1;
+
+    // the OS must save YMM (and ZMM) states on context switches
+    uint64_t xcr0 = osxsave ? XGETBV0() : 0;
+    bool ymm = (xcr0 & 0x06) == 0x06;
+    bool zmm = (xcr0 & 0xe6) == 0xe6;
+    ret.avx = avx && ymm;
+    ret.fma = fma && ret.avx;
+    ret.f16c = f16c && ret.avx;
+
+    if (max_leaf >= 7) {
+        CPUID(r, 7, 0);
+        ret.avx2 = ((r[1] >> 5) & 1) && ret.avx;
+        ret.avx512f = ((r[1] >> 16) & 1) && zmm;
+    }
+#endif
+    return ret;
+}
+
+const CPUFeatures& GetCPUFeatures()
+{
+    static const CPUFeatures s_features = DetectCPUFeatures();
+    return s_features;
+}
+
+SIMDLevel GetMaxSIMDLevel()
+{
+    auto& f = GetCPUFeatures();
+    if (f.avx512f && f.avx2 && f.fma && f.f16c)
+        return SIMDLevel::AVX512;
+    if (f.avx2 && f.fma && f.f16c)
+        return SIMDLevel::AVX2;
+    if (f.sse42)
+        return SIMDLevel::SSE4;
+    return SIMDLevel::Generic;
+}
+
+// zero-initialized (Generic) until dynamic initialization, so calls from other static initializers are safe
+static SIMDLevel g_simd_level = GetMaxSIMDLevel();
+
+SIMDLevel GetSIMDLevel()
+{
+    return g_simd_level;
+}
+
+void SetSIMDLevel(SIMDLevel v)
+{
+    g_simd_level = std::min(v, GetMaxSIMDLevel());
+}
+
+
+#ifdef muX86
+muTarget("avx,f16c")
+void F32ToF16_F16C(half *dst, const float *src, size_t num)
+{
+    size_t n8 = num & ~size_t(7);
+    for (size_t i = 0; i < n8; i += 8)
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    for (size_t i = n8; i < num; ++i)
+        dst[i].value = (uint16_t)_mm_cvtsi128_si32(_mm_cvtps_ph(_mm_set_ss(src[i]), _MM_FROUND_TO_NEAREST_INT));
+}
+
+muTarget("avx,f16c")
+void F16ToF32_F16C(float *dst, const half *src, size_t num)
+{
+    size_t n8 = num & ~size_t(7);
+    for (size_t i = 0; i < n8; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+    for (size_t i = n8; i < num; ++i)
+        dst[i] = _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(src[i].value)));
+}
+#endif
+
+// intrinsics kernels. used instead of ISPC when it is not available.
+#ifdef muX86
+muTarget("sse4.1")
+uint64_t SumInt32_SSE4(const uint32_t *src, size_t num)
+{
+    __m128i sum = _mm_setzero_si128();
+    size_t n4 = num & ~size_t(3);
+    for (size_t i = 0; i < n4; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        sum = _mm_add_epi64(sum, _mm_cvtepu32_epi64(v));
+        sum = _mm_add_epi64(sum, _mm_cvtepu32_epi64(_mm_srli_si128(v, 8)));
+    }
+    uint64_t tmp[2];
+    _mm_storeu_si128((__m128i*)tmp, sum);
+    uint64_t ret = tmp[0] + tmp[1];
+    for (size_t i = n4; i < num; ++i)
+        ret += src[i];
+    return ret;
+}
+
+muTarget("avx2")
+uint64_t SumInt32_AVX2(const uint32_t *src, size_t num)
+{
+    __m256i sum = _mm256_setzero_si256();
+    size_t n8 = num & ~size_t(7);
+    for (size_t i = 0; i < n8; i += 8) {
+        sum = _mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(src + i))));
+        sum = _mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(src + i + 4))));
+    }
+    uint64_t tmp[4];
+    _mm256_storeu_si256((__m256i*)tmp, sum);
+    uint64_t ret = tmp[0] + tmp[1] + tmp[2] + tmp[3];
+    for (size_t i = n8; i < num; ++i)
+        ret += src[i];
+    return ret;
+}
+
+
+muTarget("sse4.1")
+void F64ToF32_SSE4(float *dst, const double *src, size_t num)
+{
+    size_t n4 = num & ~size_t(3);
+    for (size_t i = 0; i < n4; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+    }
+    for (size_t i = n4; i < num; ++i)
+        dst[i] = (float)src[i];
+}
+
+muTarget("avx2")
+void F64ToF32_AVX2(float *dst, const double *src, size_t num)
+{
+    size_t n8 = num & ~size_t(7);
+    for (size_t i = 0; i < n8; i += 8) {
+        _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+        _mm_storeu_ps(dst + i + 4, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i + 4)));
+    }
+    for (size_t i = n8; i < num; ++i)
+        dst[i] = (float)src[i];
+}
+
+
+// row i of a * b is the sum of b's rows weighted by a[i][0...3]
+muTarget("sse4.1")
+void MulMatrices_SSE4(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num)
+{
+    for (size_t i = 0; i < num; ++i) {
+        const float *ap = &a[i][0][0];
+        const float *bp = &b[i][0][0];
+        __m128 b0 = _mm_loadu_ps(bp + 0);
+        __m128 b1 = _mm_loadu_ps(bp + 4);
+        __m128 b2 = _mm_loadu_ps(bp + 8);
+        __m128 b3 = _mm_loadu_ps(bp + 12);
+        __m128 r[4];
+        for (int ri = 0; ri < 4; ++ri) {
+            __m128 ar = _mm_loadu_ps(ap + ri * 4);
+            r[ri] = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_shuffle_ps(ar, ar, _MM_SHUFFLE(0, 0, 0, 0)), b0),
+                    _mm_mul_ps(_mm_shuffle_ps(ar, ar, _MM_SHUFFLE(1, 1, 1, 1)), b1)),
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_shuffle_ps(ar, ar, _MM_SHUFFLE(2, 2, 2, 2)), b2),
+                    _mm_mul_ps(_mm_shuffle_ps(ar, ar, _MM_SHUFFLE(3, 3, 3, 3)), b3)));
+        }
+        // store after all rows are computed so that dst can be a or b
+        float *dp = &dst[i][0][0];
+        for (int ri = 0; ri < 4; ++ri)
+            _mm_storeu_ps(dp + ri * 4, r[ri]);
+    }
+}
+
+// two rows of a per register. b's rows are broadcast to both lanes.
+muTarget("avx2")
+void MulMatrices_AVX2(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num)
+{
+    for (size_t i = 0; i < num; ++i) {
+        const float *ap = &a[i][0][0];
+        const float *bp = &b[i][0][0];
+        __m256 b0 = _mm256_broadcast_ps((const __m128*)(bp + 0));
+        __m256 b1 = _mm256_broadcast_ps((const __m128*)(bp + 4));
+        __m256 b2 = _mm256_broadcast_ps((const __m128*)(bp + 8));
+        __m256 b3 = _mm256_broadcast_ps((const __m128*)(bp + 12));
+        __m256 r[2];
+        for (int ri = 0; ri < 2; ++ri) {
+            __m256 ar = _mm256_loadu_ps(ap + ri * 8);
+            r[ri] = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_permute_ps(ar, _MM_SHUFFLE(0, 0, 0, 0)), b0),
+                    _mm256_mul_ps(_mm256_permute_ps(ar, _MM_SHUFFLE(1, 1, 1, 1)), b1)),
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_permute_ps(ar, _MM_SHUFFLE(2, 2, 2, 2)), b2),
+                    _mm256_mul_ps(_mm256_permute_ps(ar, _MM_SHUFFLE(3, 3, 3, 3)), b3)));
+        }
+        float *dp = &dst[i][0][0];
+        _mm256_storeu_ps(dp + 0, r[0]);
+        _mm256_storeu_ps(dp + 8, r[1]);
+    }
+}
+
+
+// one element per register. the weight is broadcast to all components.
+muTarget("sse4.1")
+void LerpWeighted_SSE4(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (size_t i = 0; i < num; ++i) {
+        __m128 t = _mm_set1_ps(w[i]);
+        __m128 a = _mm_loadu_ps((const float*)(src1 + i));
+        __m128 b = _mm_loadu_ps((const float*)(src2 + i));
+        __m128 r = _mm_add_ps(_mm_mul_ps(a, _mm_sub_ps(one, t)), _mm_mul_ps(b, t));
+        _mm_storeu_ps((float*)(dst + i), r);
+    }
+}
+
+// two elements per register
+muTarget("avx2")
+void LerpWeighted_AVX2(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t n2 = num & ~size_t(1);
+    for (size_t i = 0; i < n2; i += 2) {
+        __m256 t = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(w[i])), _mm_set1_ps(w[i + 1]), 1);
+        __m256 a = _mm256_loadu_ps((const float*)(src1 + i));
+        __m256 b = _mm256_loadu_ps((const float*)(src2 + i));
+        __m256 r = _mm256_add_ps(_mm256_mul_ps(a, _mm256_sub_ps(one, t)), _mm256_mul_ps(b, t));
+        _mm256_storeu_ps((float*)(dst + i), r);
+    }
+    for (size_t i = n2; i < num; ++i)
+        dst[i] = lerp(src1[i], src2[i], w[i]);
+}
+
+// 4 quaternions are transposed to SoA and normalized-lerped at once, which is what mu::slerp() does for small angles.
+// lanes with large angles (rare for sampled animations) are redone by mu::slerp().
+muTarget("sse4.1")
+void Slerp_SSE4(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 threshold = _mm_set1_ps(0.95f);
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    size_t n4 = num & ~size_t(3);
+    for (size_t i = 0; i < n4; i += 4) {
+        __m128 ax = _mm_loadu_ps((const float*)(src1 + i + 0));
+        __m128 ay = _mm_loadu_ps((const float*)(src1 + i + 1));
+        __m128 az = _mm_loadu_ps((const float*)(src1 + i + 2));
+        __m128 aw = _mm_loadu_ps((const float*)(src1 + i + 3));
+        _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+        __m128 bx = _mm_loadu_ps((const float*)(src2 + i + 0));
+        __m128 by = _mm_loadu_ps((const float*)(src2 + i + 1));
+        __m128 bz = _mm_loadu_ps((const float*)(src2 + i + 2));
+        __m128 bw = _mm_loadu_ps((const float*)(src2 + i + 3));
+        _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+        __m128 t = _mm_loadu_ps(w + i);
+
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz)), _mm_mul_ps(aw, bw));
+        // take the shortest path
+        __m128 flip = _mm_and_ps(_mm_cmplt_ps(d, zero), sign_mask);
+        bx = _mm_xor_ps(bx, flip);
+        by = _mm_xor_ps(by, flip);
+        bz = _mm_xor_ps(bz, flip);
+        bw = _mm_xor_ps(bw, flip);
+        d = _mm_xor_ps(d, flip);
+
+        __m128 rx = _mm_add_ps(ax, _mm_mul_ps(t, _mm_sub_ps(bx, ax)));
+        __m128 ry = _mm_add_ps(ay, _mm_mul_ps(t, _mm_sub_ps(by, ay)));
+        __m128 rz = _mm_add_ps(az, _mm_mul_ps(t, _mm_sub_ps(bz, az)));
+        __m128 rw = _mm_add_ps(aw, _mm_mul_ps(t, _mm_sub_ps(bw, aw)));
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz)), _mm_mul_ps(rw, rw)));
+        rx = _mm_div_ps(rx, len);
+        ry = _mm_div_ps(ry, len);
+        rz = _mm_div_ps(rz, len);
+        rw = _mm_div_ps(rw, len);
+        _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+        _mm_storeu_ps((float*)(dst + i + 0), rx);
+        _mm_storeu_ps((float*)(dst + i + 1), ry);
+        _mm_storeu_ps((float*)(dst + i + 2), rz);
+        _mm_storeu_ps((float*)(dst + i + 3), rw);
+
+        int large = _mm_movemask_ps(_mm_cmplt_ps(d, threshold));
+        for (int li = 0; large != 0; ++li, large >>= 1) {
+            if (large & 1)
+                dst[i + li] = slerp(src1[i + li], src2[i + li], w[i + li]);
+        }
+    }
+    for (size_t i = n4; i < num; ++i)
+        dst[i] = slerp(src1[i], src2[i], w[i]);
+}
+
+// 4x4 transpose in each 128 bit lane
+muTarget("avx2")
+static inline void Transpose4x4x2(__m256& x, __m256& y, __m256& z, __m256& w)
+{
+    __m256 t0 = _mm256_unpacklo_ps(x, y), t1 = _mm256_unpacklo_ps(z, w);
+    __m256 t2 = _mm256_unpackhi_ps(x, y), t3 = _mm256_unpackhi_ps(z, w);
+    x = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    y = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    z = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    w = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// same as Slerp_SSE4() with 8 quaternions at once. src[0-3] go to the lower lane and src[4-7] to the upper lane,
+// so after the transpose, element k of each register is src[k].
+muTarget("avx2")
+void Slerp_AVX2(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 threshold = _mm256_set1_ps(0.95f);
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    size_t n8 = num & ~size_t(7);
+    for (size_t i = 0; i < n8; i += 8) {
+        const float *a = (const float*)(src1 + i);
+        const float *b = (const float*)(src2 + i);
+        __m256 ax = _mm256_loadu2_m128(a + 16, a + 0);
+        __m256 ay = _mm256_loadu2_m128(a + 20, a + 4);
+        __m256 az = _mm256_loadu2_m128(a + 24, a + 8);
+        __m256 aw = _mm256_loadu2_m128(a + 28, a + 12);
+        __m256 bx = _mm256_loadu2_m128(b + 16, b + 0);
+        __m256 by = _mm256_loadu2_m128(b + 20, b + 4);
+        __m256 bz = _mm256_loadu2_m128(b + 24, b + 8);
+        __m256 bw = _mm256_loadu2_m128(b + 28, b + 12);
+        Transpose4x4x2(ax, ay, az, aw);
+        Transpose4x4x2(bx, by, bz, bw);
+        __m256 t = _mm256_loadu_ps(w + i);
+
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)), _mm256_mul_ps(az, bz)), _mm256_mul_ps(aw, bw));
+        __m256 flip = _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_LT_OQ), sign_mask);
+        bx = _mm256_xor_ps(bx, flip);
+        by = _mm256_xor_ps(by, flip);
+        bz = _mm256_xor_ps(bz, flip);
+        bw = _mm256_xor_ps(bw, flip);
+        d = _mm256_xor_ps(d, flip);
+
+        __m256 rx = _mm256_add_ps(ax, _mm256_mul_ps(t, _mm256_sub_ps(bx, ax)));
+        __m256 ry = _mm256_add_ps(ay, _mm256_mul_ps(t, _mm256_sub_ps(by, ay)));
+        __m256 rz = _mm256_add_ps(az, _mm256_mul_ps(t, _mm256_sub_ps(bz, az)));
+        __m256 rw = _mm256_add_ps(aw, _mm256_mul_ps(t, _mm256_sub_ps(bw, aw)));
+        __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rx, rx), _mm256_mul_ps(ry, ry)), _mm256_mul_ps(rz, rz)), _mm256_mul_ps(rw, rw)));
+        rx = _mm256_div_ps(rx, len);
+        ry = _mm256_div_ps(ry, len);
+        rz = _mm256_div_ps(rz, len);
+        rw = _mm256_div_ps(rw, len);
+        Transpose4x4x2(rx, ry, rz, rw);
+        float *r = (float*)(dst + i);
+        _mm256_storeu2_m128(r + 16, r + 0, rx);
+        _mm256_storeu2_m128(r + 20, r + 4, ry);
+        _mm256_storeu2_m128(r + 24, r + 8, rz);
+        _mm256_storeu2_m128(r + 28, r + 12, rw);
+
+        int large = _mm256_movemask_ps(_mm256_cmp_ps(d, threshold, _CMP_LT_OQ));
+        for (int li = 0; large != 0; ++li, large >>= 1) {
+            if (large & 1)
+                dst[i + li] = slerp(src1[i + li], src2[i + li], w[i + li]);
+        }
+    }
+    for (size_t i = n8; i < num; ++i)
+        dst[i] = slerp(src1[i], src2[i], w[i]);
+}
+
+
+// src is treated as an array of K-component vectors (K = 1 - 4) of num scalars in total.
+// 3 registers hold a multiple of K scalars (12 or 24), so each lane always sees the same component.
+template<int K>
+muTarget("sse4.1")
+static void MinMaxF_SSE4(const float *src, size_t num, float *dst_min, float *dst_max)
+{
+    const size_t W = 12;
+    __m128 vmin[3], vmax[3];
+    for (int r = 0; r < 3; ++r) {
+        vmin[r] = _mm_set1_ps(FLT_MAX);
+        vmax[r] = _mm_set1_ps(-FLT_MAX);
+    }
+    size_t nw = num / W * W;
+    for (size_t i = 0; i < nw; i += W) {
+        for (int r = 0; r < 3; ++r) {
+            __m128 v = _mm_loadu_ps(src + i + r * 4);
+            vmin[r] = _mm_min_ps(vmin[r], v);
+            vmax[r] = _mm_max_ps(vmax[r], v);
+        }
+    }
+
+    float bmin[W], bmax[W];
+    for (int r = 0; r < 3; ++r) {
+        _mm_storeu_ps(bmin + r * 4, vmin[r]);
+        _mm_storeu_ps(bmax + r * 4, vmax[r]);
+    }
+    for (int k = 0; k < K; ++k) {
+        dst_min[k] = FLT_MAX;
+        dst_max[k] = -FLT_MAX;
+    }
+    for (size_t i = 0; i < W; ++i) {
+        dst_min[i % K] = std::min(dst_min[i % K], bmin[i]);
+        dst_max[i % K] = std::max(dst_max[i % K], bmax[i]);
+    }
+    for (size_t i = nw; i < num; ++i) {
+        dst_min[i % K] = std::min(dst_min[i % K], src[i]);
+        dst_max[i % K] = std::max(dst_max[i % K], src[i]);
+    }
+}
+
+template<int K>
+muTarget("avx2")
+static void MinMaxF_AVX2(const float *src, size_t num, float *dst_min, float *dst_max)
+{
+    const size_t W = 24;
+    __m256 vmin[3], vmax[3];
+    for (int r = 0; r < 3; ++r) {
+        vmin[r] = _mm256_set1_ps(FLT_MAX);
+        vmax[r] = _mm256_set1_ps(-FLT_MAX);
+    }
+    size_t nw = num / W * W;
+    for (size_t i = 0; i < nw; i += W) {
+        for (int r = 0; r < 3; ++r) {
+            __m256 v = _mm256_loadu_ps(src + i + r * 8);
+            vmin[r] = _mm256_min_ps(vmin[r], v);
+            vmax[r] = _mm256_max_ps(vmax[r], v);
+        }
+    }
+
+    float bmin[W], bmax[W];
+    for (int r = 0; r < 3; ++r) {
+        _mm256_storeu_ps(bmin + r * 8, vmin[r]);
+        _mm256_storeu_ps(bmax + r * 8, vmax[r]);
+    }
+    for (int k = 0; k < K; ++k) {
+        dst_min[k] = FLT_MAX;
+        dst_max[k] = -FLT_MAX;
+    }
+    for (size_t i = 0; i < W; ++i) {
+        dst_min[i % K] = std::min(dst_min[i % K], bmin[i]);
+        dst_max[i % K] = std::max(dst_max[i % K], bmax[i]);
+    }
+    for (size_t i = nw; i < num; ++i) {
+        dst_min[i % K] = std::min(dst_min[i % K], src[i]);
+        dst_max[i % K] = std::max(dst_max[i % K], src[i]);
+    }
+}
+
+muTarget("sse4.1")
+void MinMax_SSE4(const int *src, size_t num, int& dst_min, int& dst_max)
+{
+    if (num == 0)
+        return;
+    __m128i vmin = _mm_set1_epi32(src[0]);
+    __m128i vmax = vmin;
+    size_t n4 = num & ~size_t(3);
+    for (size_t i = 0; i < n4; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        vmin = _mm_min_epi32(vmin, v);
+        vmax = _mm_max_epi32(vmax, v);
+    }
+    int bmin[4], bmax[4];
+    _mm_storeu_si128((__m128i*)bmin, vmin);
+    _mm_storeu_si128((__m128i*)bmax, vmax);
+    int rmin = bmin[0], rmax = bmax[0];
+    for (int i = 1; i < 4; ++i) {
+        rmin = std::min(rmin, bmin[i]);
+        rmax = std::max(rmax, bmax[i]);
+    }
+    for (size_t i = n4; i < num; ++i) {
+        rmin = std::min(rmin, src[i]);
+        rmax = std::max(rmax, src[i]);
+    }
+    dst_min = rmin;
+    dst_max = rmax;
+}
+
+muTarget("avx2")
+void MinMax_AVX2(const int *src, size_t num, int& dst_min, int& dst_max)
+{
+    if (num == 0)
+        return;
+    __m256i vmin = _mm256_set1_epi32(src[0]);
+    __m256i vmax = vmin;
+    size_t n8 = num & ~size_t(7);
+    for (size_t i = 0; i < n8; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        vmin = _mm256_min_epi32(vmin, v);
+        vmax = _mm256_max_epi32(vmax, v);
+    }
+    int bmin[8], bmax[8];
+    _mm256_storeu_si256((__m256i*)bmin, vmin);
+    _mm256_storeu_si256((__m256i*)bmax, vmax);
+    int rmin = bmin[0], rmax = bmax[0];
+    for (int i = 1; i < 8; ++i) {
+        rmin = std::min(rmin, bmin[i]);
+        rmax = std::max(rmax, bmax[i]);
+    }
+    for (size_t i = n8; i < num; ++i) {
+        rmin = std::min(rmin, src[i]);
+        rmax = std::max(rmax, src[i]);
+    }
+    dst_min = rmin;
+    dst_max = rmax;
+}
+
+#define Def(T, K)\
+    void MinMax_SSE4(const T *src, size_t num, T& dst_min, T& dst_max) { if (num > 0) MinMaxF_SSE4<K>((const float*)src, num * K, (float*)&dst_min, (float*)&dst_max); }\
+    void MinMax_AVX2(const T *src, size_t num, T& dst_min, T& dst_max) { if (num > 0) MinMaxF_AVX2<K>((const float*)src, num * K, (float*)&dst_min, (float*)&dst_max); }
+Def(float, 1)
+Def(float2, 2)
+Def(float3, 3)
+Def(float4, 4)
+#undef Def
+
+
+// 4 float3 in 3 registers: a = {x0 y0 z0 x1}, b = {y1 z1 x2 y2}, c = {z2 x3 y3 z3}.
+// transposed to x = {x0 x1 x2 x3}, y = {y0 ...}, z = {z0 ...} and back.
+// with AVX, the same shuffles work on 8 float3 as each 128 bit lane holds 4 of them.
+#define muAoSToSoA(Shuffle, a, b, c, x, y, z)\
+    x = Shuffle(a, Shuffle(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));\
+    y = Shuffle(Shuffle(a, b, _MM_SHUFFLE(0, 0, 1, 1)), Shuffle(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));\
+    z = Shuffle(Shuffle(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+#define muSoAToAoS(Shuffle, x, y, z, a, b, c)\
+    a = Shuffle(Shuffle(x, y, _MM_SHUFFLE(0, 0, 0, 0)), Shuffle(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));\
+    b = Shuffle(Shuffle(y, z, _MM_SHUFFLE(1, 1, 1, 1)), Shuffle(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));\
+    c = Shuffle(Shuffle(z, x, _MM_SHUFFLE(3, 3, 2, 2)), Shuffle(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+
+// same operations in the same order as normalize(), so results are identical to Normalize_Generic()
+muTarget("sse4.1")
+void Normalize_SSE4(float3 *dst, size_t num)
+{
+    size_t n4 = num & ~size_t(3);
+    for (size_t i = 0; i < n4; i += 4) {
+        float *p = (float*)(dst + i);
+        __m128 a = _mm_loadu_ps(p + 0), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+        __m128 x, y, z;
+        muAoSToSoA(_mm_shuffle_ps, a, b, c, x, y, z);
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+        x = _mm_div_ps(x, len);
+        y = _mm_div_ps(y, len);
+        z = _mm_div_ps(z, len);
+        muSoAToAoS(_mm_shuffle_ps, x, y, z, a, b, c);
+        _mm_storeu_ps(p + 0, a);
+        _mm_storeu_ps(p + 4, b);
+        _mm_storeu_ps(p + 8, c);
+    }
+    for (size_t i = n4; i < num; ++i)
+        dst[i] = normalize(dst[i]);
+}
+
+muTarget("avx")
+static inline __m256 Load2x128(const float *lo, const float *hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+}
+
+muTarget("avx")
+static inline void Store2x128(float *lo, float *hi, __m256 v)
+{
+    _mm_storeu_ps(lo, _mm256_castps256_ps128(v));
+    _mm_storeu_ps(hi, _mm256_extractf128_ps(v, 1));
+}
+
+muTarget("avx2")
+void Normalize_AVX2(float3 *dst, size_t num)
+{
+    size_t n8 = num & ~size_t(7);
+    for (size_t i = 0; i < n8; i += 8) {
+        // lower lanes: dst[i + 0 - 3], upper lanes: dst[i + 4 - 7]
+        float *p = (float*)(dst + i);
+        __m256 a = Load2x128(p + 0, p + 12), b = Load2x128(p + 4, p + 16), c = Load2x128(p + 8, p + 20);
+        __m256 x, y, z;
+        muAoSToSoA(_mm256_shuffle_ps, a, b, c, x, y, z);
+        __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+        x = _mm256_div_ps(x, len);
+        y = _mm256_div_ps(y, len);
+        z = _mm256_div_ps(z, len);
+        muSoAToAoS(_mm256_shuffle_ps, x, y, z, a, b, c);
+        Store2x128(p + 0, p + 12, a);
+        Store2x128(p + 4, p + 16, b);
+        Store2x128(p + 8, p + 20, c);
+    }
+    Normalize_SSE4(dst + n8, num - n8);
+}
+#undef muAoSToSoA
+#undef muSoAToAoS
+
+
+muTarget("sse4.1")
+static inline __m128 Load3(const float3& v)
+{
+    return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)&v)), _mm_load_ss(&v.z));
+}
+
+muTarget("sse4.1")
+static inline void Store3(float3& v, __m128 a)
+{
+    _mm_store_sd((double*)&v, _mm_castps_pd(a));
+    _mm_store_ss(&v.z, _mm_movehl_ps(a, a));
+}
+
+// normals are accumulated in the order of triangles as GenerateNormalsTriangleIndexed_Generic() does,
+// so results are identical to it.
+muTarget("sse4.1")
+static void AccumulateNormals_SSE4(float3 *dst,
+    const float3 *vertices, const int *indices, int num_triangles, int num_vertices)
+{
+    memset(dst, 0, sizeof(float3)*num_vertices);
+
+    for (int ti = 0; ti < num_triangles; ++ti) {
+        const int *idx = indices + ti * 3;
+        __m128 p0 = Load3(vertices[idx[0]]);
+        __m128 e1 = _mm_sub_ps(Load3(vertices[idx[1]]), p0);
+        __m128 e2 = _mm_sub_ps(Load3(vertices[idx[2]]), p0);
+        // cross(e1, e2) = e1.yzx * e2.zxy - e1.zxy * e2.yzx
+        __m128 n = _mm_sub_ps(
+            _mm_mul_ps(_mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 1, 0, 2))),
+            _mm_mul_ps(_mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 0, 2, 1))));
+        for (int i = 0; i < 3; ++i)
+            Store3(dst[idx[i]], _mm_add_ps(Load3(dst[idx[i]]), n));
+    }
+}
+
+void GenerateNormalsTriangleIndexed_SSE4(float3 *dst,
+    const float3 *vertices, const int *indices, int num_triangles, int num_vertices)
+{
+    AccumulateNormals_SSE4(dst, vertices, indices, num_triangles, num_vertices);
+    Normalize_SSE4(dst, num_vertices);
+}
+
+// accumulation is bound by the scattered adds, and cross products of 8 triangles by gathers turned out to be
+// slower than the SSE path. only normalization is wider.
+void GenerateNormalsTriangleIndexed_AVX2(float3 *dst,
+    const float3 *vertices, const int *indices, int num_triangles, int num_vertices)
+{
+    AccumulateNormals_SSE4(dst, vertices, indices, num_triangles, num_vertices);
+    Normalize_AVX2(dst, num_vertices);
+}
+#endif
+
 
 #ifdef muEnableISPC
 #include "MeshUtilsCore.h"
@@ -21,6 +698,10 @@ void F32ToF16_ISPC(half *dst, const float *src, size_t num) { ispc::F32ToF16((ui
 void F16ToF32_ISPC(float *dst, const half *src, size_t num) { ispc::F16ToF32(dst, (const uint16_t*)src, (int)num); }
 #endif
 
+#ifdef muSIMD_Double_Conversion
+void F64ToF32_ISPC(float *dst, const double *src, size_t num) { ispc::F64ToF32(dst, src, (int)num); }
+#endif
+
 #ifdef muSIMD_Float_Norm_Conversion
 void F32ToS8_ISPC(snorm8 *dst, const float *src, size_t num) { ispc::F32ToS8((int8_t*)dst, src, (int)num); }
 void S8ToF32_ISPC(float *dst, const snorm8 *src, size_t num) { ispc::S8ToF32(dst, (int8_t*)src, (int)num); }
@@ -78,6 +759,18 @@ void Lerp_ISPC(float *dst, const float *src1, const float *src2, size_t num, flo
     ispc::Lerp(dst, src1, src2, (int)num, w);
 }
 #endif
+#ifdef muSIMD_LerpWeighted
+void LerpWeighted_ISPC(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num)
+{
+    ispc::LerpWeighted((ispc::float4*)dst, (ispc::float4*)src1, (ispc::float4*)src2, w, (int)num);
+}
+#endif
+#ifdef muSIMD_Slerp
+void Slerp_ISPC(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num)
+{
+    ispc::Slerp((ispc::quatf*)dst, (ispc::quatf*)src1, (ispc::quatf*)src2, w, (int)num);
+}
+#endif
 
 #ifdef muSIMD_NearEqual
 bool NearEqual_ISPC(const float *src1, const float *src2, size_t num, float eps)
@@ -121,6 +814,52 @@ void MulVectors_ISPC(const float4x4& m, const float3 src[], float3 dst[], size_t
     ispc::MulVectors3((ispc::float4x4&)m, (ispc::float3*)src, (ispc::float3*)dst, (int)num_data);
 }
 #endif
+#ifdef muSIMD_MulNormals3
+void MulNormals_ISPC(const float4x4& m, const float3 src[], float3 dst[], size_t num_data)
+{
+    ispc::MulNormals3((ispc::float4x4&)m, (ispc::float3*)src, (ispc::float3*)dst, (int)num_data);
+}
+#endif
+#ifdef muSIMD_MulTangents4
+void MulTangents_ISPC(const float4x4& m, const float4 src[], float4 dst[], size_t num_data)
+{
+    ispc::MulTangents4((ispc::float4x4&)m, (ispc::float4*)src, (ispc::float4*)dst, (int)num_data);
+}
+#endif
+#ifdef muSIMD_MulMatrices
+void MulMatrices_ISPC(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num)
+{
+    ispc::MulMatrices((ispc::float4x4*)a, (ispc::float4x4*)b, (ispc::float4x4*)dst, (int)num);
+}
+#endif
+#ifdef muSIMD_MulPoints3D
+void MulPoints_ISPC(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    ispc::MulPoints3D((ispc::double4x4&)m, (ispc::double3*)src, (ispc::float3*)dst, (int)num_data);
+}
+#endif
+#ifdef muSIMD_MulVectors3D
+void MulVectors_ISPC(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    ispc::MulVectors3D((ispc::double4x4&)m, (ispc::double3*)src, (ispc::float3*)dst, (int)num_data);
+}
+#endif
+#ifdef muSIMD_MulNormals3D
+void MulNormals_ISPC(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    ispc::MulNormals3D((ispc::double4x4&)m, (ispc::double3*)src, (ispc::float3*)dst, (int)num_data);
+}
+#endif
+#ifdef muSIMD_Skin4
+void Skin4_ISPC(const float4x4 bones[], const Weights4 weights[],
+    const float3 src_points[], const float3 src_normals[], const float4 src_tangents[],
+    float3 dst_points[], float3 dst_normals[], float4 dst_tangents[], size_t num_data)
+{
+    ispc::Skin4((ispc::float4x4*)bones, (ispc::Weights4*)weights,
+        (ispc::float3*)src_points, (ispc::float3*)src_normals, (ispc::float4*)src_tangents,
+        (ispc::float3*)dst_points, (ispc::float3*)dst_normals, (ispc::float4*)dst_tangents, (int)num_data);
+}
+#endif
 
 
 #ifdef muSIMD_RayTrianglesIntersectionIndexed
@@ -267,21 +1006,57 @@ void GenerateTangentsTriangleSoA_ISPC(float4 *dst,
 
 
 #ifdef muEnableISPC
-    #define Forward(Name, ...) Name##_ISPC(__VA_ARGS__)
+    // ISPC kernels require SSE4 at least
+    #define Forward(Name, ...) (g_simd_level >= SIMDLevel::SSE4 ? Name##_ISPC(__VA_ARGS__) : Name##_Generic(__VA_ARGS__))
 #else
     #define Forward(Name, ...) Name##_Generic(__VA_ARGS__)
 #endif
 
+#if !defined(muEnableISPC) && defined(muX86)
+    // use intrinsics kernels as the fallback of ISPC. for kernels that have _SSE4 and _AVX2 variants.
+    #define ForwardX86(Name, ...) (\
+        g_simd_level >= SIMDLevel::AVX2 ? Name##_AVX2(__VA_ARGS__) :\
+        g_simd_level >= SIMDLevel::SSE4 ? Name##_SSE4(__VA_ARGS__) :\
+        Name##_Generic(__VA_ARGS__))
+#else
+    #define ForwardX86(Name, ...) Forward(Name, __VA_ARGS__)
+#endif
+
 #if defined(muSIMD_SumInt32) || !defined(muEnableISPC)
 uint64_t SumInt32(const void *src, size_t num)
 {
-    return Forward(SumInt32, (uint32_t*)src, num / sizeof(uint32_t));
+    return ForwardX86(SumInt32, (uint32_t*)src, num / sizeof(uint32_t));
 }
 #endif
 
 #if defined(muSIMD_Float_Half_Conversion) || !defined(muEnableISPC)
-void F32ToF16(half *dst, const float *src, size_t num) { Forward(F32ToF16, dst, src, num); }
-void F16ToF32(float *dst, const half *src, size_t num) { Forward(F16ToF32, dst, src, num); }
+void F32ToF16(half *dst, const float *src, size_t num)
+{
+#ifdef muX86
+    if (g_simd_level >= SIMDLevel::AVX2) {
+        F32ToF16_F16C(dst, src, num);
+        return;
+    }
+#endif
+    Forward(F32ToF16, dst, src, num);
+}
+void F16ToF32(float *dst, const half *src, size_t num)
+{
+#ifdef muX86
+    if (g_simd_level >= SIMDLevel::AVX2) {
+        F16ToF32_F16C(dst, src, num);
+        return;
+    }
+#endif
+    Forward(F16ToF32, dst, src, num);
+}
+#endif
+
+#if defined(muSIMD_Double_Conversion) || !defined(muEnableISPC)
+void F64ToF32(float *dst, const double *src, size_t num)
+{
+    ForwardX86(F64ToF32, dst, src, num);
+}
 #endif
 
 #if defined(muSIMD_Float_Norm_Conversion) || !defined(muEnableISPC)
@@ -331,7 +1106,7 @@ void Scale(float3 *dst, float s, size_t num)
 #if defined(muSIMD_Normalize) || !defined(muEnableISPC)
 void Normalize(float3 *dst, size_t num)
 {
-    Forward(Normalize, dst, num);
+    ForwardX86(Normalize, dst, num);
 }
 #endif
 
@@ -353,13 +1128,25 @@ void Lerp(float4 *dst, const float4 *src1, const float4 *src2, size_t num, float
     Lerp((float*)dst, (const float*)src1, (const float*)src2, num * 4, w);
 }
 #endif
+#if defined(muSIMD_LerpWeighted) || !defined(muEnableISPC)
+void LerpWeighted(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num)
+{
+    ForwardX86(LerpWeighted, dst, src1, src2, w, num);
+}
+#endif
+#if defined(muSIMD_Slerp) || !defined(muEnableISPC)
+void Slerp(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num)
+{
+    ForwardX86(Slerp, dst, src1, src2, w, num);
+}
+#endif
 
 #if defined(muSIMD_MinMax) || !defined(muEnableISPC)
-void MinMax(const int *p, size_t num, int& dst_min, int& dst_max) { Forward(MinMax, p, num, dst_min, dst_max); }
-void MinMax(const float *p, size_t num, float& dst_min, float& dst_max) { Forward(MinMax, p, num, dst_min, dst_max); }
-void MinMax(const float2 *p, size_t num, float2& dst_min, float2& dst_max) { Forward(MinMax, p, num, dst_min, dst_max); }
-void MinMax(const float3 *p, size_t num, float3& dst_min, float3& dst_max) { Forward(MinMax, p, num, dst_min, dst_max); }
-void MinMax(const float4 *p, size_t num, float4& dst_min, float4& dst_max) { Forward(MinMax, p, num, dst_min, dst_max); }
+void MinMax(const int *p, size_t num, int& dst_min, int& dst_max) { ForwardX86(MinMax, p, num, dst_min, dst_max); }
+void MinMax(const float *p, size_t num, float& dst_min, float& dst_max) { ForwardX86(MinMax, p, num, dst_min, dst_max); }
+void MinMax(const float2 *p, size_t num, float2& dst_min, float2& dst_max) { ForwardX86(MinMax, p, num, dst_min, dst_max); }
+void MinMax(const float3 *p, size_t num, float3& dst_min, float3& dst_max) { ForwardX86(MinMax, p, num, dst_min, dst_max); }
+void MinMax(const float4 *p, size_t num, float4& dst_min, float4& dst_max) { ForwardX86(MinMax, p, num, dst_min, dst_max); }
 #endif
 
 #if defined(muSIMD_NearEqual) || !defined(muEnableISPC)
@@ -393,6 +1180,50 @@ void MulVectors(const float4x4& m, const float3 src[], float3 dst[], size_t num_
     Forward(MulVectors, m, src, dst, num_data);
 }
 #endif
+#if defined(muSIMD_MulNormals3) || !defined(muEnableISPC)
+void MulNormals(const float4x4& m, const float3 src[], float3 dst[], size_t num_data)
+{
+    Forward(MulNormals, m, src, dst, num_data);
+}
+#endif
+#if defined(muSIMD_MulTangents4) || !defined(muEnableISPC)
+void MulTangents(const float4x4& m, const float4 src[], float4 dst[], size_t num_data)
+{
+    Forward(MulTangents, m, src, dst, num_data);
+}
+#endif
+#if defined(muSIMD_MulMatrices) || !defined(muEnableISPC)
+void MulMatrices(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num)
+{
+    ForwardX86(MulMatrices, a, b, dst, num);
+}
+#endif
+#if defined(muSIMD_MulPoints3D) || !defined(muEnableISPC)
+void MulPoints(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    Forward(MulPoints, m, src, dst, num_data);
+}
+#endif
+#if defined(muSIMD_MulVectors3D) || !defined(muEnableISPC)
+void MulVectors(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    Forward(MulVectors, m, src, dst, num_data);
+}
+#endif
+#if defined(muSIMD_MulNormals3D) || !defined(muEnableISPC)
+void MulNormals(const double4x4& m, const double3 src[], float3 dst[], size_t num_data)
+{
+    Forward(MulNormals, m, src, dst, num_data);
+}
+#endif
+#if defined(muSIMD_Skin4) || !defined(muEnableISPC)
+void Skin4(const float4x4 bones[], const Weights4 weights[],
+    const float3 src_points[], const float3 src_normals[], const float4 src_tangents[],
+    float3 dst_points[], float3 dst_normals[], float4 dst_tangents[], size_t num_data)
+{
+    Forward(Skin4, bones, weights, src_points, src_normals, src_tangents, dst_points, dst_normals, dst_tangents, num_data);
+}
+#endif
 
 #if defined(muSIMD_RayTrianglesIntersectionIndexed) || !defined(muEnableISPC)
 int RayTrianglesIntersectionIndexed(float3 pos, float3 dir, const float3 *vertices, const int *indices, int num_triangles, int& tindex, float& result)
@@ -440,7 +1271,7 @@ bool PolyInside(const float px[], const float py[], int ngon, const float2 minp,
 void GenerateNormalsTriangleIndexed(float3 *dst,
     const float3 *vertices, const int *indices, int num_triangles, int num_vertices)
 {
-    return Forward(GenerateNormalsTriangleIndexed, dst, vertices, indices, num_triangles, num_vertices);
+    return ForwardX86(GenerateNormalsTriangleIndexed, dst, vertices, indices, num_triangles, num_vertices);
 }
 #endif
 #if defined(muSIMD_GenerateNormalsTriangleFlattened) || !defined(muEnableISPC)
@@ -500,4 +1331,6 @@ void GenerateTangentsTriangleSoA(float4 *dst,
 #endif
 
 #undef Forward
+#undef ForwardX86
+#undef muTarget
 } // namespace mu
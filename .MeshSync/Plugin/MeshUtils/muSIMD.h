@@ -1,15 +1,51 @@
 #pragma once
+#include "muConfig.h"
 #include "muSIMDConfig.h"
 #include "muHalf.h"
+#include "muVertex.h"
 
 namespace mu {
 
+// CPU features detected by CPUID. all false on non-x86 CPUs.
+// avx, avx2, fma, f16c and avx512f are true only if the OS also saves the extended registers.
+struct CPUFeatures
+{
+    bool sse41 = false;
+    bool sse42 = false;
+    bool avx = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool f16c = false;
+    bool avx512f = false;
+};
+const CPUFeatures& GetCPUFeatures();
+
+// kernels below are dispatched at runtime by this level. the default is the highest level the CPU supports.
+// ISPC kernels are used from SSE4 (ISPC selects the best of its compiled targets by itself),
+// and half <-> float conversions use F16C from AVX2.
+// without ISPC, SumInt32(), F64ToF32(), Normalize(), MinMax(), MulMatrices(), LerpWeighted(), Slerp() and
+// GenerateNormalsTriangleIndexed() use SSE4 / AVX2 intrinsics and the others fall back to Generic.
+enum class SIMDLevel
+{
+    Generic,
+    SSE4,
+    AVX2,
+    AVX512,
+};
+SIMDLevel GetSIMDLevel();
+SIMDLevel GetMaxSIMDLevel();
+// mainly for test and benchmark. v is clamped to GetMaxSIMDLevel(). not thread safe.
+void SetSIMDLevel(SIMDLevel v);
+
 uint64_t SumInt32(const void *src, size_t num);
 
 // float <-> half
 void F32ToF16(half *dst, const float *src, size_t num);
 void F16ToF32(float *dst, const half *src, size_t num);
 
+// double -> float. for sources in double precision (DCC tools' SDKs)
+void F64ToF32(float *dst, const double *src, size_t num);
+
 // float <-> norm
 void F32ToS8(snorm8 *dst, const float *src, size_t num);
 void S8ToF32(float *dst, const snorm8 *src, size_t num);
@@ -37,6 +73,10 @@ void Lerp(float  *dst, const float  *src1, const float  *src2, size_t num, float
 void Lerp(float2 *dst, const float2 *src1, const float2 *src2, size_t num, float w);
 void Lerp(float3 *dst, const float3 *src1, const float3 *src2, size_t num, float w);
 void Lerp(float4 *dst, const float4 *src1, const float4 *src2, size_t num, float w);
+// dst[i] = src1[i] * (1 - w[i]) + src2[i] * w[i]. weights per element (e.g. interpolation of animation keys).
+void LerpWeighted(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num);
+// dst[i] = slerp(src1[i], src2[i], w[i]). dst must not overlap src1 and src2.
+void Slerp(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num);
 void MinMax(const int *src, size_t num, int& dst_min, int& dst_max);
 void MinMax(const float *src, size_t num, float& dst_min, float& dst_max);
 void MinMax(const float2 *src, size_t num, float2& dst_min, float2& dst_max);
@@ -49,6 +89,25 @@ bool NearEqual(const float4 *src1, const float4 *src2, size_t num, float eps = m
 
 void MulPoints(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
 void MulVectors(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
+// transform and normalize. m should be inverse transpose of the point transform.
+void MulNormals(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
+// transform and normalize xyz. w is preserved.
+void MulTangents(const float4x4& m, const float4 src[], float4 dst[], size_t num_data);
+
+// dst[i] = a[i] * b[i]. dst can be a or b.
+void MulMatrices(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num);
+
+// double3 -> float3 with transform in the same pass. transform is done in double precision.
+// scale and handedness conversions can be composed into m (e.g. m * scale44({ -s, s, s }) to flip x and scale by s).
+void MulPoints(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+void MulVectors(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+void MulNormals(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+
+// linear blend skinning with up to 4 influences per vertex. bones are skinning matrices (bind pose to destination space).
+// normals and tangents are normalized and w of tangents is preserved. each src/dst pair can be null. src and dst can be the same.
+void Skin4(const float4x4 bones[], const Weights4 weights[],
+    const float3 src_points[], const float3 src_normals[], const float4 src_tangents[],
+    float3 dst_points[], float3 dst_normals[], float4 dst_tangents[], size_t num_data);
 
 int RayTrianglesIntersectionIndexed(float3 pos, float3 dir, const float3 *vertices, const int *indices, int num_triangles, int& tindex, float& distance);
 int RayTrianglesIntersectionFlattened(float3 pos, float3 dir, const float3 *vertices, int num_triangles, int& tindex, float& distance);
@@ -107,6 +166,39 @@ void F32ToF16_Generic(half *dst, const float *src, size_t num);
 void F32ToF16_ISPC(half *dst, const float *src, size_t num);
 void F16ToF32_Generic(float *dst, const half *src, size_t num);
 void F16ToF32_ISPC(float *dst, const half *src, size_t num);
+void F64ToF32_Generic(float *dst, const double *src, size_t num);
+void F64ToF32_ISPC(float *dst, const double *src, size_t num);
+#ifdef muX86
+void F32ToF16_F16C(half *dst, const float *src, size_t num);
+void F16ToF32_F16C(float *dst, const half *src, size_t num);
+
+uint64_t SumInt32_SSE4(const uint32_t *src, size_t num);
+uint64_t SumInt32_AVX2(const uint32_t *src, size_t num);
+void F64ToF32_SSE4(float *dst, const double *src, size_t num);
+void F64ToF32_AVX2(float *dst, const double *src, size_t num);
+void Normalize_SSE4(float3 *dst, size_t num);
+void Normalize_AVX2(float3 *dst, size_t num);
+void MulMatrices_SSE4(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num);
+void MulMatrices_AVX2(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num);
+void LerpWeighted_SSE4(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num);
+void LerpWeighted_AVX2(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num);
+void Slerp_SSE4(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num);
+void Slerp_AVX2(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num);
+void MinMax_SSE4(const int *src, size_t num, int& dst_min, int& dst_max);
+void MinMax_AVX2(const int *src, size_t num, int& dst_min, int& dst_max);
+void MinMax_SSE4(const float *src, size_t num, float& dst_min, float& dst_max);
+void MinMax_AVX2(const float *src, size_t num, float& dst_min, float& dst_max);
+void MinMax_SSE4(const float2 *src, size_t num, float2& dst_min, float2& dst_max);
+void MinMax_AVX2(const float2 *src, size_t num, float2& dst_min, float2& dst_max);
+void MinMax_SSE4(const float3 *src, size_t num, float3& dst_min, float3& dst_max);
+void MinMax_AVX2(const float3 *src, size_t num, float3& dst_min, float3& dst_max);
+void MinMax_SSE4(const float4 *src, size_t num, float4& dst_min, float4& dst_max);
+void MinMax_AVX2(const float4 *src, size_t num, float4& dst_min, float4& dst_max);
+void GenerateNormalsTriangleIndexed_SSE4(float3 *dst,
+    const float3 *vertices, const int *indices, int num_triangles, int num_vertices);
+void GenerateNormalsTriangleIndexed_AVX2(float3 *dst,
+    const float3 *vertices, const int *indices, int num_triangles, int num_vertices);
+#endif
 
 void F32ToS8_Generic(snorm8 *dst, const float *src, size_t num);
 void F32ToS8_ISPC(snorm8 *dst, const float *src, size_t num);
@@ -159,6 +251,10 @@ void Normalize_ISPC(float3 *dst, size_t num);
 
 void Lerp_Generic(float *dst, const float *src1, const float *src2, size_t num, float w);
 void Lerp_ISPC(float *dst, const float *src1, const float *src2, size_t num, float w);
+void LerpWeighted_Generic(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num);
+void LerpWeighted_ISPC(float4 *dst, const float4 *src1, const float4 *src2, const float *w, size_t num);
+void Slerp_Generic(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num);
+void Slerp_ISPC(quatf *dst, const quatf *src1, const quatf *src2, const float *w, size_t num);
 
 void MinMax_Generic(const int *src, size_t num, int& dst_min, int& dst_max);
 void MinMax_ISPC(const int *src, size_t num, int& dst_min, int& dst_max);
@@ -178,6 +274,25 @@ void MulPoints_Generic(const float4x4& m, const float3 src[], float3 dst[], size
 void MulPoints_ISPC(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
 void MulVectors_Generic(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
 void MulVectors_ISPC(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
+void MulNormals_Generic(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
+void MulNormals_ISPC(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
+void MulTangents_Generic(const float4x4& m, const float4 src[], float4 dst[], size_t num_data);
+void MulTangents_ISPC(const float4x4& m, const float4 src[], float4 dst[], size_t num_data);
+void MulMatrices_Generic(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num);
+void MulMatrices_ISPC(const float4x4 a[], const float4x4 b[], float4x4 dst[], size_t num);
+void MulPoints_Generic(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+void MulPoints_ISPC(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+void MulVectors_Generic(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+void MulVectors_ISPC(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+void MulNormals_Generic(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+void MulNormals_ISPC(const double4x4& m, const double3 src[], float3 dst[], size_t num_data);
+
+void Skin4_Generic(const float4x4 bones[], const Weights4 weights[],
+    const float3 src_points[], const float3 src_normals[], const float4 src_tangents[],
+    float3 dst_points[], float3 dst_normals[], float4 dst_tangents[], size_t num_data);
+void Skin4_ISPC(const float4x4 bones[], const Weights4 weights[],
+    const float3 src_points[], const float3 src_normals[], const float4 src_tangents[],
+    float3 dst_points[], float3 dst_normals[], float4 dst_tangents[], size_t num_data);
 
 int RayTrianglesIntersectionIndexed_Generic(float3 pos, float3 dir, const float3 *vertices, const int *indices, int num_triangles, int& tindex, float& distance);
 int RayTrianglesIntersectionIndexed_ISPC(float3 pos, float3 dir, const float3 *vertices, const int *indices, int num_triangles, int& tindex, float& distance);
@@ -4,18 +4,29 @@
 
 #define muSIMD_Float_Half_Conversion
 #define muSIMD_Float_Norm_Conversion
+#define muSIMD_Double_Conversion
 
 #define muSIMD_InvertX3
 #define muSIMD_InvertX4
 #define muSIMD_Scale
 #define muSIMD_Normalize
 #define muSIMD_Lerp
+#define muSIMD_LerpWeighted
+#define muSIMD_Slerp
 #define muSIMD_NearEqual
 
 #define muSIMD_MinMax
 
 #define muSIMD_MulVectors3
 #define muSIMD_MulPoints3
+#define muSIMD_MulNormals3
+#define muSIMD_MulTangents4
+#define muSIMD_MulMatrices
+#define muSIMD_MulPoints3D
+#define muSIMD_MulVectors3D
+#define muSIMD_MulNormals3D
+
+#define muSIMD_Skin4
 
 //#define muSIMD_RayTrianglesIntersectionIndexed
 //#define muSIMD_RayTrianglesIntersectionFlattened
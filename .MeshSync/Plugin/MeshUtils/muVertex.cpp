@@ -4,46 +4,95 @@
 
 namespace mu {
 
+static inline void ConvertAttr(float2& dst, const float2& src) { dst = src; }
+static inline void ConvertAttr(float3& dst, const float3& src) { dst = src; }
+static inline void ConvertAttr(float4& dst, const float4& src) { dst = src; }
+static inline void ConvertAttr(half2& dst, const float2& src) { dst = to<half2>(src); }
+static inline void ConvertAttr(half4& dst, const float3& src) { dst = { src.x, src.y, src.z, 0.0f }; }
+static inline void ConvertAttr(half4& dst, const float4& src) { dst = to<half4>(src); }
+static inline void ConvertAttr(unorm8x4& dst, const float4& src) { dst = to<unorm8x4>(src); }
+static inline void ConvertAttr(snorm10x3& dst, const float3& src) { dst = src; }
+static inline void ConvertAttr(snorm10x3& dst, const float4& src) { dst = encode_tangent(src); }
+
+template<class D, class S>
+static inline void CopyAttr(D& dst, const S *src, size_t i)
+{
+    if (src)
+        ConvertAttr(dst, src[i]);
+    else
+        memset(&dst, 0, sizeof(D));
+}
+
 template<class VertexT> static inline void InterleaveImpl(VertexT *dst, const typename VertexT::arrays_t& src, size_t i);
 
 template<> inline void InterleaveImpl(vertex_v3n3 *dst, const vertex_v3n3::arrays_t& src, size_t i)
 {
     dst[i].p = src.points[i];
-    dst[i].n = src.normals[i];
+    CopyAttr(dst[i].n, src.normals, i);
 }
 template<> inline void InterleaveImpl(vertex_v3n3c4 *dst, const vertex_v3n3c4::arrays_t& src, size_t i)
 {
     dst[i].p = src.points[i];
-    dst[i].n = src.normals[i];
-    dst[i].c = src.colors[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].c, src.colors, i);
 }
 template<> inline void InterleaveImpl(vertex_v3n3u2 *dst, const vertex_v3n3u2::arrays_t& src, size_t i)
 {
     dst[i].p = src.points[i];
-    dst[i].n = src.normals[i];
-    dst[i].u = src.uvs[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].u, src.uvs, i);
 }
 template<> inline void InterleaveImpl(vertex_v3n3c4u2 *dst, const vertex_v3n3c4u2::arrays_t& src, size_t i)
 {
     dst[i].p = src.points[i];
-    dst[i].n = src.normals[i];
-    dst[i].c = src.colors[i];
-    dst[i].u = src.uvs[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].c, src.colors, i);
+    CopyAttr(dst[i].u, src.uvs, i);
 }
 template<> inline void InterleaveImpl(vertex_v3n3u2t4 *dst, const vertex_v3n3u2t4::arrays_t& src, size_t i)
 {
     dst[i].p = src.points[i];
-    dst[i].n = src.normals[i];
-    dst[i].u = src.uvs[i];
-    dst[i].t = src.tangents[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].u, src.uvs, i);
+    CopyAttr(dst[i].t, src.tangents, i);
 }
 template<> inline void InterleaveImpl(vertex_v3n3c4u2t4 *dst, const vertex_v3n3c4u2t4::arrays_t& src, size_t i)
 {
     dst[i].p = src.points[i];
-    dst[i].n = src.normals[i];
-    dst[i].c = src.colors[i];
-    dst[i].u = src.uvs[i];
-    dst[i].t = src.tangents[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].c, src.colors, i);
+    CopyAttr(dst[i].u, src.uvs, i);
+    CopyAttr(dst[i].t, src.tangents, i);
+}
+template<> inline void InterleaveImpl(vertex_v3n3u2t4_half *dst, const vertex_v3n3u2t4_half::arrays_t& src, size_t i)
+{
+    dst[i].p = src.points[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].u, src.uvs, i);
+    CopyAttr(dst[i].t, src.tangents, i);
+}
+template<> inline void InterleaveImpl(vertex_v3n3c4u2t4_half *dst, const vertex_v3n3c4u2t4_half::arrays_t& src, size_t i)
+{
+    dst[i].p = src.points[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].c, src.colors, i);
+    CopyAttr(dst[i].u, src.uvs, i);
+    CopyAttr(dst[i].t, src.tangents, i);
+}
+template<> inline void InterleaveImpl(vertex_v3n3u2t4_s10x3 *dst, const vertex_v3n3u2t4_s10x3::arrays_t& src, size_t i)
+{
+    dst[i].p = src.points[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].u, src.uvs, i);
+    CopyAttr(dst[i].t, src.tangents, i);
+}
+template<> inline void InterleaveImpl(vertex_v3n3c4u2t4_s10x3 *dst, const vertex_v3n3c4u2t4_s10x3::arrays_t& src, size_t i)
+{
+    dst[i].p = src.points[i];
+    CopyAttr(dst[i].n, src.normals, i);
+    CopyAttr(dst[i].c, src.colors, i);
+    CopyAttr(dst[i].u, src.uvs, i);
+    CopyAttr(dst[i].t, src.tangents, i);
 }
 
 template<class VertexT>
@@ -82,6 +131,10 @@ size_t GetVertexSize(VertexFormat format)
     case VertexFormat::V3N3C4U2: return sizeof(vertex_v3n3c4u2);
     case VertexFormat::V3N3U2T4: return sizeof(vertex_v3n3u2t4);
     case VertexFormat::V3N3C4U2T4: return sizeof(vertex_v3n3c4u2t4);
+    case VertexFormat::V3N3U2T4_Half: return sizeof(vertex_v3n3u2t4_half);
+    case VertexFormat::V3N3C4U2T4_Half: return sizeof(vertex_v3n3c4u2t4_half);
+    case VertexFormat::V3N3U2T4_S10x3: return sizeof(vertex_v3n3u2t4_s10x3);
+    case VertexFormat::V3N3C4U2T4_S10x3: return sizeof(vertex_v3n3c4u2t4_s10x3);
     default: return 0;
     }
 }
@@ -101,6 +154,10 @@ void Interleave(void *dst, VertexFormat format, size_t num,
     case VertexFormat::V3N3C4U2: TInterleave((vertex_v3n3c4u2*)dst, { points, normals, colors, uvs }, num); break;
     case VertexFormat::V3N3U2T4: TInterleave((vertex_v3n3u2t4*)dst, { points, normals, uvs, tangents }, num); break;
     case VertexFormat::V3N3C4U2T4: TInterleave((vertex_v3n3c4u2t4*)dst, { points, normals, colors, uvs, tangents }, num); break;
+    case VertexFormat::V3N3U2T4_Half: TInterleave((vertex_v3n3u2t4_half*)dst, { points, normals, uvs, tangents }, num); break;
+    case VertexFormat::V3N3C4U2T4_Half: TInterleave((vertex_v3n3c4u2t4_half*)dst, { points, normals, colors, uvs, tangents }, num); break;
+    case VertexFormat::V3N3U2T4_S10x3: TInterleave((vertex_v3n3u2t4_s10x3*)dst, { points, normals, uvs, tangents }, num); break;
+    case VertexFormat::V3N3C4U2T4_S10x3: TInterleave((vertex_v3n3c4u2t4_s10x3*)dst, { points, normals, colors, uvs, tangents }, num); break;
     default: break;
     }
 }
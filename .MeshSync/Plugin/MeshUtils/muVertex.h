@@ -1,4 +1,5 @@
 #pragma once
+#include "muS10x3.h"
 
 namespace mu {
 
@@ -66,6 +67,13 @@ enum class VertexFormat
     V3N3C4U2,
     V3N3U2T4,
     V3N3C4U2T4,
+
+    // compact formats. points are float3. half: normals, colors and tangents are half4, uvs are half2.
+    // S10x3: normals and tangents are snorm10x3 (tangent.w in the 2 extra bits), colors are unorm8x4, uvs are half2.
+    V3N3U2T4_Half,
+    V3N3C4U2T4_Half,
+    V3N3U2T4_S10x3,
+    V3N3C4U2T4_S10x3,
 };
 
 struct vertex_v3n3;
@@ -80,6 +88,14 @@ struct vertex_v3n3u2t4;
 struct vertex_v3n3u2t4_arrays;
 struct vertex_v3n3c4u2t4;
 struct vertex_v3n3c4u2t4_arrays;
+struct vertex_v3n3u2t4_half;
+struct vertex_v3n3u2t4_half_arrays;
+struct vertex_v3n3c4u2t4_half;
+struct vertex_v3n3c4u2t4_half_arrays;
+struct vertex_v3n3u2t4_s10x3;
+struct vertex_v3n3u2t4_s10x3_arrays;
+struct vertex_v3n3c4u2t4_s10x3;
+struct vertex_v3n3c4u2t4_s10x3_arrays;
 
 #define DefTraits(T, ID)\
     static const VertexFormat tid = VertexFormat::ID;\
@@ -167,7 +183,7 @@ struct vertex_v3n3u2t4
 
 struct vertex_v3n3c4u2t4_arrays
 {
-    DefTraits(vertex_v3n3u2t4, V3N3C4U2T4)
+    DefTraits(vertex_v3n3c4u2t4, V3N3C4U2T4)
     const float3 *points;
     const float3 *normals;
     const float4 *colors;
@@ -183,6 +199,78 @@ struct vertex_v3n3c4u2t4
     float2 u;
     float4 t;
 };
+
+struct vertex_v3n3u2t4_half_arrays
+{
+    DefTraits(vertex_v3n3u2t4_half, V3N3U2T4_Half)
+    const float3 *points;
+    const float3 *normals;
+    const float2 *uvs;
+    const float4 *tangents;
+};
+struct vertex_v3n3u2t4_half
+{
+    DefTraits(vertex_v3n3u2t4_half, V3N3U2T4_Half)
+    float3 p;
+    half4 n;
+    half2 u;
+    half4 t;
+};
+
+struct vertex_v3n3c4u2t4_half_arrays
+{
+    DefTraits(vertex_v3n3c4u2t4_half, V3N3C4U2T4_Half)
+    const float3 *points;
+    const float3 *normals;
+    const float4 *colors;
+    const float2 *uvs;
+    const float4 *tangents;
+};
+struct vertex_v3n3c4u2t4_half
+{
+    DefTraits(vertex_v3n3c4u2t4_half, V3N3C4U2T4_Half)
+    float3 p;
+    half4 n;
+    half4 c;
+    half2 u;
+    half4 t;
+};
+
+struct vertex_v3n3u2t4_s10x3_arrays
+{
+    DefTraits(vertex_v3n3u2t4_s10x3, V3N3U2T4_S10x3)
+    const float3 *points;
+    const float3 *normals;
+    const float2 *uvs;
+    const float4 *tangents;
+};
+struct vertex_v3n3u2t4_s10x3
+{
+    DefTraits(vertex_v3n3u2t4_s10x3, V3N3U2T4_S10x3)
+    float3 p;
+    snorm10x3 n;
+    half2 u;
+    snorm10x3 t;
+};
+
+struct vertex_v3n3c4u2t4_s10x3_arrays
+{
+    DefTraits(vertex_v3n3c4u2t4_s10x3, V3N3C4U2T4_S10x3)
+    const float3 *points;
+    const float3 *normals;
+    const float4 *colors;
+    const float2 *uvs;
+    const float4 *tangents;
+};
+struct vertex_v3n3c4u2t4_s10x3
+{
+    DefTraits(vertex_v3n3c4u2t4_s10x3, V3N3C4U2T4_S10x3)
+    float3 p;
+    snorm10x3 n;
+    unorm8x4 c;
+    half2 u;
+    snorm10x3 t;
+};
 #undef DefTraits
 
 VertexFormat GuessVertexFormat(
@@ -195,6 +283,7 @@ VertexFormat GuessVertexFormat(
 
 size_t GetVertexSize(VertexFormat format);
 
+// attributes not in the format are ignored. null attributes (except points) are filled with zero.
 void Interleave(void *dst, VertexFormat format, size_t num,
     const float3 *points,
     const float3 *normals,
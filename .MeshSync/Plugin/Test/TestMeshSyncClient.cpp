@@ -77,6 +77,629 @@ TestCase(Test_SendMesh)
     }
 }
 
+TestCase(Test_SparseBoneWeights)
+{
+    const int num_bones = 12;
+
+    // same weights as per-bone dense arrays and as sparse influences
+    auto create_meshes = [&]() {
+        Random rand;
+
+        auto dense = ms::Mesh::create();
+        GenerateWaveMesh(dense->counts, dense->indices, dense->points, dense->uv0, 2.0f, 1.0f, 128, 0.0f);
+        int num_vertices = (int)dense->points.size();
+        for (int bi = 0; bi < num_bones; ++bi) {
+            auto bone = dense->addBone("/Test/Bone" + std::to_string(bi));
+            bone->weights.resize_zeroclear(num_vertices);
+        }
+
+        auto sparse = ms::Mesh::create();
+        sparse->counts = dense->counts;
+        sparse->indices = dense->indices;
+        sparse->points = dense->points;
+        sparse->uv0 = dense->uv0;
+        for (auto& b : dense->bones)
+            sparse->addBone(b->path);
+        sparse->bone_influence_counts.resize_discard(num_vertices);
+
+        for (int vi = 0; vi < num_vertices; ++vi) {
+            // 0-7 influences per vertex
+            int n = (int)(rand.f01() * 8.0f);
+            sparse->bone_influence_counts[vi] = (uint8_t)n;
+            for (int i = 0; i < n; ++i) {
+                int bi = (vi + i * 5) % num_bones;
+                float w = rand.f01();
+                dense->bones[bi]->weights[vi] = w;
+                sparse->bone_influences.push_back({ w, bi });
+            }
+        }
+        return std::make_pair(dense, sparse);
+    };
+
+    for (int max_influence : { 4, -1 }) {
+        auto meshes = create_meshes();
+        auto& dense = meshes.first;
+        auto& sparse = meshes.second;
+
+        ms::MeshRefineSettings mrs;
+        mrs.max_bone_influence = max_influence;
+        mrs.flags.split = 1;
+        mrs.flags.triangulate = 1;
+        dense->refine(mrs);
+        sparse->refine(mrs);
+        // sparse influences are consumed by refine
+        Expect(sparse->bone_influence_counts.empty() && sparse->bone_influences.empty());
+
+        if (max_influence == 4) {
+            Expect(!dense->weights4.empty() && dense->weights4.size() == sparse->weights4.size());
+            Expect(memcmp(dense->weights4.data(), sparse->weights4.data(), sizeof(Weights4) * dense->weights4.size()) == 0);
+        }
+        else {
+            Expect(!dense->bone_counts.empty() && dense->bone_counts == sparse->bone_counts);
+            Expect(dense->weights1.size() == sparse->weights1.size());
+            bool weights1_match = true;
+            for (size_t i = 0; i < dense->weights1.size(); ++i) {
+                auto& a = dense->weights1[i];
+                auto& b = sparse->weights1[i];
+                if (a.index != b.index || !near_equal(a.weight, b.weight))
+                    weights1_match = false;
+            }
+            Expect(weights1_match);
+        }
+    }
+
+    {
+        // malformed influences (counts exceed bone_influences) must be dropped, not read out of bounds
+        auto sparse = create_meshes().second;
+        sparse->bone_influences.resize(sparse->bone_influences.size() / 2);
+
+        ms::MeshRefineSettings mrs;
+        mrs.flags.mirror_x = 1;
+        sparse->refine(mrs);
+        Expect(sparse->bone_influence_counts.empty() && sparse->bone_influences.empty());
+        Expect(sparse->weights4.size() == sparse->points.size());
+    }
+}
+
+TestCase(Test_SparseBlendShape)
+{
+    auto create_mesh = []() {
+        auto mesh = ms::Mesh::create();
+        GenerateWaveMesh(mesh->counts, mesh->indices, mesh->points, mesh->uv0, 2.0f, 1.0f, 64, 0.0f);
+        mesh->refine_settings.flags.gen_normals = 1;
+
+        // move a small region of the mesh
+        RawVector<float3> delta(mesh->points.size());
+        for (size_t vi = 0; vi < delta.size(); ++vi)
+            delta[vi] = mesh->points[vi].x > 0.9f ? float3{ 0.0f, 0.25f, 0.0f } : float3::zero();
+
+        auto bs = mesh->addBlendShape("Test");
+        bs->frames.push_back(ms::BlendShapeFrameData::create());
+        bs->frames.back()->weight = 100.0f;
+        bs->frames.back()->points = delta;
+        return mesh;
+    };
+    auto dense = create_mesh();
+    auto sparse = create_mesh();
+    auto& sf = *sparse->blendshapes.front()->frames.front();
+    {
+        // per-index normals can't be sparse
+        auto f = ms::BlendShapeFrameData::create();
+        f->normals.resize_zeroclear(dense->indices.size());
+        Expect(!f->sparsify(dense->points.size()) && !f->isSparse());
+    }
+    Expect(sf.sparsify(sparse->points.size()));
+    Expect(sf.isSparse() && sf.sparse_indices.size() < dense->points.size() / 4);
+
+    ms::MeshRefineSettings mrs;
+    mrs.flags.split = 1;
+    mrs.flags.triangulate = 1;
+    mrs.flags.mirror_x = 1;
+    mrs.split_unit = 1000;
+    dense->refine(mrs);
+    sparse->refine(mrs);
+    Expect(dense->splits.size() > 1);
+
+    // expand to dense and compare
+    auto& df = *dense->blendshapes.front()->frames.front();
+    RawVector<float3> expanded;
+    expanded.resize_zeroclear(sparse->points.size());
+    for (size_t i = 0; i < sf.sparse_indices.size(); ++i)
+        expanded[sf.sparse_indices[i]] = sf.sparse_points[i];
+    Expect(expanded == df.points);
+    // the receiver expands sparse deltas to this length
+    Expect(sf.num_vertices == (int)sparse->points.size());
+}
+
+TestCase(Test_BakeSkin)
+{
+    ms::Scene scene;
+    auto add_transform = [&](const char *path, float3 pos, quatf rot) {
+        auto t = ms::Transform::create();
+        t->path = path;
+        t->position = pos;
+        t->rotation = rot;
+        scene.entities.push_back(t);
+        return t;
+    };
+    auto root = add_transform("/root", { 1.0f, 0.0f, 2.0f }, rotate_y(30.0f * DegToRad));
+    auto b0 = add_transform("/root/b0", { 0.0f, 1.0f, 0.0f }, rotate_z(20.0f * DegToRad));
+    auto b1 = add_transform("/root/b0/b1", { 1.0f, 0.0f, 0.0f }, rotate_x(-45.0f * DegToRad));
+
+    auto create_mesh = [&](int max_bone_influence) {
+        auto mesh = ms::Mesh::create();
+        mesh->path = "/root/mesh";
+        mesh->position = { 0.0f, -1.0f, 0.0f };
+        GenerateWaveMesh(mesh->counts, mesh->indices, mesh->points, mesh->uv0, 2.0f, 1.0f, 64, 0.0f);
+        GenerateNormalsPoly(mesh->normals, mesh->points, mesh->counts, mesh->indices, false);
+        mesh->refine_settings.max_bone_influence = max_bone_influence;
+
+        size_t num_points = mesh->points.size();
+        auto bone0 = mesh->addBone(b0->path);
+        auto bone1 = mesh->addBone(b1->path);
+        bone0->bindpose = invert(transform(float3{ 0.0f, 0.5f, 0.0f }, quatf::identity(), float3::one()));
+        bone1->bindpose = invert(transform(float3{ 1.0f, 0.5f, 0.0f }, quatf::identity(), float3::one()));
+        bone0->weights.resize_discard(num_points);
+        bone1->weights.resize_discard(num_points);
+        for (size_t vi = 0; vi < num_points; ++vi) {
+            float w = clamp01(mesh->points[vi].x * 0.5f + 0.5f);
+            bone0->weights[vi] = 1.0f - w;
+            bone1->weights[vi] = w;
+        }
+
+        // weight 75 is between the two frames
+        auto bs = mesh->addBlendShape("Test");
+        bs->weight = 75.0f;
+        for (float fw : { 50.0f, 100.0f }) {
+            auto f = ms::BlendShapeFrameData::create();
+            f->weight = fw;
+            f->points.resize_discard(num_points);
+            for (size_t vi = 0; vi < num_points; ++vi)
+                f->points[vi] = { 0.0f, fw * 0.001f * mesh->points[vi].x, 0.0f };
+            bs->frames.push_back(f);
+        }
+        mesh->setupFlags();
+        return mesh;
+    };
+
+    // naive reference
+    RawVector<float3> ref_points, ref_normals;
+    auto compute_reference = [&](ms::Mesh *mesh) {
+        auto root_world = root->toMatrix();
+        auto b0_world = b0->toMatrix() * root_world;
+        auto b1_world = b1->toMatrix() * b0_world;
+        auto world2local = invert(mesh->toMatrix() * root_world);
+        float4x4 skin[] = {
+            mesh->bones[0]->bindpose * b0_world * world2local,
+            mesh->bones[1]->bindpose * b1_world * world2local,
+        };
+        auto& frames = mesh->blendshapes[0]->frames;
+        size_t num_points = mesh->points.size();
+        ref_points.resize_discard(num_points);
+        ref_normals.resize_discard(num_points);
+        for (size_t vi = 0; vi < num_points; ++vi) {
+            float3 p = mesh->points[vi] + frames[0]->points[vi] * 0.5f + frames[1]->points[vi] * 0.5f;
+            float3 n = mesh->normals[vi];
+            float3 rp = float3::zero(), rn = float3::zero();
+            for (int bi = 0; bi < 2; ++bi) {
+                float w = mesh->bones[bi]->weights[vi];
+                rp += mul_p(skin[bi], p) * w;
+                rn += mul_v(skin[bi], n) * w;
+            }
+            ref_points[vi] = rp;
+            ref_normals[vi] = normalize(rn);
+        }
+    };
+
+    auto mesh = create_mesh(4);
+    compute_reference(mesh.get());
+    auto mesh_variable = create_mesh(-1);
+    scene.entities.push_back(mesh);
+    scene.bakeSkin();
+    scene.entities.back() = mesh_variable;
+    scene.bakeSkin();
+
+    for (auto& m : { mesh, mesh_variable }) {
+        Expect(m->bones.empty() && m->blendshapes.empty());
+        Expect(NearEqual(m->points.data(), ref_points.data(), ref_points.size(), 1e-4f));
+        Expect(NearEqual(m->normals.data(), ref_normals.data(), ref_normals.size(), 1e-4f));
+    }
+
+    // bones moved in place after the last bake are picked up. entities are kept as they are.
+    b1->rotation = rotate_x(30.0f * DegToRad);
+    *mesh_variable = *create_mesh(4);
+    compute_reference(mesh_variable.get());
+    scene.bakeSkin();
+    Expect(NearEqual(mesh_variable->points.data(), ref_points.data(), ref_points.size(), 1e-4f));
+    Expect(NearEqual(mesh_variable->normals.data(), ref_normals.data(), ref_normals.size(), 1e-4f));
+}
+
+TestCase(Test_SceneHierarchy)
+{
+    ms::Scene scene;
+    auto add_transform = [&](const std::string& path, float3 pos, quatf rot) {
+        auto t = ms::Transform::create();
+        t->path = path;
+        t->position = pos;
+        t->rotation = rot;
+        scene.entities.push_back(t);
+        return t;
+    };
+
+    // children come before parents, "/a/missing" doesn't exist and "/a2" is not a child of "/a"
+    add_transform("/a/b/c", { 0.0f, 0.0f, 1.0f }, rotate_x(10.0f * DegToRad));
+    add_transform("/a/missing/d", { 1.0f, 0.0f, 0.0f }, quatf::identity());
+    add_transform("/a/b", { 0.0f, 2.0f, 0.0f }, rotate_z(20.0f * DegToRad));
+    add_transform("/a", { 1.0f, 0.0f, 2.0f }, rotate_y(30.0f * DegToRad));
+    add_transform("/a2", { 3.0f, 0.0f, 0.0f }, quatf::identity());
+    // depth 3 chains for the level loop
+    const int num_wide = 20000;
+    for (int i = 0; i < num_wide; ++i)
+        add_transform("/a/b/c/w" + std::to_string(i), { (float)i * 0.01f, 0.0f, 0.0f }, rotate_y((float)i * 0.1f));
+
+    // naive reference: walk ancestors by path
+    auto reference = [&]() {
+        std::vector<float4x4> ret;
+        for (auto& e : scene.entities) {
+            auto m = e->toMatrix();
+            std::string path = e->path;
+            for (;;) {
+                auto pos = path.find_last_of('/');
+                if (pos == std::string::npos || pos == 0)
+                    break;
+                path = path.substr(0, pos);
+                if (auto parent = scene.findEntity(path))
+                    m *= parent->toMatrix();
+            }
+            ret.push_back(m);
+        }
+        return ret;
+    };
+    auto matches = [&]() {
+        auto ref = reference();
+        auto& world = scene.getWorldMatrices();
+        if (world.size() != ref.size())
+            return false;
+        return NearEqual((const float4*)world.data(), (const float4*)ref.data(), ref.size() * 4, 1e-3f);
+    };
+
+    auto& h = scene.getHierarchy();
+    Expect(h.parents[0] == 2 && h.parents[1] == 3 && h.parents[2] == 3 && h.parents[3] == -1 && h.parents[4] == -1);
+    Expect(h.parents[5] == 0 && h.depths[5] == 3);
+    Expect(h.level_offsets.size() == 5 && h.level_offsets[1] == 2 && h.level_offsets[4] == (int)scene.entities.size());
+    Expect(h.findEntityIndex("/a/b") == 2 && h.findEntityIndex("/a/missing") == -1);
+    Expect(matches());
+
+    // cached until invalidated
+    scene.entities[3]->position = { -1.0f, 0.0f, 0.0f };
+    Expect(!matches());
+    scene.invalidateWorldMatrices();
+    Expect(matches());
+
+    // the hierarchy follows added entities
+    add_transform("/a/missing", { 0.0f, 5.0f, 0.0f }, quatf::identity());
+    Expect(scene.getHierarchy().parents[1] == (int)scene.entities.size() - 1);
+    Expect(matches());
+
+    TestScope("SceneHierarchy build", [&]() {
+        scene.invalidateHierarchy();
+        scene.getHierarchy();
+    }, 10);
+    TestScope("SceneHierarchy world matrices", [&]() {
+        scene.invalidateWorldMatrices();
+        scene.getWorldMatrices();
+    }, 10);
+}
+
+TestCase(Test_MeshLOD)
+{
+    auto mesh = ms::Mesh::create();
+    GenerateWaveMesh(mesh->counts, mesh->indices, mesh->points, mesh->uv0, 2.0f, 1.0f, 128, 0.0f);
+    mesh->material_ids.resize(mesh->counts.size());
+    for (size_t fi = 0; fi < mesh->counts.size(); ++fi)
+        mesh->material_ids[fi] = fi < mesh->counts.size() / 2 ? 0 : 1;
+
+    ms::MeshRefineSettings mrs;
+    mrs.flags.split = 1;
+    mrs.flags.triangulate = 1;
+    mrs.flags.gen_normals = 1;
+    mrs.split_unit = 8000;
+    mrs.lod_count = 3;
+    mrs.lod_ratio = 0.5f;
+    mesh->refine(mrs);
+
+    Expect(mesh->splits.size() > 1);
+    // small submeshes may be stuck by locked split borders. check the total count.
+    RawVector<size_t> total_indices;
+    total_indices.resize_zeroclear(mrs.lod_count + 1);
+    for (auto& split : mesh->splits) {
+        int num_submeshes = (int)split.submeshes.size();
+        Expect(split.lod_submeshes.size() == num_submeshes * mrs.lod_count);
+        for (int smi = 0; smi < num_submeshes; ++smi) {
+            size_t prev = split.submeshes[smi].indices.size();
+            total_indices[0] += prev;
+            for (int lod = 0; lod < (int)mrs.lod_count; ++lod) {
+                auto& sm = split.lod_submeshes[lod * num_submeshes + smi];
+                Expect(sm.material_id == split.submeshes[smi].material_id);
+                Expect(sm.indices.size() <= prev);
+                prev = sm.indices.size();
+                total_indices[lod + 1] += prev;
+            }
+        }
+    }
+    for (int lod = 0; lod < (int)mrs.lod_count; ++lod) {
+        Print("    LOD%d: %d indices\n", lod + 1, (int)total_indices[lod + 1]);
+        Expect(total_indices[lod + 1] < total_indices[lod]);
+    }
+}
+
+TestCase(Test_MeshIndices16)
+{
+    auto mesh = ms::Mesh::create();
+    GenerateWaveMesh(mesh->counts, mesh->indices, mesh->points, mesh->uv0, 2.0f, 1.0f, 300, 0.0f);
+
+    ms::MeshRefineSettings mrs;
+    mrs.flags.split = 1;
+    mrs.flags.triangulate = 1;
+    mrs.flags.use_16bit_indices = 1;
+    mrs.split_unit = 80000; // first split exceeds 16-bit range, second one fits
+    mrs.lod_count = 1;
+    mesh->refine(mrs);
+
+    Expect(mesh->splits.size() == 2);
+    for (auto& split : mesh->splits) {
+        bool fits = split.vertex_count <= 0x10000;
+        Expect(split.index_format == (fits ? ms::IndexFormat::UInt16 : ms::IndexFormat::UInt32));
+        auto check = [&](ms::SubmeshData& sm) {
+            Expect(sm.index_format == split.index_format);
+            if (sm.index_format != ms::IndexFormat::UInt16)
+                return;
+            Expect(sm.indices16.size() == sm.indices.size());
+            for (size_t i = 0; i < sm.indices.size(); ++i) {
+                if (sm.indices16[i] != sm.indices[i]) {
+                    Expect(sm.indices16[i] == sm.indices[i]);
+                    break;
+                }
+            }
+        };
+        for (auto& sm : split.submeshes)
+            check(sm);
+        for (auto& sm : split.lod_submeshes)
+            check(sm);
+    }
+}
+
+TestCase(Test_InterleavedVertices)
+{
+    for (auto format : { VertexFormat::V3N3U2T4, VertexFormat::V3N3U2T4_Half, VertexFormat::V3N3U2T4_S10x3 }) {
+        auto mesh = ms::Mesh::create();
+        GenerateWaveMesh(mesh->counts, mesh->indices, mesh->points, mesh->uv0, 2.0f, 1.0f, 300, 0.0f);
+
+        ms::MeshRefineSettings mrs;
+        mrs.flags.split = 1;
+        mrs.flags.triangulate = 1;
+        mrs.flags.gen_normals = 1;
+        mrs.flags.gen_tangents = 1;
+        mrs.split_unit = 50000;
+        mrs.vertex_format = format;
+        mesh->refine(mrs);
+
+        size_t stride = GetVertexSize(format);
+        Expect(mesh->vertex_format == format);
+        Expect(mesh->vertices_interleaved.size() == mesh->points.size() * stride);
+        Print("    format %d: %d bytes per vertex, %d splits\n", (int)format, (int)stride, (int)mesh->splits.size());
+
+        // read each split as the C API does and compare with the SoA attributes
+        const float eps = 1e-2f; // half and snorm10x3 precision
+        bool valid = true;
+        RawVector<char> buf;
+        for (auto& split : mesh->splits) {
+            buf.resize_discard(split.vertex_count * stride);
+            mesh->vertices_interleaved.copy_to(buf.data(), buf.size(), split.vertex_offset * stride);
+            for (int i = 0; i < split.vertex_count; ++i) {
+                int vi = split.vertex_offset + i;
+                const char *v = &buf[i * stride];
+                float3 p, n;
+                float2 u;
+                float4 t;
+                switch (format) {
+                case VertexFormat::V3N3U2T4:
+                {
+                    auto& src = (const vertex_v3n3u2t4&)*v;
+                    p = src.p; n = src.n; u = src.u; t = src.t;
+                    break;
+                }
+                case VertexFormat::V3N3U2T4_Half:
+                {
+                    auto& src = (const vertex_v3n3u2t4_half&)*v;
+                    p = src.p; n = to<float3>((const half3&)src.n); u = to<float2>(src.u); t = to<float4>(src.t);
+                    break;
+                }
+                default:
+                {
+                    auto& src = (const vertex_v3n3u2t4_s10x3&)*v;
+                    p = src.p; n = src.n; u = to<float2>(src.u); t = decode_tangent(src.t);
+                    break;
+                }
+                }
+                if (p != mesh->points[vi] ||
+                    !near_equal(n, mesh->normals[vi], eps) ||
+                    !near_equal(u, mesh->uv0[vi], eps) ||
+                    !near_equal((float3&)t, (float3&)mesh->tangents[vi], eps) ||
+                    t.w != mesh->tangents[vi].w)
+                    valid = false;
+            }
+        }
+        Expect(valid);
+    }
+}
+
+TestCase(Test_RefineTransform)
+{
+    auto mesh = ms::Mesh::create();
+    GenerateWaveMesh(mesh->counts, mesh->indices, mesh->points, mesh->uv0, 2.0f, 1.0f, 256, 0.0f);
+    GenerateNormalsPoly(mesh->normals, mesh->points, mesh->counts, mesh->indices, false);
+    mesh->tangents.resize(mesh->points.size());
+    mesh->velocities.resize(mesh->points.size());
+    for (size_t i = 0; i < mesh->points.size(); ++i) {
+        mesh->tangents[i] = { 1.0f, 0.0f, 0.0f, i % 2 == 0 ? 1.0f : -1.0f };
+        mesh->velocities[i] = mesh->points[i] * 0.5f;
+    }
+    mesh->setupFlags();
+
+    ms::MeshRefineSettings mrs;
+    mrs.flags.apply_local2world = 1;
+    mrs.flags.flip_x = 1;
+    mrs.local2world = transform(float3{ 1.0f, 2.0f, 3.0f }, rotate_y(30.0f * DegToRad), float3{ 1.0f, 2.0f, 0.5f });
+    mrs.scale_factor = 0.01f;
+
+    // reference: separate passes
+    auto ref = ms::Mesh::create();
+    *ref = *mesh;
+    {
+        auto& m = mrs.local2world;
+        auto nm = to_mat4x4(transpose(invert(to_mat3x3(m))));
+        for (auto& v : ref->points) v = mul_p(m, v);
+        for (auto& v : ref->normals) v = normalize(mul_v(nm, v));
+        for (auto& v : ref->tangents) {
+            float3 t = normalize(mul_v(m, (float3&)v));
+            v = { t.x, t.y, t.z, v.w };
+        }
+        for (auto& v : ref->velocities) v = mul_v(m, v);
+        for (auto& v : ref->points) v *= mrs.scale_factor;
+        for (auto& v : ref->velocities) v *= mrs.scale_factor;
+        InvertX(ref->points.data(), ref->points.size());
+        InvertX(ref->normals.data(), ref->normals.size());
+        InvertX(ref->tangents.data(), ref->tangents.size());
+        InvertX(ref->velocities.data(), ref->velocities.size());
+    }
+
+    ref->refine(ms::MeshRefineSettings());
+
+    TestScope("fused transform", [&]() {
+        mesh->refine(mrs);
+    });
+    Expect(mesh->points.size() == ref->points.size());
+    Expect(NearEqual(mesh->points.data(), ref->points.data(), ref->points.size(), 1e-4f));
+    Expect(NearEqual(mesh->normals.data(), ref->normals.data(), ref->normals.size(), 1e-4f));
+    Expect(NearEqual(mesh->tangents.data(), ref->tangents.data(), ref->tangents.size(), 1e-4f));
+    Expect(NearEqual(mesh->velocities.data(), ref->velocities.data(), ref->velocities.size(), 1e-4f));
+
+    // zero-length normals and tangents stay zero and others are normalized, with uniform and non-uniform scale.
+    for (bool uniform : { true, false }) {
+        auto m = ms::Mesh::create();
+        GenerateWaveMesh(m->counts, m->indices, m->points, m->uv0, 2.0f, 1.0f, 16, 0.0f);
+        GenerateNormalsPoly(m->normals, m->points, m->counts, m->indices, false);
+        m->tangents.resize(m->points.size());
+        for (auto& t : m->tangents)
+            t = { 1.0f, 0.0f, 0.0f, 1.0f };
+        m->normals[0] = float3::zero();
+        m->tangents[0] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        // non-unit input is normalized
+        m->normals[1] *= 3.0f;
+        (float3&)m->tangents[1] *= 0.5f;
+        m->setupFlags();
+
+        ms::MeshRefineSettings zs;
+        zs.flags.flip_x = 1;
+        zs.scale_factor = 0.01f;
+        if (!uniform) {
+            zs.flags.apply_local2world = 1;
+            zs.local2world = scale44(float3{ 1.0f, 2.0f, 0.5f });
+        }
+        m->refine(zs);
+
+        int num_zero = 0;
+        bool ok = true;
+        for (auto& n : m->normals) {
+            if (n == float3::zero())
+                ++num_zero;
+            else
+                ok = ok && std::abs(length(n) - 1.0f) < 1e-4f;
+        }
+        for (auto& t : m->tangents) {
+            auto& v = (const float3&)t;
+            ok = ok && (v == float3::zero() || std::abs(length(v) - 1.0f) < 1e-4f);
+        }
+        Expect(num_zero >= 1 && ok);
+    }
+}
+
+TestCase(Test_RefineLowMemory)
+{
+    auto mesh = ms::Mesh::create();
+    GenerateWaveMesh(mesh->counts, mesh->indices, mesh->points, mesh->uv0, 2.0f, 1.0f, 512, 0.0f);
+    {
+        // per-index normals and colors
+        RawVector<float3> normals;
+        GenerateNormalsPoly(normals, mesh->points, mesh->counts, mesh->indices, false);
+        size_t num_indices = mesh->indices.size();
+        mesh->normals.resize_discard(num_indices);
+        mesh->colors.resize_discard(num_indices);
+        for (size_t ii = 0; ii < num_indices; ++ii) {
+            mesh->normals[ii] = normals[mesh->indices[ii]];
+            mesh->colors[ii] = { float(ii % 4) * 0.25f, 0.0f, 1.0f, 1.0f };
+        }
+    }
+    // blendshapes are shared by copies of a mesh, so each mesh needs its own
+    auto add_blendshape = [](ms::Mesh& m) {
+        auto bs = ms::BlendShapeData::create();
+        auto frame = ms::BlendShapeFrameData::create();
+        frame->weight = 100.0f;
+        frame->points.resize_discard(m.points.size());
+        for (size_t i = 0; i < m.points.size(); ++i)
+            frame->points[i] = { 0.0f, float(i % 7) * 0.01f, 0.0f };
+        bs->frames.push_back(frame);
+        m.blendshapes.push_back(bs);
+        m.setupFlags();
+    };
+
+    ms::MeshRefineSettings mrs;
+    mrs.flags.split = 1;
+    mrs.flags.triangulate = 1;
+    mrs.flags.gen_tangents = 1;
+    mrs.flags.optimize_vertex_cache = 1;
+
+    auto ref = ms::Mesh::create();
+    auto high = ms::Mesh::create();
+    *ref = *mesh;
+    *high = *mesh;
+    add_blendshape(*ref);
+    add_blendshape(*high);
+    add_blendshape(*mesh);
+    TestScope("refine", [&]() {
+        ref->refine(mrs);
+    });
+
+    // a threshold above the estimated peak doesn't switch to low memory mode
+    mrs.low_memory_threshold = 4096;
+    high->refine(mrs);
+
+    mrs.low_memory_threshold = 1; // 1MB. forces low memory mode
+    TestScope("refine (low memory)", [&]() {
+        mesh->refine(mrs);
+    });
+    Print("    peak memory: %.2fMB -> %.2fMB\n",
+        double(ref->refine_peak_memory) / (1024 * 1024), double(mesh->refine_peak_memory) / (1024 * 1024));
+    Print("    ACMR: %.3f -> %.3f\n", ref->refine_vertex_cache_before.acmr, ref->refine_vertex_cache_after.acmr);
+    Expect(ref->refine_vertex_cache_after.triangles == (int)ref->indices.size() / 3);
+    Expect(ref->refine_vertex_cache_after.acmr <= ref->refine_vertex_cache_before.acmr);
+
+    auto same = [](const auto& a, const auto& b) {
+        return a.size() == b.size() && memcmp(a.data(), b.data(), sizeof(a[0]) * a.size()) == 0;
+    };
+    Expect(mesh->refine_peak_memory < ref->refine_peak_memory);
+    Expect(mesh->refine_peak_memory < high->refine_peak_memory);
+    Expect(same(mesh->points, ref->points));
+    Expect(same(mesh->indices, ref->indices));
+    Expect(same(mesh->normals, ref->normals));
+    Expect(same(mesh->tangents, ref->tangents));
+    Expect(same(mesh->uv0, ref->uv0));
+    Expect(same(mesh->colors, ref->colors));
+    Expect(same(mesh->blendshapes[0]->frames[0]->points, ref->blendshapes[0]->frames[0]->points));
+    Expect(mesh->splits.size() == ref->splits.size());
+}
+
 TestCase(Test_SceneCacheRead)
 {
     auto isc = ms::OpenISceneCacheFile("wave.scz");
@@ -137,6 +760,460 @@ TestCase(Test_Animation)
     Send(scene);
 }
 
+TestCase(Test_KeyframeReduction)
+{
+    // 10 seconds sampled at 30 fps
+    const int num_frames = 300;
+    auto create_clip = [&]() {
+        auto clip = ms::AnimationClip::create();
+        auto anim = ms::TransformAnimation::create();
+        clip->addAnimation(anim);
+        anim->path = "/Test/Reduction";
+        for (int fi = 0; fi < num_frames; ++fi) {
+            float t = (float)fi / 30.0f;
+            // linear, still, then a sine wave
+            float x = t < 3.0f ? t : t < 6.0f ? 3.0f : 3.0f + std::sin((t - 6.0f) * 2.0f);
+            anim->translation.push_back({ t, { x, 1.0f, 0.0f } });
+            anim->rotation.push_back({ t, ms::rotate_y(t * 20.0f * mu::DegToRad) });
+            anim->scale.push_back({ t, float3::one() });
+            anim->visible.push_back({ t, t < 5.0f ? 1 : 0 });
+        }
+        return std::make_pair(clip, anim);
+    };
+
+    // reduced curves evaluated by linear interpolation must be within the tolerance at every original sample
+    auto check_linear = [](auto& src, auto& reduced, auto&& distance, float tolerance) {
+        size_t ki = 0;
+        for (size_t i = 0; i < src.size(); ++i) {
+            float t = src[i].time;
+            while (ki + 2 < reduced.size() && reduced[ki + 1].time <= t)
+                ++ki;
+            auto& k0 = reduced[ki];
+            auto& k1 = reduced[ki + 1];
+            float s = clamp01((t - k0.time) / (k1.time - k0.time));
+            if (distance(src[i].value, k0.value, k1.value, s) > tolerance)
+                return false;
+        }
+        return true;
+    };
+    auto position_distance = [](float3 v, float3 v0, float3 v1, float s) {
+        float3 d = v - (v0 + (v1 - v0) * s);
+        return std::max(std::abs(d.x), std::max(std::abs(d.y), std::abs(d.z)));
+    };
+    auto rotation_distance = [](quatf v, quatf v0, quatf v1, float s) {
+        quatf r = normalize(quatf{ v0.x + (v1.x - v0.x) * s, v0.y + (v1.y - v0.y) * s, v0.z + (v1.z - v0.z) * s, v0.w + (v1.w - v0.w) * s });
+        float d = std::abs(r.x * v.x + r.y * v.y + r.z * v.z + r.w * v.w);
+        return 2.0f * std::acos(std::min(d, 1.0f));
+    };
+
+    {
+        auto ref = create_clip();
+        auto rc = create_clip();
+        ms::KeyframeReductionSettings settings;
+        settings.interpolation = ms::KeyframeReductionSettings::Interpolation::Linear;
+        settings.tolerance = 0.001f;
+        settings.rotation_tolerance = 0.1f * mu::DegToRad;
+        TestScope("reduction linear", [&]() { rc.first->reduction(settings); });
+
+        auto& src = *ref.second;
+        auto& dst = *rc.second;
+        Print("    translation: %d -> %d\n", (int)src.translation.size(), (int)dst.translation.size());
+        Print("    rotation: %d -> %d\n", (int)src.rotation.size(), (int)dst.rotation.size());
+        Print("    visible: %d -> %d\n", (int)src.visible.size(), (int)dst.visible.size());
+        Expect(dst.translation.size() < src.translation.size() / 2);
+        Expect(dst.rotation.size() < src.rotation.size() / 10);
+        Expect(dst.scale.empty()); // flat curve is erased
+        Expect(dst.visible.size() == 3); // int curves are stepped: first, the step and last
+        Expect(dst.translation[0].time == src.translation[0].time && dst.translation.back().time == src.translation.back().time);
+        Expect(check_linear(src.translation, dst.translation, position_distance, settings.tolerance + 1e-5f));
+        Expect(check_linear(src.rotation, dst.rotation, rotation_distance, settings.rotation_tolerance + 1e-3f));
+    }
+    {
+        auto ref = create_clip();
+        auto rc = create_clip();
+        ms::KeyframeReductionSettings settings;
+        settings.tolerance = 0.001f;
+        settings.rotation_tolerance = 0.1f * mu::DegToRad;
+        settings.keep_flat_curves = true;
+        TestScope("reduction smooth", [&]() { rc.first->reduction(settings); });
+
+        auto& src = *ref.second;
+        auto& dst = *rc.second;
+        Print("    translation: %d -> %d\n", (int)src.translation.size(), (int)dst.translation.size());
+        Print("    rotation: %d -> %d\n", (int)src.rotation.size(), (int)dst.rotation.size());
+        Expect(dst.translation.size() < src.translation.size() / 2);
+        Expect(dst.rotation.size() < src.rotation.size() / 2);
+        Expect(dst.scale.size() == 2);
+    }
+    {
+        // reduction(bool) only removes keys equal to their neighbors. the linear part must be kept as it is,
+        // because the receiver may import the clip as constant.
+        auto ref = create_clip();
+        auto rc = create_clip();
+        rc.first->reduction(false);
+        auto& src = *ref.second;
+        auto& dst = *rc.second;
+        Expect(dst.scale.empty());
+        Expect(dst.rotation.size() == src.rotation.size());
+        Expect(dst.visible.size() == 3);
+
+        // 89 keys in the still part have neighbors with the same value
+        Expect(dst.translation.size() == src.translation.size() - 89);
+        bool ramp_kept = true;
+        for (int fi = 0; fi < 90; ++fi)
+            ramp_kept = ramp_kept && dst.translation[fi].time == src.translation[fi].time;
+        Expect(ramp_kept);
+    }
+}
+
+TestCase(Test_CurveEncoding)
+{
+    // 10 seconds sampled at 30 fps
+    const int num_frames = 300;
+    auto create_clip = [&]() {
+        auto clip = ms::AnimationClip::create();
+        auto anim = ms::TransformAnimation::create();
+        clip->addAnimation(anim);
+        anim->path = "/Test/Encoding";
+        for (int fi = 0; fi < num_frames; ++fi) {
+            float t = (float)fi / 30.0f;
+            anim->translation.push_back({ t, { std::sin(t) * 10.0f, t, -2.0f } });
+            anim->rotation.push_back({ t, ms::rotate_y(t * 50.0f * mu::DegToRad) * ms::rotate_x(t * 10.0f * mu::DegToRad) });
+            anim->scale.push_back({ t, { 1.0f + t * 0.1f, 1.0f, 1.0f } });
+            anim->visible.push_back({ t, fi % 60 < 30 ? 1 : 0 });
+        }
+        return std::make_pair(clip, anim);
+    };
+    auto curve_bytes = [](ms::AnimationClip& clip) {
+        size_t ret = 0;
+        for (auto& anim : clip.animations)
+            for (auto& c : anim->curves)
+                ret += c->data.size();
+        return ret;
+    };
+
+    auto ref = create_clip();
+    auto& src = *ref.second;
+    size_t plain_bytes = curve_bytes(*ref.first);
+    for (auto ve : { ms::CurveEncodingSettings::VectorEncoding::Float,
+                     ms::CurveEncodingSettings::VectorEncoding::Half,
+                     ms::CurveEncodingSettings::VectorEncoding::Quantize16 }) {
+        auto rc = create_clip();
+        ms::CurveEncodingSettings settings;
+        settings.enabled = true;
+        settings.vector_encoding = ve;
+        rc.first->encode(settings);
+        size_t encoded_bytes = curve_bytes(*rc.first);
+        Print("    vector encoding %d: %d -> %d bytes\n", (int)ve, (int)plain_bytes, (int)encoded_bytes);
+        Expect(encoded_bytes < plain_bytes);
+        Expect(rc.first->animations[0]->curves[0]->size() == (size_t)num_frames);
+
+        // encoded curves are transferred as they are and decoded by the receiver
+        ms::Scene scene;
+        scene.assets.push_back(rc.first);
+        ms::MemoryStream ms;
+        scene.serialize(ms);
+        ms::Scene dscene;
+        dscene.deserialize(ms);
+        auto clip = std::static_pointer_cast<ms::AnimationClip>(dscene.assets[0]);
+        clip->decode();
+
+        ms::TransformAnimation dst(clip->animations[0]);
+        float ttol = 1e-4f;
+        float vtol = ve == ms::CurveEncodingSettings::VectorEncoding::Float ? 0.0f :
+            ve == ms::CurveEncodingSettings::VectorEncoding::Half ? 0.01f : 20.0f / 65535.0f;
+        bool ok = dst.translation.size() == (size_t)num_frames && dst.rotation.size() == (size_t)num_frames &&
+            dst.scale.size() == (size_t)num_frames && dst.visible.size() == (size_t)num_frames;
+        for (int i = 0; ok && i < num_frames; ++i) {
+            ok = ok && std::abs(dst.translation[i].time - src.translation[i].time) <= ttol;
+            ok = ok && near_equal(dst.translation[i].value, src.translation[i].value, vtol + 1e-6f);
+            ok = ok && near_equal(dst.scale[i].value, src.scale[i].value, vtol + 1e-6f);
+            ok = ok && dst.visible[i].value == src.visible[i].value;
+            // quat32 error is around 0.1 degrees. signs are kept continuous.
+            auto& q = dst.rotation[i].value;
+            auto& r = src.rotation[i].value;
+            float d = q.x * r.x + q.y * r.y + q.z * r.z + q.w * r.w;
+            ok = ok && d > 0.0f && 2.0f * std::acos(std::min(d, 1.0f)) < 0.5f * mu::DegToRad;
+        }
+        Expect(ok);
+    }
+
+    // non-uniform keys keep their times
+    {
+        auto rc = create_clip();
+        ms::KeyframeReductionSettings rs;
+        rs.tolerance = 0.01f;
+        rc.first->reduction(rs);
+        auto expected = rc.second->translation[1].time;
+
+        ms::CurveEncodingSettings settings;
+        settings.enabled = true;
+        rc.first->encode(settings);
+        rc.first->decode();
+        Expect(rc.second->translation[1].time == expected);
+    }
+
+    // truncated or corrupt data is not read past its end. such curves are cleared.
+    {
+        auto rc = create_clip();
+        ms::CurveEncodingSettings settings;
+        settings.enabled = true;
+        rc.first->encode(settings);
+        auto& curves = rc.first->animations[0]->curves;
+        for (auto& c : curves)
+            c->data.resize(c->data.size() - 1);
+        (uint32_t&)curves[0]->data[0] = 0x7fffffff;
+
+        rc.first->decode();
+        bool ok = true;
+        for (auto& c : curves)
+            ok = ok && c->encoding == ms::AnimationCurve::Encoding::Plain && c->empty();
+        Expect(ok);
+    }
+
+    // scene caches encode copies of clips. the scene passed to addScene() is kept Plain.
+    {
+        auto rc = create_clip();
+        auto scene = ms::Scene::create();
+        scene->assets.push_back(rc.first);
+        uint64_t checksum = rc.first->checksum();
+
+        ms::SceneCacheSettings settings;
+        settings.encoding = ms::SceneCacheEncoding::Plain;
+        settings.curve_encoding.enabled = true;
+        {
+            auto osc = ms::OpenOSceneCacheFile("curve.sc", settings);
+            osc->addScene(scene, 0.0f);
+        }
+        Expect(rc.first->checksum() == checksum);
+        Expect(rc.first->animations[0]->curves[0]->encoding == ms::AnimationCurve::Encoding::Plain);
+    }
+}
+
+TestCase(Test_CurveEvaluation)
+{
+    // 1000 transform animations, 10 seconds sampled at 30 fps
+    const int num_animations = 1000;
+    const int num_frames = 300;
+    auto clip = ms::AnimationClip::create();
+    for (int ai = 0; ai < num_animations; ++ai) {
+        auto anim = ms::TransformAnimation::create();
+        clip->addAnimation(anim);
+        char path[64];
+        sprintf(path, "/Root/Node%d", ai);
+        anim->path = path;
+        float phase = (float)ai * 0.1f;
+        for (int fi = 0; fi < num_frames; ++fi) {
+            float t = (float)fi / 30.0f;
+            anim->translation.push_back({ t, { std::sin(t + phase), t, (float)ai } });
+            anim->rotation.push_back({ t, ms::rotate_y(t + phase) * ms::rotate_x(t * 0.5f) });
+            anim->scale.push_back({ t, { 1.0f + t * 0.1f, 1.0f, 1.0f } });
+            anim->visible.push_back({ t, fi % 60 < 30 ? 1 : 0 });
+        }
+    }
+
+    // values at the keys and halfway between them
+    {
+        ms::TransformAnimation anim(clip->animations[0]);
+        float t = 10.0f / 30.0f;
+        Expect(near_equal(anim.translation.evaluate(t), anim.translation[10].value));
+        Expect(near_equal(anim.translation.evaluate(t + 0.5f / 30.0f),
+            (anim.translation[10].value + anim.translation[11].value) * 0.5f));
+        Expect(near_equal(anim.rotation.evaluate(t + 0.5f / 30.0f),
+            slerp(anim.rotation[10].value, anim.rotation[11].value, 0.5f)));
+        Expect(anim.visible.evaluate(29.9f / 30.0f) == 1 && anim.visible.evaluate(30.5f / 30.0f) == 0);
+        // clamped out of range
+        Expect(near_equal(anim.scale.evaluate(-1.0f), anim.scale[0].value));
+        Expect(near_equal(anim.scale.evaluate(100.0f), anim.scale[num_frames - 1].value));
+
+        // one curve at many times
+        RawVector<float> times;
+        RawVector<float3> values;
+        for (int i = 0; i < 1000; ++i)
+            times.push_back((float)i * 0.01f);
+        values.resize(times.size());
+        anim.host->findCurve(mskTransformTranslation)->evaluate(times.data(), (int)times.size(), values.data());
+        bool ok = true;
+        for (size_t i = 0; i < times.size(); ++i)
+            ok = ok && near_equal(values[i], anim.translation.evaluate(times[i]));
+        Expect(ok);
+    }
+
+    // sequential playback of all curves
+    ms::CurveEvaluator evaluator;
+    evaluator.addClip(*clip);
+    int num_curves = evaluator.getCurveCount();
+    Expect(num_curves == num_animations * 4);
+    const int num_samples = num_frames * 2;
+
+    RawVector<float4> ref(num_curves);
+    TestScope("evaluation per curve", [&]() {
+        for (int si = 0; si < num_samples; ++si) {
+            float t = (float)si / 60.0f;
+            int ci = 0;
+            for (auto& anim : clip->animations)
+                for (auto& curve : anim->curves)
+                    curve->evaluate(t, &ref[ci++]);
+        }
+    });
+    std::vector<int> cursors(num_curves);
+    TestScope("evaluation per curve with cursors", [&]() {
+        for (int si = 0; si < num_samples; ++si) {
+            float t = (float)si / 60.0f;
+            int ci = 0;
+            for (auto& anim : clip->animations) {
+                for (auto& curve : anim->curves) {
+                    curve->evaluate(t, &ref[ci], &cursors[ci]);
+                    ++ci;
+                }
+            }
+        }
+    });
+    TestScope("CurveEvaluator", [&]() {
+        for (int si = 0; si < num_samples; ++si)
+            evaluator.evaluate((float)si / 60.0f);
+    });
+
+    // results of the last sample match
+    bool ok = true;
+    int ci = 0;
+    for (auto& anim : clip->animations) {
+        for (auto& curve : anim->curves) {
+            const float *r = (const float*)&ref[ci];
+            const float *v = (const float*)evaluator.getValueData(ci);
+            int n = curve->data_type == ms::AnimationCurve::DataType::Quaternion ? 4 :
+                curve->data_type == ms::AnimationCurve::DataType::Float3 ? 3 : 1;
+            if (curve->data_type == ms::AnimationCurve::DataType::Int)
+                ok = ok && *(const int*)r == *(const int*)v;
+            else
+                for (int c = 0; c < n; ++c)
+                    ok = ok && std::abs(r[c] - v[c]) < 1e-5f;
+            ++ci;
+        }
+    }
+    Expect(ok);
+}
+
+TestCase(Test_CurveSoA)
+{
+    // 10 seconds sampled at 30 fps
+    const int num_frames = 300;
+    auto create_clip = [&]() {
+        auto clip = ms::AnimationClip::create();
+        auto anim = ms::CameraAnimation::create();
+        clip->addAnimation(anim);
+        anim->path = "/Test/SoA";
+        for (int fi = 0; fi < num_frames; ++fi) {
+            float t = (float)fi / 30.0f;
+            anim->translation.push_back({ t, { std::sin(t) * 10.0f, t, -2.0f } });
+            anim->rotation.push_back({ t, ms::rotate_y(t) * ms::rotate_x(t * 0.5f) });
+            anim->scale.push_back({ t, { 1.0f + t * 0.1f, 1.0f, 1.0f } });
+            anim->visible.push_back({ t, fi % 60 < 30 ? 1 : 0 });
+            anim->fov.push_back({ t, 60.0f + t });
+            anim->near_plane.push_back({ t, 0.3f });
+            anim->far_plane.push_back({ t, 1000.0f });
+            anim->focal_length.push_back({ t, 50.0f - t });
+            anim->sensor_size.push_back({ t, { 36.0f, 24.0f } });
+            anim->lens_shift.push_back({ t, { t * 0.01f, 0.0f } });
+        }
+        // keys of this curve are at different times and don't share them
+        auto fov = anim->host->findCurve(mskCameraFieldOfView);
+        ms::TAnimationCurve<float> keys(fov);
+        keys.resize(num_frames / 2);
+        for (int i = 0; i < num_frames / 2; ++i)
+            keys[i].time = (float)i / 15.0f;
+        return std::make_pair(clip, anim);
+    };
+    auto serialize = [](ms::AnimationClipPtr clip, ms::MemoryStream& ms) {
+        ms::Scene scene;
+        scene.assets.push_back(clip);
+        scene.serialize(ms);
+        ms.flush();
+        return (size_t)ms.getWCount();
+    };
+
+    auto ref = create_clip();
+    auto& src = *ref.first->animations[0];
+    ms::MemoryStream plain_stream;
+    size_t plain_bytes = serialize(ref.first, plain_stream);
+
+    auto soa = create_clip();
+    ms::CurveEncodingSettings settings;
+    settings.enabled = false;
+    settings.share_times = true;
+    soa.first->encode(settings);
+    auto& anim = *soa.first->animations[0];
+    auto translation = anim.findCurve(mskTransformTranslation);
+    auto fov = anim.findCurve(mskCameraFieldOfView);
+    bool ok = true;
+    for (auto& c : anim.curves) {
+        ok = ok && c->encoding == ms::AnimationCurve::Encoding::SoA;
+        if (c != fov)
+            ok = ok && c->times == translation->times;
+    }
+    Expect(ok);
+    Expect(fov->times != translation->times && fov->size() == (size_t)num_frames / 2);
+
+    ms::MemoryStream soa_stream;
+    size_t soa_bytes = serialize(soa.first, soa_stream);
+    Print("    serialized: %d -> %d bytes\n", (int)plain_bytes, (int)soa_bytes);
+    Expect(soa_bytes < plain_bytes * 3 / 4);
+
+    // SoA curves are evaluated as they are
+    auto evaluate_all = [&](ms::Animation& a, float t, RawVector<float4>& dst) {
+        dst.resize_zeroclear(a.curves.size());
+        for (size_t ci = 0; ci < a.curves.size(); ++ci)
+            a.curves[ci]->evaluate(t, &dst[ci]);
+    };
+    RawVector<float4> expected, actual;
+    ok = true;
+    for (int si = 0; si < num_frames * 2; ++si) {
+        float t = (float)si / 60.0f;
+        evaluate_all(src, t, expected);
+        evaluate_all(anim, t, actual);
+        ok = ok && memcmp(expected.data(), actual.data(), sizeof(float4) * expected.size()) == 0;
+    }
+    Expect(ok);
+    {
+        ms::CurveEvaluator evaluator;
+        evaluator.addClip(*soa.first);
+        evaluator.evaluate(1.5f);
+        evaluate_all(src, 1.5f, expected);
+        Expect(translation->encoding == ms::AnimationCurve::Encoding::SoA);
+        ok = true;
+        for (size_t ci = 0; ci < anim.curves.size(); ++ci) {
+            auto& v = *(const float4*)evaluator.getValueData((int)ci);
+            if (anim.curves[ci]->data_type == ms::AnimationCurve::DataType::Int)
+                ok = ok && (const int&)v == (const int&)expected[ci];
+            else
+                ok = ok && near_equal(v, expected[ci]);
+        }
+        Expect(ok);
+    }
+
+    // shared times survive serialization and decoding restores the keys
+    ms::Scene dscene;
+    dscene.deserialize(soa_stream);
+    auto clip = std::static_pointer_cast<ms::AnimationClip>(dscene.assets[0]);
+    auto& danim = *clip->animations[0];
+    Expect(danim.curves.size() == src.curves.size());
+    auto dtranslation = danim.findCurve(mskTransformTranslation);
+    auto drotation = danim.findCurve(mskTransformRotation);
+    Expect(dtranslation->times && dtranslation->times == drotation->times);
+    Expect(danim.findCurve(mskCameraFieldOfView)->times != dtranslation->times);
+    Expect(danim.checksum() == anim.checksum());
+
+    clip->decode();
+    ok = true;
+    for (size_t ci = 0; ci < src.curves.size(); ++ci) {
+        auto& a = *src.curves[ci];
+        auto& b = *danim.curves[ci];
+        ok = ok && b.encoding == ms::AnimationCurve::Encoding::Plain && !b.times && a.name == b.name &&
+            a.data.size() == b.data.size() && memcmp(a.data.data(), b.data.data(), a.data.size()) == 0;
+    }
+    Expect(ok);
+}
+
 TestCase(Test_Points)
 {
     Random rand;
@@ -108,6 +108,278 @@ TestCase(TestMeshRefiner)
 }
 
 
+TestCase(TestMeshRefinerAttributes)
+{
+    RawVector<float3> points;
+    RawVector<float2> uv;
+    RawVector<int> counts, indices;
+    GenerateWaveMesh(counts, indices, points, uv, 2.0f, 1.0f, 512, 0.0f);
+
+    // per-index attributes as textured meshes usually have. uv1 and colors have seams on every 8th column.
+    size_t num_indices = indices.size();
+    RawVector<float3> normals;
+    RawVector<float2> uv0(num_indices), uv1(num_indices);
+    RawVector<float4> colors(num_indices);
+    GenerateNormalsWithSmoothAngle(normals, points, counts, indices, 40.0f, false);
+    for (size_t ii = 0; ii < num_indices; ++ii) {
+        int vi = indices[ii];
+        int face = (int)ii / 4;
+        bool seam = (face % 512) % 8 == 0;
+        uv0[ii] = uv[vi];
+        uv1[ii] = uv[vi] * 2.0f + (seam ? float2{ 0.5f, 0.0f } : float2::zero());
+        colors[ii] = seam ? float4{ 1.0f, 0.0f, 0.0f, 1.0f } : float4{ 1.0f, 1.0f, 1.0f, 1.0f };
+    }
+
+    RawVector<float3> new_normals;
+    RawVector<float2> new_uv0, new_uv1;
+    RawVector<float4> new_colors;
+    RawVector<int> remap_normals, remap_uv0, remap_uv1, remap_colors;
+
+    mu::MeshRefiner refiner;
+    Print("    %d vertices, %d indices\n", (int)points.size(), (int)num_indices);
+    TestScope("refine (normals, uv0, uv1, colors)", [&]() {
+        refiner.clear();
+        refiner.split_unit = 65000;
+        refiner.counts = counts;
+        refiner.indices = indices;
+        refiner.points = points;
+        refiner.addExpandedAttribute<float3>(normals, new_normals, remap_normals);
+        refiner.addExpandedAttribute<float2>(uv0, new_uv0, remap_uv0);
+        refiner.addExpandedAttribute<float2>(uv1, new_uv1, remap_uv1);
+        refiner.addExpandedAttribute<float4>(colors, new_colors, remap_colors);
+        refiner.refine();
+    }, 10);
+    Print("    %d vertices after refine\n", (int)refiner.new_points.size());
+
+    // every corner must be mapped to a vertex that has the same attributes
+    size_t num_vertices = refiner.new_points.size();
+    Expect(new_normals.size() == num_vertices && new_uv0.size() == num_vertices &&
+        new_uv1.size() == num_vertices && new_colors.size() == num_vertices && remap_uv1.size() == num_vertices);
+    // face order is kept without spatial_split, so new_indices correspond to indices
+    Expect(refiner.new_indices.size() == num_indices);
+    bool ok = true;
+    for (size_t ii = 0; ii < num_indices && ok; ++ii) {
+        int ni = refiner.new_indices[ii];
+        ok = refiner.new_points[ni] == points[indices[ii]] &&
+            new_normals[ni] == normals[ii] && new_uv0[ni] == uv0[ii] &&
+            new_uv1[ni] == uv1[ii] && new_colors[ni] == colors[ii] &&
+            new_uv1[ni] == uv1[remap_uv1[ni]];
+    }
+    Expect(ok);
+
+    // no duplicate vertices in a split
+    bool unique = true;
+    for (auto& split : refiner.splits) {
+        std::vector<std::string> keys;
+        for (int vi = split.vertex_offset; vi < split.vertex_offset + split.vertex_count; ++vi) {
+            std::string key;
+            auto append = [&](const void *v, size_t size) { key.append((const char*)v, size); };
+            append(&refiner.new2old_points[vi], sizeof(int));
+            append(&new_normals[vi], sizeof(float3));
+            append(&new_uv0[vi], sizeof(float2));
+            append(&new_uv1[vi], sizeof(float2));
+            append(&new_colors[vi], sizeof(float4));
+            keys.push_back(key);
+        }
+        std::sort(keys.begin(), keys.end());
+        unique = unique && std::adjacent_find(keys.begin(), keys.end()) == keys.end();
+    }
+    Expect(unique);
+}
+
+TestCase(TestMeshRefinerSignedZero)
+{
+    // a quad whose corners have normals that differ only in the sign of zero. they must be welded.
+    RawVector<float3> points = { { 0, 0, 0 },{ 1, 0, 0 },{ 1, 1, 0 },{ 0, 1, 0 } };
+    RawVector<int> counts = { 3, 3 };
+    RawVector<int> indices = { 0, 1, 2, 0, 2, 3 };
+    RawVector<float3> normals = {
+        { 0.0f, 0.0f, 1.0f },{ 0.0f, 0.0f, 1.0f },{ 0.0f, 0.0f, 1.0f },
+        { -0.0f, -0.0f, 1.0f },{ -0.0f, 0.0f, 1.0f },{ 0.0f, -0.0f, 1.0f },
+    };
+    RawVector<float3> new_normals;
+
+    mu::MeshRefiner refiner;
+    refiner.counts = counts;
+    refiner.indices = indices;
+    refiner.points = points;
+    refiner.addExpandedAttribute<float3>(normals, new_normals);
+    refiner.refine();
+    Expect(refiner.new_points.size() == points.size());
+    Expect(new_normals.size() == points.size());
+}
+
+
+TestCase(TestVertexCacheOptimization)
+{
+    RawVector<float3> points;
+    RawVector<float2> uv;
+    RawVector<int> counts, indices;
+    GenerateIcoSphereMesh(counts, indices, points, uv, 1.0f, 6);
+
+    // shuffle faces to emulate meshes with poor locality
+    {
+        int num_triangles = (int)counts.size();
+        RawVector<int> order(num_triangles);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937(0));
+        RawVector<int> tmp = indices;
+        for (int ti = 0; ti < num_triangles; ++ti)
+            memcpy(&indices[ti * 3], &tmp[order[ti] * 3], sizeof(int) * 3);
+    }
+
+    mu::MeshRefiner refiner;
+    refiner.split_unit = 65000;
+    refiner.counts = counts;
+    refiner.indices = indices;
+    refiner.points = points;
+    refiner.refine();
+    refiner.retopology(false);
+    refiner.genSubmeshes();
+
+    auto triangles_of = [&](const mu::MeshRefiner& r) {
+        // triangles as old point indices, rotated to start from the smallest index and sorted
+        RawVector<tvec3<int>> ret;
+        for (auto& sm : r.submeshes) {
+            int base = r.splits[sm.split_index].vertex_offset;
+            for (int i = 0; i < sm.index_count; i += 3) {
+                const int *t = &r.new_indices_submeshes[sm.index_offset + i];
+                tvec3<int> v{ r.new2old_points[base + t[0]], r.new2old_points[base + t[1]], r.new2old_points[base + t[2]] };
+                while (v[0] > v[1] || v[0] > v[2])
+                    v = { v[1], v[2], v[0] };
+                ret.push_back(v);
+            }
+        }
+        std::sort(ret.begin(), ret.end(), [](const tvec3<int>& a, const tvec3<int>& b) {
+            return std::lexicographical_compare(&a[0], &a[0] + 3, &b[0], &b[0] + 3); });
+        return ret;
+    };
+    auto analyze = [&](const char *label) {
+        auto& split = refiner.splits[0];
+        auto stat = AnalyzeVertexCache(IArray<int>(refiner.new_indices_submeshes.data(), split.index_count), split.vertex_count);
+        Print("    %s: ACMR %.3f, ATVR %.3f\n", label, stat.acmr, stat.atvr);
+        return stat;
+    };
+
+    auto triangles_before = triangles_of(refiner);
+    auto before = analyze("before");
+    TestScope("optimizeVertexCache", [&]() {
+        refiner.optimizeVertexCache();
+    });
+    auto after = analyze("after");
+    Expect(after.acmr < before.acmr);
+    // the refiner reports the same statistics (one split with one submesh here)
+    Expect(refiner.vertex_cache_before.vertices_transformed == before.vertices_transformed &&
+        refiner.vertex_cache_after.vertices_transformed == after.vertices_transformed &&
+        refiner.vertex_cache_after.triangles == after.triangles);
+    Expect(triangles_of(refiner) == triangles_before);
+
+    // vertex fetch: vertices must be referenced in ascending order of first use
+    int next = 0;
+    bool fetch_ordered = true;
+    for (int i : refiner.new_indices_submeshes) {
+        if (i > next)
+            fetch_ordered = false;
+        else if (i == next)
+            ++next;
+    }
+    Expect(fetch_ordered);
+}
+
+
+TestCase(TestSpatialSplit)
+{
+    RawVector<float3> points;
+    RawVector<float2> uv;
+    RawVector<int> counts, indices;
+    GenerateWaveMesh(counts, indices, points, uv, 2.0f, 1.0f, 256, 0.0f);
+
+    // shuffle faces to emulate meshes with poor face order
+    {
+        int num_faces = (int)counts.size();
+        RawVector<int> order(num_faces);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937(0));
+        RawVector<int> tmp = indices;
+        for (int fi = 0; fi < num_faces; ++fi)
+            memcpy(&indices[fi * 4], &tmp[order[fi] * 4], sizeof(int) * 4);
+    }
+    RawVector<int> material_ids(counts.size());
+    for (int fi = 0; fi < (int)material_ids.size(); ++fi)
+        material_ids[fi] = fi % 3;
+
+    auto split_and_measure = [&](bool spatial) {
+        mu::MeshRefiner refiner;
+        refiner.split_unit = 8000;
+        refiner.spatial_split = spatial;
+        refiner.counts = counts;
+        refiner.indices = indices;
+        refiner.points = points;
+        TestScope(spatial ? "spatial split" : "face order split", [&]() {
+            refiner.refine();
+        });
+        refiner.retopology(false);
+        refiner.genSubmeshes(material_ids);
+
+        // submeshes must match material ids of their source faces
+        int num_tri_indices = 0;
+        for (auto& sm : refiner.submeshes)
+            num_tri_indices += sm.index_count;
+        Expect(num_tri_indices == (int)counts.size() * 6);
+        Expect(refiner.new2old_faces.size() == counts.size());
+
+        // sum of split bounds area
+        float total = 0.0f;
+        for (auto& split : refiner.splits) {
+            float3 bmin, bmax;
+            MinMax(&refiner.new_points[split.vertex_offset], split.vertex_count, bmin, bmax);
+            float3 size = bmax - bmin;
+            total += size.x * size.z;
+        }
+        Print("    %d splits, total bounds area %f\n", (int)refiner.splits.size(), total);
+        return total;
+    };
+    float area_face_order = split_and_measure(false);
+    float area_spatial = split_and_measure(true);
+    Expect(area_spatial < area_face_order * 0.5f);
+}
+
+
+TestCase(TestSimplify)
+{
+    RawVector<float3> points;
+    RawVector<float2> uv;
+    RawVector<int> counts, indices;
+    GenerateIcoSphereMesh(counts, indices, points, uv, 1.0f, 5);
+    int num_triangles = (int)indices.size() / 3;
+
+    for (float ratio : { 0.5f, 0.25f, 0.05f }) {
+        RawVector<int> lod;
+        float error = 0.0f;
+        int target = (int)(num_triangles * ratio) * 3;
+        TestScope("SimplifyTriangles", [&]() {
+            error = SimplifyTriangles(lod, indices, points, target);
+        });
+        Print("    ratio %.2f: %d -> %d triangles (error %f)\n", ratio, num_triangles, (int)lod.size() / 3, error);
+        Expect(lod.size() <= target + 6);
+
+        // simplified mesh must stay close to the sphere
+        bool valid = true;
+        for (int i : lod) {
+            if (i < 0 || i >= (int)points.size())
+                valid = false;
+        }
+        Expect(valid);
+        for (size_t i = 0; i < lod.size(); i += 3) {
+            float3 c = (points[lod[i]] + points[lod[i + 1]] + points[lod[i + 2]]) / 3.0f;
+            if (length(c) < 0.8f)
+                valid = false;
+        }
+        Expect(valid);
+    }
+}
+
+
 TestCase(TestNormalsAndTangents)
 {
     RawVector<int> indices, counts;
@@ -134,8 +406,8 @@ TestCase(TestNormalsAndTangents)
     }
 
     // generate soa data
-    for (auto& v : normals) { v.resize(points.size()); }
-    for (auto& v : tangents) { v.resize(points.size()); }
+    for (auto& v : normals) { v.resize_zeroclear(points.size()); }
+    for (auto& v : tangents) { v.resize_zeroclear(points.size()); }
     for (auto& v : psoa) { v.resize(num_triangles); }
     for (auto& v : usoa) { v.resize(num_triangles); }
     for (int ti = 0; ti < num_triangles; ++ti) {
@@ -307,6 +579,49 @@ TestCase(TestNormalsAndTangents)
 }
 
 
+TestCase(TestNormalsPolyOffsets)
+{
+    RawVector<int> indices, counts;
+    RawVector<float3> points;
+    RawVector<float2> uv;
+    GenerateWaveMesh(counts, indices, points, uv, 10.0f, 0.25f, 200, 0.0f);
+
+    // same mesh with a line after every polygon. faces with less than 3 corners must not shift following faces.
+    RawVector<int> indices2, counts2;
+    {
+        int offset = 0;
+        for (int count : counts) {
+            counts2.push_back(count);
+            indices2.insert(indices2.end(), &indices[offset], &indices[offset] + count);
+            counts2.push_back(2);
+            indices2.push_back(indices[offset]);
+            indices2.push_back(indices[offset + 1]);
+            offset += count;
+        }
+    }
+
+    RawVector<int> offsets2(counts2.size());
+    ExclusiveScan(offsets2.data(), counts2.data(), (int)counts2.size());
+
+    RawVector<float3> normals, normals2;
+    GenerateNormalsPoly(normals, points, counts, indices, false);
+    GenerateNormalsPoly(normals2, points, counts2, offsets2, indices2, false);
+    Expect(NearEqual(normals.data(), normals2.data(), normals.size()));
+
+    GenerateNormalsWithSmoothAngle(normals, points, counts, indices, 40.0f, false);
+    GenerateNormalsWithSmoothAngle(normals2, points, counts2, offsets2, indices2, 40.0f, false);
+    bool valid = true;
+    int offset = 0;
+    for (size_t fi = 0; fi < counts2.size(); ++fi) {
+        if (counts2[fi] >= 3) {
+            for (int ci = 0; ci < counts2[fi]; ++ci)
+                valid = valid && near_equal(normals[offset + ci], normals2[offsets2[fi] + ci]);
+            offset += counts2[fi];
+        }
+    }
+    Expect(valid);
+}
+
 TestCase(TestMatrixSwapHandedness)
 {
     quatf rot1 = rotate(normalize(float3{0.15f, 0.3f, 0.6f}), 60.0f);
@@ -369,8 +684,465 @@ TestCase(TestMulPoints)
         Print("    *** validation failed ***\n");
     }
 #endif
+
+    // avoid zero-length vectors to be normalized
+    for (int i = 0; i < num_data; ++i) {
+        src[i] = { (float)(i + 1)*0.1f, (float)(i + 1)*0.05f, (float)(i + 1)*0.025f };
+    }
+
+    TestScope("MulNormals C++", [&]() {
+        MulNormals_Generic(matrix, src.data(), dst1.data(), num_data);
+    }, num_try);
+#ifdef muSIMD_MulNormals3
+    TestScope("MulNormals ISPC", [&]() {
+        MulNormals_ISPC(matrix, src.data(), dst2.data(), num_data);
+    }, num_try);
+    if (!NearEqual(dst1.data(), dst2.data(), num_data)) {
+        Print("    *** validation failed ***\n");
+    }
+#endif
+
+    RawVector<float4> src4, dst41, dst42;
+    src4.resize(num_data);
+    dst41.resize(num_data);
+    dst42.resize(num_data);
+    for (int i = 0; i < num_data; ++i) {
+        src4[i] = { (float)(i + 1)*0.1f, (float)(i + 1)*0.05f, (float)(i + 1)*0.025f, i % 2 == 0 ? 1.0f : -1.0f };
+    }
+
+    TestScope("MulTangents C++", [&]() {
+        MulTangents_Generic(matrix, src4.data(), dst41.data(), num_data);
+    }, num_try);
+#ifdef muSIMD_MulTangents4
+    TestScope("MulTangents ISPC", [&]() {
+        MulTangents_ISPC(matrix, src4.data(), dst42.data(), num_data);
+    }, num_try);
+    if (!NearEqual(dst41.data(), dst42.data(), num_data)) {
+        Print("    *** validation failed ***\n");
+    }
+#endif
 }
 
+TestCase(TestDoubleConversion)
+{
+    // odd size to cover the remainder of SIMD loops
+    const int num_data = 65536 + 3;
+    const int num_try = 128;
+
+    RawVector<double> srcd;
+    RawVector<float> dst1, dst2;
+    srcd.resize(num_data * 3);
+    dst1.resize(num_data * 3);
+    dst2.resize(num_data * 3);
+    for (int i = 0; i < num_data * 3; ++i)
+        srcd[i] = (double)i * 0.01 - 1000.0;
+
+    TestScope("F64ToF32 C++", [&]() {
+        F64ToF32_Generic(dst1.data(), srcd.data(), srcd.size());
+    }, num_try);
+    TestScope("F64ToF32", [&]() {
+        F64ToF32(dst2.data(), srcd.data(), srcd.size());
+    }, num_try);
+    Expect(NearEqual(dst1.data(), dst2.data(), dst1.size()));
+#ifdef muX86
+    if (GetCPUFeatures().sse41) {
+        F64ToF32_SSE4(dst2.data(), srcd.data(), srcd.size());
+        Expect(NearEqual(dst1.data(), dst2.data(), dst1.size()));
+    }
+    if (GetCPUFeatures().avx2) {
+        F64ToF32_AVX2(dst2.data(), srcd.data(), srcd.size());
+        Expect(NearEqual(dst1.data(), dst2.data(), dst1.size()));
+    }
+#endif
+
+    // the double path must match converting first and transforming in float.
+    // handedness and scale are composed into the matrix.
+    float4x4 matrix = transform({ 1.0f, 2.0f, 4.0f }, rotate_y(45.0f), { 2.0f, 2.0f, 2.0f }) * scale44(float3{ -0.01f, 0.01f, 0.01f });
+    double4x4 matrixd = to<double4x4>(matrix);
+
+    const double3 *src3d = (const double3*)srcd.data();
+    RawVector<float3> src3, ref, dst;
+    src3.resize(num_data);
+    ref.resize(num_data);
+    dst.resize(num_data);
+    F64ToF32((float*)src3.data(), srcd.data(), srcd.size());
+
+    MulPoints(matrix, src3.data(), ref.data(), num_data);
+    TestScope("MulPoints double C++", [&]() {
+        MulPoints_Generic(matrixd, src3d, dst.data(), num_data);
+    }, num_try);
+    Expect(NearEqual(ref.data(), dst.data(), num_data));
+    TestScope("MulPoints double", [&]() {
+        MulPoints(matrixd, src3d, dst.data(), num_data);
+    }, num_try);
+    Expect(NearEqual(ref.data(), dst.data(), num_data));
+
+    MulVectors(matrix, src3.data(), ref.data(), num_data);
+    MulVectors(matrixd, src3d, dst.data(), num_data);
+    Expect(NearEqual(ref.data(), dst.data(), num_data));
+
+    // avoid zero-length vectors to be normalized
+    for (int i = 0; i < num_data * 3; ++i)
+        srcd[i] = (double)(i + 1) * 0.01;
+    F64ToF32((float*)src3.data(), srcd.data(), srcd.size());
+    MulNormals(matrix, src3.data(), ref.data(), num_data);
+    MulNormals(matrixd, src3d, dst.data(), num_data);
+    Expect(NearEqual(ref.data(), dst.data(), num_data));
+}
+
+TestCase(TestSkin4)
+{
+    const int num_data = 65536;
+    const int num_bones = 32;
+    const int num_try = 32;
+
+    RawVector<float4x4> bones(num_bones);
+    for (int bi = 0; bi < num_bones; ++bi)
+        bones[bi] = transform({ (float)bi, 1.0f, -0.5f * bi }, rotate_y(10.0f * bi * DegToRad), { 1.0f, 1.0f + bi * 0.01f, 1.0f });
+
+    RawVector<Weights4> weights(num_data);
+    RawVector<float3> points(num_data), normals(num_data);
+    RawVector<float4> tangents(num_data);
+    for (int i = 0; i < num_data; ++i) {
+        auto& w = weights[i];
+        for (int j = 0; j < 4; ++j) {
+            w.indices[j] = (i * 7 + j * 13) % num_bones;
+            w.weights[j] = (float)(4 - j + i % 3);
+        }
+        w.normalize();
+        points[i] = { (float)i * 0.01f, (float)(i % 100) * 0.1f, 1.0f };
+        normals[i] = normalize(float3{ 1.0f, (float)(i % 10) + 1.0f, 0.5f });
+        tangents[i] = { 0.0f, 0.0f, 1.0f, i % 2 == 0 ? 1.0f : -1.0f };
+    }
+
+    // naive reference: sum of vertices transformed by each influence
+    RawVector<float3> ref_points(num_data), ref_normals(num_data);
+    RawVector<float4> ref_tangents(num_data);
+    for (int i = 0; i < num_data; ++i) {
+        auto& w = weights[i];
+        float3 p = float3::zero(), n = float3::zero(), t = float3::zero();
+        for (int j = 0; j < 4; ++j) {
+            auto& m = bones[w.indices[j]];
+            p += mul_p(m, points[i]) * w.weights[j];
+            n += mul_v(m, normals[i]) * w.weights[j];
+            t += mul_v(m, (float3&)tangents[i]) * w.weights[j];
+        }
+        n = normalize(n);
+        t = normalize(t);
+        ref_points[i] = p;
+        ref_normals[i] = n;
+        ref_tangents[i] = { t.x, t.y, t.z, tangents[i].w };
+    }
+
+    Print(
+        "    num_data: %d\n"
+        "    num_bones: %d\n",
+        num_data,
+        num_bones);
+
+    RawVector<float3> dst_points(num_data), dst_normals(num_data);
+    RawVector<float4> dst_tangents(num_data);
+    auto validate = [&]() {
+        Expect(NearEqual(dst_points.data(), ref_points.data(), num_data, 1e-3f));
+        Expect(NearEqual(dst_normals.data(), ref_normals.data(), num_data, 1e-4f));
+        Expect(NearEqual(dst_tangents.data(), ref_tangents.data(), num_data, 1e-4f));
+    };
+
+    TestScope("Skin4 C++", [&]() {
+        Skin4_Generic(bones.data(), weights.data(), points.data(), normals.data(), tangents.data(),
+            dst_points.data(), dst_normals.data(), dst_tangents.data(), num_data);
+    }, num_try);
+    validate();
+#ifdef muSIMD_Skin4
+    TestScope("Skin4 ISPC", [&]() {
+        Skin4_ISPC(bones.data(), weights.data(), points.data(), normals.data(), tangents.data(),
+            dst_points.data(), dst_normals.data(), dst_tangents.data(), num_data);
+    }, num_try);
+    validate();
+#endif
+}
+
+
+TestCase(TestSIMDDispatch)
+{
+    auto& cpu = GetCPUFeatures();
+    Print("    CPU: sse4.1 %d, sse4.2 %d, avx %d, avx2 %d, fma %d, f16c %d, avx512f %d\n",
+        cpu.sse41, cpu.sse42, cpu.avx, cpu.avx2, cpu.fma, cpu.f16c, cpu.avx512f);
+    Print("    max SIMD level: %d\n", (int)GetMaxSIMDLevel());
+
+    RawVector<float3> points;
+    RawVector<float2> uv;
+    RawVector<int> counts, indices;
+    GenerateIcoSphereMesh(counts, indices, points, uv, 1.0f, 5);
+    int num_points = (int)points.size();
+    int num_triangles = (int)indices.size() / 3;
+    float4x4 matrix = transform({ 1.0f, 2.0f, 4.0f }, rotate_y(45.0f), { 2.0f, 2.0f, 2.0f });
+
+    // spherical mapping for tangents
+    uv.resize(num_points);
+    for (int i = 0; i < num_points; ++i) {
+        auto& p = points[i];
+        uv[i] = { std::atan2(p.z, p.x) / (2.0f * PI) + 0.5f, std::asin(clamp11(p.y)) / PI + 0.5f };
+    }
+
+    RawVector<float> floats;
+    floats.resize(num_points * 3);
+    for (int i = 0; i < num_points * 3; ++i)
+        floats[i] = ((float*)points.data())[i] * 100.0f;
+
+    // results of the Generic kernels
+    RawVector<float3> ref_mul, ref_normalized, ref_normals;
+    RawVector<float4> ref_tangents;
+    RawVector<half> ref_half;
+    RawVector<float> ref_float;
+    float3 ref_min, ref_max;
+    int ref_hits, ref_tindex;
+    float ref_distance;
+    float3 ray_pos = { 0.1f, 0.2f, 3.0f }, ray_dir = { 0.0f, 0.0f, -1.0f };
+
+    ref_mul.resize(num_points);
+    MulPoints_Generic(matrix, points.data(), ref_mul.data(), num_points);
+    ref_normalized = ref_mul;
+    Normalize_Generic(ref_normalized.data(), num_points);
+    MinMax_Generic(ref_mul.data(), num_points, ref_min, ref_max);
+    ref_normals.resize(num_points);
+    GenerateNormalsTriangleIndexed_Generic(ref_normals.data(), points.data(), indices.data(), num_triangles, num_points);
+    ref_tangents.resize(num_points);
+    GenerateTangentsTriangleIndexed_Generic(ref_tangents.data(), points.data(), uv.data(), ref_normals.data(), indices.data(), num_triangles, num_points);
+    ref_half.resize(floats.size());
+    F32ToF16_Generic(ref_half.data(), floats.data(), floats.size());
+    ref_float.resize(floats.size());
+    F16ToF32_Generic(ref_float.data(), ref_half.data(), floats.size());
+    ref_hits = RayTrianglesIntersectionIndexed_Generic(ray_pos, ray_dir, points.data(), indices.data(), num_triangles, ref_tindex, ref_distance);
+
+    // every level the CPU supports must give the same results
+    auto default_level = GetSIMDLevel();
+    for (int level = (int)SIMDLevel::Generic; level <= (int)GetMaxSIMDLevel(); ++level) {
+        SetSIMDLevel((SIMDLevel)level);
+        Expect(GetSIMDLevel() == (SIMDLevel)level);
+
+        RawVector<float3> mul, normalized, normals;
+        RawVector<float4> tangents;
+        RawVector<half> halfs;
+        RawVector<float> floats2;
+        float3 vmin, vmax;
+        int hits, tindex;
+        float distance;
+
+        mul.resize(num_points);
+        MulPoints(matrix, points.data(), mul.data(), num_points);
+        normalized = mul;
+        Normalize(normalized.data(), num_points);
+        MinMax(mul.data(), num_points, vmin, vmax);
+        normals.resize(num_points);
+        GenerateNormalsTriangleIndexed(normals.data(), points.data(), indices.data(), num_triangles, num_points);
+        tangents.resize(num_points);
+        GenerateTangentsTriangleIndexed(tangents.data(), points.data(), uv.data(), normals.data(), indices.data(), num_triangles, num_points);
+        halfs.resize(floats.size());
+        F32ToF16(halfs.data(), floats.data(), floats.size());
+        floats2.resize(floats.size());
+        F16ToF32(floats2.data(), ref_half.data(), floats.size());
+        hits = RayTrianglesIntersectionIndexed(ray_pos, ray_dir, points.data(), indices.data(), num_triangles, tindex, distance);
+
+        // half conversions may round instead of truncate. compare with the precision of half.
+        bool half_valid = true;
+        for (size_t i = 0; i < floats.size(); ++i) {
+            float a = halfs[i], b = ref_half[i];
+            if (std::abs(a - b) > std::abs(b) * 2e-3f + 1e-4f || floats2[i] != ref_float[i])
+                half_valid = false;
+        }
+
+        Print("    level %d\n", level);
+        Expect(NearEqual(mul.data(), ref_mul.data(), num_points));
+        Expect(NearEqual(normalized.data(), ref_normalized.data(), num_points));
+        Expect(near_equal(vmin, ref_min) && near_equal(vmax, ref_max));
+        Expect(NearEqual(normals.data(), ref_normals.data(), num_points));
+        Expect(NearEqual(tangents.data(), ref_tangents.data(), num_points));
+        Expect(half_valid);
+        Expect(hits == ref_hits && tindex == ref_tindex && near_equal(distance, ref_distance));
+    }
+    SetSIMDLevel(default_level);
+}
+
+#ifdef muX86
+TestCase(TestSIMDIntrinsics)
+{
+    auto& cpu = GetCPUFeatures();
+    bool sse4 = cpu.sse41;
+    bool avx2 = cpu.avx2;
+    if (!sse4) {
+        Print("    SSE4.1 is not available. skipped.\n");
+        return;
+    }
+
+    RawVector<float3> points;
+    RawVector<float2> uv;
+    RawVector<int> counts, indices;
+    GenerateIcoSphereMesh(counts, indices, points, uv, 1.0f, 6);
+    // odd sizes to exercise remainder loops
+    indices.resize(indices.size() - 3 * 5);
+    points.resize(points.size() - 3);
+    for (auto& i : indices)
+        i = std::min(i, (int)points.size() - 1);
+    int num_points = (int)points.size();
+    int num_triangles = (int)indices.size() / 3;
+    for (int i = 0; i < num_points; ++i)
+        points[i] *= 1.0f + 0.1f * std::sin((float)i);
+
+    // SumInt32
+    {
+        RawVector<uint32_t> data(1000003);
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = (uint32_t)(i * 2654435761u);
+        uint64_t ref = 0, r_sse4 = 0, r_avx2 = 0;
+        TestScope("SumInt32_Generic", [&]() { ref = SumInt32_Generic(data.data(), data.size()); }, 10);
+        TestScope("SumInt32_SSE4", [&]() { r_sse4 = SumInt32_SSE4(data.data(), data.size()); }, 10);
+        Expect(r_sse4 == ref);
+        if (avx2) {
+            TestScope("SumInt32_AVX2", [&]() { r_avx2 = SumInt32_AVX2(data.data(), data.size()); }, 10);
+            Expect(r_avx2 == ref);
+        }
+    }
+
+    // MinMax
+    {
+        auto check = [&](const auto *src, size_t num) {
+            using T = typename std::remove_const<typename std::remove_pointer<decltype(src)>::type>::type;
+            T ref_min, ref_max, rmin, rmax;
+            MinMax_Generic(src, num, ref_min, ref_max);
+            MinMax_SSE4(src, num, rmin, rmax);
+            Expect(rmin == ref_min && rmax == ref_max);
+            if (avx2) {
+                MinMax_AVX2(src, num, rmin, rmax);
+                Expect(rmin == ref_min && rmax == ref_max);
+            }
+        };
+        for (size_t n : { 1, 7, 13, 25, 1001 }) {
+            n = std::min(n, (size_t)num_points / 4);
+            check((const float*)points.data(), n);
+            check((const float2*)points.data(), n);
+            check(points.data(), n);
+            check((const float4*)points.data(), n);
+            check(indices.data(), n);
+        }
+
+        float3 ref_min, ref_max, rmin, rmax;
+        TestScope("MinMax_Generic", [&]() { MinMax_Generic(points.data(), num_points, ref_min, ref_max); }, 10);
+        TestScope("MinMax_SSE4", [&]() { MinMax_SSE4(points.data(), num_points, rmin, rmax); }, 10);
+        Expect(rmin == ref_min && rmax == ref_max);
+        if (avx2) {
+            TestScope("MinMax_AVX2", [&]() { MinMax_AVX2(points.data(), num_points, rmin, rmax); }, 10);
+            Expect(rmin == ref_min && rmax == ref_max);
+        }
+    }
+
+    // Normalize
+    {
+        RawVector<float3> ref, r_sse4, r_avx2;
+        ref = r_sse4 = r_avx2 = points;
+        TestScope("Normalize_Generic", [&]() { Normalize_Generic(ref.data(), num_points); }, 1);
+        TestScope("Normalize_SSE4", [&]() { Normalize_SSE4(r_sse4.data(), num_points); }, 1);
+        Expect(NearEqual(r_sse4.data(), ref.data(), num_points));
+        if (avx2) {
+            TestScope("Normalize_AVX2", [&]() { Normalize_AVX2(r_avx2.data(), num_points); }, 1);
+            Expect(NearEqual(r_avx2.data(), ref.data(), num_points));
+        }
+    }
+
+    // GenerateNormalsTriangleIndexed
+    {
+        RawVector<float3> ref, r_sse4, r_avx2;
+        ref.resize(num_points);
+        r_sse4.resize(num_points);
+        r_avx2.resize(num_points);
+        TestScope("GenerateNormalsTriangleIndexed_Generic", [&]() {
+            GenerateNormalsTriangleIndexed_Generic(ref.data(), points.data(), indices.data(), num_triangles, num_points);
+        }, 10);
+        TestScope("GenerateNormalsTriangleIndexed_SSE4", [&]() {
+            GenerateNormalsTriangleIndexed_SSE4(r_sse4.data(), points.data(), indices.data(), num_triangles, num_points);
+        }, 10);
+        Expect(NearEqual(r_sse4.data(), ref.data(), num_points));
+        if (avx2) {
+            TestScope("GenerateNormalsTriangleIndexed_AVX2", [&]() {
+                GenerateNormalsTriangleIndexed_AVX2(r_avx2.data(), points.data(), indices.data(), num_triangles, num_points);
+            }, 10);
+            Expect(NearEqual(r_avx2.data(), ref.data(), num_points));
+        }
+    }
+
+    // MulMatrices
+    {
+        const int num = 4096 + 1;
+        RawVector<float4x4> a, b, ref, r;
+        a.resize(num); b.resize(num); ref.resize(num); r.resize(num);
+        for (int i = 0; i < num; ++i) {
+            a[i] = transform(float3{ (float)i, 1.0f, 2.0f }, rotate_y((float)i), float3{ 1.0f, 2.0f, 0.5f });
+            b[i] = transform(float3{ -1.0f, (float)i * 0.5f, 0.0f }, rotate_z((float)i * 0.5f), float3::one());
+        }
+        auto near_equal = [&]() {
+            return NearEqual((const float4*)r.data(), (const float4*)ref.data(), num * 4, 1e-3f);
+        };
+        TestScope("MulMatrices_Generic", [&]() {
+            MulMatrices_Generic(a.data(), b.data(), ref.data(), num);
+        }, 10);
+        TestScope("MulMatrices_SSE4", [&]() {
+            MulMatrices_SSE4(a.data(), b.data(), r.data(), num);
+        }, 10);
+        Expect(near_equal());
+        if (avx2) {
+            TestScope("MulMatrices_AVX2", [&]() {
+                MulMatrices_AVX2(a.data(), b.data(), r.data(), num);
+            }, 10);
+            Expect(near_equal());
+        }
+        // dst can be a source
+        r = a;
+        MulMatrices(r.data(), b.data(), r.data(), num);
+        Expect(near_equal());
+    }
+
+    // LerpWeighted & Slerp
+    {
+        const int num = 4096 + 3;
+        RawVector<float4> va, vb, vref, vr;
+        RawVector<quatf> qa, qb, qref, qr;
+        RawVector<float> w;
+        va.resize(num); vb.resize(num); vref.resize(num); vr.resize(num);
+        qa.resize(num); qb.resize(num); qref.resize(num); qr.resize(num);
+        w.resize(num);
+        for (int i = 0; i < num; ++i) {
+            float f = (float)i;
+            va[i] = { std::sin(f), f, -f, 1.0f };
+            vb[i] = { std::cos(f), f * 2.0f, 0.0f, -1.0f };
+            // mostly small angles as sampled animations, some large angles and flipped signs
+            qa[i] = rotate_y(f * 0.1f);
+            qb[i] = rotate_y(f * 0.1f + (i % 97 == 0 ? 2.0f : 0.05f));
+            if (i % 5 == 0)
+                qb[i] = { -qb[i].x, -qb[i].y, -qb[i].z, -qb[i].w };
+            w[i] = (float)(i % 11) / 10.0f;
+        }
+
+        TestScope("LerpWeighted_Generic", [&]() { LerpWeighted_Generic(vref.data(), va.data(), vb.data(), w.data(), num); }, 10);
+        TestScope("LerpWeighted_SSE4", [&]() { LerpWeighted_SSE4(vr.data(), va.data(), vb.data(), w.data(), num); }, 10);
+        Expect(NearEqual(vr.data(), vref.data(), num));
+        if (avx2) {
+            TestScope("LerpWeighted_AVX2", [&]() { LerpWeighted_AVX2(vr.data(), va.data(), vb.data(), w.data(), num); }, 10);
+            Expect(NearEqual(vr.data(), vref.data(), num));
+        }
+
+        auto near_equal = [&]() {
+            return NearEqual((const float4*)qr.data(), (const float4*)qref.data(), num, 1e-5f);
+        };
+        TestScope("Slerp_Generic", [&]() { Slerp_Generic(qref.data(), qa.data(), qb.data(), w.data(), num); }, 10);
+        TestScope("Slerp_SSE4", [&]() { Slerp_SSE4(qr.data(), qa.data(), qb.data(), w.data(), num); }, 10);
+        Expect(near_equal());
+        if (avx2) {
+            TestScope("Slerp_AVX2", [&]() { Slerp_AVX2(qr.data(), qa.data(), qb.data(), w.data(), num); }, 10);
+            Expect(near_equal());
+        }
+    }
+}
+#endif
 
 TestCase(TestRayTrianglesIntersection)
 {
@@ -484,6 +1256,104 @@ TestCase(TestRayTrianglesIntersection)
 }
 
 
+TestCase(TestTriangleBVH)
+{
+    // coherent rays from a camera toward a grid on the z=0 plane
+    const int ray_div = 32;
+    const int num_rays = ray_div * ray_div;
+    RawVector<float3> ray_pos, ray_dir;
+    ray_pos.resize(num_rays);
+    ray_dir.resize(num_rays);
+    for (int yi = 0; yi < ray_div; ++yi) {
+        for (int xi = 0; xi < ray_div; ++xi) {
+            int ri = yi * ray_div + xi;
+            float3 target = { (float)xi / (ray_div - 1) * 2.4f - 1.2f, (float)yi / (ray_div - 1) * 2.4f - 1.2f, 0.0f };
+            ray_pos[ri] = { 0.1f, 0.2f, 3.0f };
+            ray_dir[ri] = normalize(target - ray_pos[ri]);
+        }
+    }
+
+    for (int iteration : { 3, 4, 5, 6 }) {
+        RawVector<float3> points;
+        RawVector<float2> uv;
+        RawVector<int> counts, indices;
+        GenerateIcoSphereMesh(counts, indices, points, uv, 1.0f, iteration);
+        int num_triangles = (int)indices.size() / 3;
+        Print("    ico sphere iteration %d: %d triangles, %d rays\n", iteration, num_triangles, num_rays);
+
+        TriangleBVH bvh;
+        TestScope("TriangleBVH::build", [&]() {
+            bvh.build(points, indices);
+        });
+        Print("        %d nodes, depth %d\n", bvh.getNodeCount(), bvh.getDepth());
+        Expect(bvh.getTriangleCount() == num_triangles);
+
+        RawVector<int> hits_linear, hits_bvh;
+        RawVector<int> tindices_linear, tindices_bvh, tindices_nearest, tindices_packet;
+        RawVector<float> distances_linear, distances_bvh, distances_nearest, distances_packet;
+        for (auto *v : { &hits_linear, &hits_bvh, &tindices_linear, &tindices_bvh, &tindices_nearest, &tindices_packet })
+            v->resize(num_rays);
+        for (auto *v : { &distances_linear, &distances_bvh, &distances_nearest, &distances_packet })
+            v->resize(num_rays);
+
+        TestScope("RayTrianglesIntersectionIndexed", [&]() {
+            for (int ri = 0; ri < num_rays; ++ri)
+                hits_linear[ri] = RayTrianglesIntersectionIndexed(ray_pos[ri], ray_dir[ri],
+                    points.data(), indices.data(), num_triangles, tindices_linear[ri], distances_linear[ri]);
+        });
+        TestScope("TriangleBVH::rayIntersection", [&]() {
+            for (int ri = 0; ri < num_rays; ++ri)
+                hits_bvh[ri] = bvh.rayIntersection(ray_pos[ri], ray_dir[ri], tindices_bvh[ri], distances_bvh[ri]);
+        });
+        TestScope("TriangleBVH::rayNearest", [&]() {
+            for (int ri = 0; ri < num_rays; ++ri)
+                bvh.rayNearest(ray_pos[ri], ray_dir[ri], tindices_nearest[ri], distances_nearest[ri]);
+        });
+        TestScope("TriangleBVH::rayNearest (packet)", [&]() {
+            bvh.rayNearest(ray_pos.data(), ray_dir.data(), num_rays, tindices_packet.data(), distances_packet.data());
+        });
+
+        // results must be identical to the linear kernel
+        int num_hit_rays = 0;
+        bool valid = true;
+        for (int ri = 0; ri < num_rays; ++ri) {
+            if (hits_linear[ri] != hits_bvh[ri])
+                valid = false;
+            if (hits_linear[ri] > 0) {
+                ++num_hit_rays;
+                if (tindices_linear[ri] != tindices_bvh[ri] || distances_linear[ri] != distances_bvh[ri] ||
+                    tindices_linear[ri] != tindices_nearest[ri] || distances_linear[ri] != distances_nearest[ri] ||
+                    tindices_linear[ri] != tindices_packet[ri] || distances_linear[ri] != distances_packet[ri])
+                    valid = false;
+            }
+            else {
+                if (tindices_nearest[ri] != -1 || tindices_packet[ri] != -1)
+                    valid = false;
+            }
+        }
+        Print("        %d rays hit\n", num_hit_rays);
+        Expect(num_hit_rays > 0);
+        Expect(valid);
+
+        // box query
+        float3 bmin = { 0.2f, 0.2f, -1.0f }, bmax = { 0.6f, 0.5f, 1.0f };
+        RawVector<int> found;
+        bvh.overlap(bmin, bmax, found);
+        std::sort(found.begin(), found.end());
+        RawVector<int> expected;
+        for (int ti = 0; ti < num_triangles; ++ti) {
+            auto p1 = points[indices[ti * 3 + 0]];
+            auto p2 = points[indices[ti * 3 + 1]];
+            auto p3 = points[indices[ti * 3 + 2]];
+            auto tmin = min(min(p1, p2), p3);
+            auto tmax = max(max(p1, p2), p3);
+            if (tmin.x <= bmax.x && tmax.x >= bmin.x && tmin.y <= bmax.y && tmax.y >= bmin.y && tmin.z <= bmax.z && tmax.z >= bmin.z)
+                expected.push_back(ti);
+        }
+        Expect(found == expected);
+    }
+}
+
 TestCase(TestPolygonInside)
 {
     const int num_try = 100;
@@ -736,6 +1606,132 @@ TestCase(TestSum)
     }, 1);
 }
 
+TestCase(TestParallelPrimitives)
+{
+    // larger than kParallelBlockSize and not a multiple of it to exercise multiple blocks and remainders
+    const int num = 1000003;
+    uint32_t seed = 1;
+    auto rand32 = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed; };
+
+    RawVector<int> src(num);
+    for (int i = 0; i < num; ++i)
+        src[i] = (int)(rand32() >> 24);
+
+    // ExclusiveScan
+    {
+        RawVector<int> ref(num), dst(num);
+        int ref_total = 0;
+        for (int i = 0; i < num; ++i) {
+            ref[i] = ref_total;
+            ref_total += src[i];
+        }
+        int total = ExclusiveScan(dst.data(), src.data(), num);
+        Expect(total == ref_total && dst == ref);
+
+        // in place
+        dst = src;
+        total = ExclusiveScan(dst.data(), dst.data(), num);
+        Expect(total == ref_total && dst == ref);
+    }
+
+    // Gather / Scatter
+    {
+        RawVector<int> perm(num), gathered(num), scattered(num);
+        for (int i = 0; i < num; ++i)
+            perm[i] = i;
+        for (int i = num - 1; i > 0; --i)
+            std::swap(perm[i], perm[rand32() % (i + 1)]);
+
+        Gather(gathered.data(), src.data(), perm.data(), num);
+        bool gather_valid = true;
+        for (int i = 0; i < num; ++i)
+            gather_valid = gather_valid && gathered[i] == src[perm[i]];
+        Expect(gather_valid);
+
+        Scatter(scattered.data(), gathered.data(), perm.data(), num);
+        Expect(scattered == src);
+    }
+
+    // Compact / CompactIndices
+    {
+        auto pred = [](int v) { return (v & 3) == 0; };
+        RawVector<int> ref, dst(num), dst_indices(num), ref_indices;
+        for (int i = 0; i < num; ++i) {
+            if (pred(src[i])) {
+                ref.push_back(src[i]);
+                ref_indices.push_back(i);
+            }
+        }
+        int n = Compact(dst.data(), src.data(), num, pred);
+        dst.resize(n);
+        Expect(dst == ref);
+
+        n = CompactIndices(dst_indices.data(), num, [&](int i) { return pred(src[i]); });
+        dst_indices.resize(n);
+        Expect(dst_indices == ref_indices);
+    }
+
+    // Histogram
+    {
+        const int num_bins = 256;
+        RawVector<int> ref(num_bins), dst(num_bins), ref_weighted(num_bins), dst_weighted(num_bins);
+        ref.zeroclear();
+        ref_weighted.zeroclear();
+        for (int i = 0; i < num; ++i) {
+            ++ref[src[i]];
+            ref_weighted[src[i]] += i & 7;
+        }
+        Histogram(dst.data(), num_bins, num, [&](int i) { return src[i]; });
+        Expect(dst == ref);
+        Histogram(dst_weighted.data(), num_bins, num, [&](int i) { return src[i]; }, [](int i) { return i & 7; });
+        Expect(dst_weighted == ref_weighted);
+    }
+
+    // RadixSort. must be stable as std::stable_sort
+    {
+        RawVector<uint32_t> keys32(num);
+        RawVector<uint64_t> keys64(num);
+        RawVector<int> values(num);
+        for (int i = 0; i < num; ++i) {
+            keys32[i] = rand32() >> 12; // duplicates
+            keys64[i] = ((uint64_t)rand32() << 20) ^ rand32();
+            values[i] = i;
+        }
+
+        auto check = [&](auto& keys) {
+            using Key = typename std::remove_reference<decltype(keys[0])>::type;
+            std::vector<std::pair<Key, int>> ref(num);
+            for (int i = 0; i < num; ++i)
+                ref[i] = { keys[i], values[i] };
+            TestScope("std::stable_sort", [&]() {
+                std::stable_sort(ref.begin(), ref.end(), [](auto& a, auto& b) { return a.first < b.first; });
+            });
+
+            auto k = keys;
+            auto v = values;
+            TestScope("RadixSort", [&]() {
+                RadixSort(k.data(), v.data(), num);
+            });
+            bool valid = true;
+            for (int i = 0; i < num; ++i)
+                valid = valid && k[i] == ref[i].first && v[i] == ref[i].second;
+            Expect(valid);
+
+            // keys only
+            k = keys;
+            RadixSort(k.data(), nullptr, num);
+            valid = true;
+            for (int i = 0; i < num; ++i)
+                valid = valid && k[i] == ref[i].first;
+            Expect(valid);
+        };
+        Print("    32 bit keys\n");
+        check(keys32);
+        Print("    64 bit keys\n");
+        check(keys64);
+    }
+}
+
 TestCase(TestCompareRawVector)
 {
     const size_t input_size = 10000000;
@@ -959,6 +1955,18 @@ TestCase(Test_Quat32)
     }
 }
 
+TestCase(Test_Half)
+{
+    auto roundtrip = [](float v) { return (float)half(v); };
+    Expect(roundtrip(1.0f) == 1.0f && roundtrip(-2.5f) == -2.5f);
+    Expect(roundtrip(65504.0f) == 65504.0f);
+    // out of range values are clamped, not wrapped
+    Expect(roundtrip(70000.0f) == 65504.0f && roundtrip(-1e10f) == -65504.0f);
+    Expect(roundtrip(std::numeric_limits<float>::infinity()) == 65504.0f);
+    // too small values are flushed to zero
+    Expect(roundtrip(1e-6f) == 0.0f && roundtrip(-1e-6f) == 0.0f);
+}
+
 TestCase(Test_S10x3)
 {
     const int N = 100;
@@ -1088,7 +2096,42 @@ TestCase(Test_Quadify)
         };
 
         RawVector<int> dst_indices, dst_counts;
-        QuadifyTriangles(points, triangles, false, 15.0f, dst_indices, dst_counts);
+        QuadifyTriangles(points, triangles, 15.0f, dst_indices, dst_counts);
         Expect(dst_counts.size() == 4);
     }
+
+    {
+        // shuffled grid: neighbor triangles are not adjacent in the index buffer
+        const int div = 256;
+        RawVector<float3> points;
+        RawVector<int> triangles;
+        for (int yi = 0; yi <= div; ++yi)
+            for (int xi = 0; xi <= div; ++xi)
+                points.push_back({ (float)xi, (float)yi, 0.0f });
+        for (int yi = 0; yi < div; ++yi) {
+            for (int xi = 0; xi < div; ++xi) {
+                int i0 = yi * (div + 1) + xi;
+                int i1 = i0 + 1, i2 = i0 + (div + 1), i3 = i2 + 1;
+                int quad_tris[] = { i0, i1, i3, i0, i3, i2 };
+                triangles.insert(triangles.end(), quad_tris, quad_tris + 6);
+            }
+        }
+        int num_triangles = (int)triangles.size() / 3;
+        RawVector<int> order(num_triangles);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937(0));
+        RawVector<int> shuffled;
+        for (int ti : order)
+            shuffled.insert(shuffled.end(), &triangles[ti * 3], &triangles[ti * 3] + 3);
+
+        RawVector<int> dst_indices, dst_counts;
+        TestScope("QuadifyTriangles", [&]() {
+            dst_indices.clear();
+            dst_counts.clear();
+            QuadifyTriangles(points, shuffled, 15.0f, dst_indices, dst_counts);
+        });
+        Print("    %d triangles -> %d faces\n", num_triangles, (int)dst_counts.size());
+        Expect(dst_counts.size() == div * div);
+        Expect(std::all_of(dst_counts.begin(), dst_counts.end(), [](int c) { return c == 4; }));
+    }
 }
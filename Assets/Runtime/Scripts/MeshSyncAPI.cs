@@ -120,6 +120,22 @@ namespace UTJ.MeshSync
 
 
     #region Server
+    // interleaved vertex layouts. see mu::VertexFormat in muVertex.h
+    public enum VertexFormat
+    {
+        Unknown,
+        V3N3,
+        V3N3C4,
+        V3N3U2,
+        V3N3C4U2,
+        V3N3U2T4,
+        V3N3C4U2T4,
+        V3N3U2T4_Half,
+        V3N3C4U2T4_Half,
+        V3N3U2T4_S10x3,
+        V3N3C4U2T4_S10x3,
+    };
+
     public struct ServerSettings
     {
         public int maxQueue;
@@ -127,6 +143,9 @@ namespace UTJ.MeshSync
         public ushort port;
         public uint meshSplitUnit;
         public int meshMaxBoneInfluence; // -1 (variable) or 4
+        // if not Unknown, meshes also have interleaved vertices in this format (Mesh.ReadVertices()).
+        // MeshSyncServer doesn't use them to build meshes yet, so leave this Unknown unless they are read by other means.
+        public VertexFormat meshVertexFormat;
 
         public static ServerSettings defaultValue
         {
@@ -147,6 +166,7 @@ namespace UTJ.MeshSync
 #else
                     meshMaxBoneInfluence = 4,
 #endif
+                    meshVertexFormat = VertexFormat.Unknown,
                 };
             }
         }
@@ -968,6 +988,15 @@ namespace UTJ.MeshSync
         public bool usePhysicalCameraParams;
 #endif
         public Type mainComponentType;
+        public AnimationCurveBatch curveBatch;
+    }
+
+    // keyframes of all curves in a clip. made by AnimationClipData.FillCurves().
+    public class AnimationCurveBatch
+    {
+        public InterpolationMode interpolation;
+        public Keyframe[] keyframes;
+        public Dictionary<IntPtr, int> offsets; // curve -> first keyframe
     }
 
     public struct AnimationCurveData
@@ -1074,7 +1103,7 @@ namespace UTJ.MeshSync
             get { return msAnimationGetEntityType(self); }
         }
 
-        AnimationCurve[] GenCurves(AnimationCurveData data, InterpolationMode im)
+        AnimationCurve[] GenCurves(AnimationCurveData data, InterpolationMode im, AnimationCurveBatch batch)
         {
             if (!data)
                 return null;
@@ -1085,6 +1114,29 @@ namespace UTJ.MeshSync
             if (n == 0 || t == AnimationCurveData.DataType.Unknown)
                 return null;
 
+            // already converted by AnimationClipData.FillCurves()
+            int offset;
+            if (batch != null && batch.interpolation == im && batch.offsets.TryGetValue(data.self, out offset))
+            {
+                int numComponents;
+                switch (t)
+                {
+                    case AnimationCurveData.DataType.Float2: numComponents = 2; break;
+                    case AnimationCurveData.DataType.Float3: numComponents = 3; break;
+                    case AnimationCurveData.DataType.Float4: numComponents = 4; break;
+                    case AnimationCurveData.DataType.Quaternion: numComponents = im == InterpolationMode.Smooth ? 4 : 3; break;
+                    default: numComponents = 1; break;
+                }
+                var ret = new AnimationCurve[numComponents];
+                for (int ci = 0; ci < numComponents; ++ci)
+                {
+                    var x = new Keyframe[n];
+                    Array.Copy(batch.keyframes, offset + n * ci, x, 0, n);
+                    ret[ci] = new AnimationCurve(x);
+                }
+                return ret;
+            }
+
             if (t == AnimationCurveData.DataType.Int)
             {
                 var x = new Keyframe[n];
@@ -1155,7 +1207,7 @@ namespace UTJ.MeshSync
 
             {
                 clip.SetCurve(path, ttrans, "m_LocalPosition", null);
-                var curves = GenCurves(msAnimationGetTransformTranslation(self), interpolation);
+                var curves = GenCurves(msAnimationGetTransformTranslation(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 3)
                 {
                     clip.SetCurve(path, ttrans, "m_LocalPosition.x", curves[0]);
@@ -1165,7 +1217,7 @@ namespace UTJ.MeshSync
             }
             {
                 clip.SetCurve(path, ttrans, "m_LocalRotation", null);
-                var curves = GenCurves(msAnimationGetTransformRotation(self), interpolation);
+                var curves = GenCurves(msAnimationGetTransformRotation(self), interpolation, ctx.curveBatch);
                 if (curves != null)
                 {
                     if (curves.Length == 3)
@@ -1185,7 +1237,7 @@ namespace UTJ.MeshSync
             }
             {
                 clip.SetCurve(path, ttrans, "m_LocalScale", null);
-                var curves = GenCurves(msAnimationGetTransformScale(self), interpolation);
+                var curves = GenCurves(msAnimationGetTransformScale(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 3)
                 {
                     clip.SetCurve(path, ttrans, "m_LocalScale.x", curves[0]);
@@ -1197,7 +1249,7 @@ namespace UTJ.MeshSync
             {
                 const string Target = "m_Enabled";
                 clip.SetCurve(path, ctx.mainComponentType, Target, null);
-                var curves = GenCurves(msAnimationGetTransformVisible(self), InterpolationMode.Constant);
+                var curves = GenCurves(msAnimationGetTransformVisible(self), InterpolationMode.Constant, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                     clip.SetCurve(path, ctx.mainComponentType, Target, curves[0]);
             }
@@ -1220,7 +1272,7 @@ namespace UTJ.MeshSync
             {
                 const string Target = "m_FocalLength";
                 clip.SetCurve(path, tcam, Target, null);
-                var curves = GenCurves(msAnimationGetCameraFocalLength(self), interpolation);
+                var curves = GenCurves(msAnimationGetCameraFocalLength(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                 {
                     clip.SetCurve(path, tcam, Target, curves[0]);
@@ -1231,7 +1283,7 @@ namespace UTJ.MeshSync
             {
                 {
                     clip.SetCurve(path, tcam, "m_SensorSize", null);
-                    var curves = GenCurves(msAnimationGetCameraSensorSize(self), interpolation);
+                    var curves = GenCurves(msAnimationGetCameraSensorSize(self), interpolation, ctx.curveBatch);
                     if (curves != null && curves.Length == 2)
                     {
                         clip.SetCurve(path, tcam, "m_SensorSize.x", curves[0]);
@@ -1240,7 +1292,7 @@ namespace UTJ.MeshSync
                 }
                 {
                     clip.SetCurve(path, tcam, "m_LensShift", null);
-                    var curves = GenCurves(msAnimationGetCameraLensShift(self), interpolation);
+                    var curves = GenCurves(msAnimationGetCameraLensShift(self), interpolation, ctx.curveBatch);
                     if (curves != null && curves.Length == 2)
                     {
                         clip.SetCurve(path, tcam, "m_LensShift.x", curves[0]);
@@ -1253,7 +1305,7 @@ namespace UTJ.MeshSync
             {
                 const string Target = "field of view";
                 clip.SetCurve(path, tcam, Target, null);
-                var curves = GenCurves(msAnimationGetCameraFieldOfView(self), interpolation);
+                var curves = GenCurves(msAnimationGetCameraFieldOfView(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                     clip.SetCurve(path, tcam, Target, curves[0]);
             }
@@ -1261,14 +1313,14 @@ namespace UTJ.MeshSync
             {
                 const string Target = "near clip plane";
                 clip.SetCurve(path, tcam, Target, null);
-                var curves = GenCurves(msAnimationGetCameraNearPlane(self), interpolation);
+                var curves = GenCurves(msAnimationGetCameraNearPlane(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                     clip.SetCurve(path, tcam, Target, curves[0]);
             }
             {
                 const string Target = "far clip plane";
                 clip.SetCurve(path, tcam, Target, null);
-                var curves = GenCurves(msAnimationGetCameraFarPlane(self), interpolation);
+                var curves = GenCurves(msAnimationGetCameraFarPlane(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                     clip.SetCurve(path, tcam, Target, curves[0]);
             }
@@ -1286,7 +1338,7 @@ namespace UTJ.MeshSync
 
             {
                 clip.SetCurve(path, tlight, "m_Color", null);
-                var curves = GenCurves(msAnimationGetLightColor(self), interpolation);
+                var curves = GenCurves(msAnimationGetLightColor(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 4)
                 {
                     clip.SetCurve(path, tlight, "m_Color.r", curves[0]);
@@ -1298,21 +1350,21 @@ namespace UTJ.MeshSync
             {
                 const string Target = "m_Intensity";
                 clip.SetCurve(path, tlight, Target, null);
-                var curves = GenCurves(msAnimationGetLightIntensity(self), interpolation);
+                var curves = GenCurves(msAnimationGetLightIntensity(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                     clip.SetCurve(path, tlight, Target, curves[0]);
             }
             {
                 const string Target = "m_Range";
                 clip.SetCurve(path, tlight, Target, null);
-                var curves = GenCurves(msAnimationGetLightRange(self), interpolation);
+                var curves = GenCurves(msAnimationGetLightRange(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                     clip.SetCurve(path, tlight, Target, curves[0]);
             }
             {
                 const string Target = "m_SpotAngle";
                 clip.SetCurve(path, tlight, Target, null);
-                var curves = GenCurves(msAnimationGetLightSpotAngle(self), interpolation);
+                var curves = GenCurves(msAnimationGetLightSpotAngle(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                     clip.SetCurve(path, tlight, Target, curves[0]);
             }
@@ -1344,7 +1396,7 @@ namespace UTJ.MeshSync
                 for (int bi = 0; bi < numBS; ++bi)
                 {
                     var data = s_blendshapes[bi];
-                    var curves = GenCurves(data, interpolation);
+                    var curves = GenCurves(data, interpolation, ctx.curveBatch);
                     if (curves != null && curves.Length == 1)
                         clip.SetCurve(path, tsmr, "blendShape." + data.blendshapeName, curves[0]);
                 }
@@ -1365,7 +1417,7 @@ namespace UTJ.MeshSync
             {
                 const string Target = "m_time";
                 clip.SetCurve(path, tpoints, Target, null);
-                var curves = GenCurves(msAnimationGetPointsTime(self), interpolation);
+                var curves = GenCurves(msAnimationGetPointsTime(self), interpolation, ctx.curveBatch);
                 if (curves != null && curves.Length == 1)
                     clip.SetCurve(path, tpoints, Target, curves[0]);
             }
@@ -1405,6 +1457,10 @@ namespace UTJ.MeshSync
         [DllImport("MeshSyncServer")] static extern IntPtr msAssetGetName(IntPtr self);
         [DllImport("MeshSyncServer")] static extern int msAnimationClipGetNumAnimations(IntPtr self);
         [DllImport("MeshSyncServer")] static extern AnimationData msAnimationClipGetAnimationData(IntPtr self, int i);
+        [DllImport("MeshSyncServer")] static extern void msSetSizeOfKeyframe(int v);
+        [DllImport("MeshSyncServer")] static extern int msAnimationClipGetNumCurves(IntPtr self);
+        [DllImport("MeshSyncServer")] static extern int msAnimationClipGetCurveLayout(IntPtr self, IntPtr[] curves, int[] offsets, InterpolationMode im);
+        [DllImport("MeshSyncServer")] static extern byte msAnimationClipFillCurves(IntPtr self, Keyframe[] dst, InterpolationMode im);
         #endregion
 
         public int id
@@ -1425,6 +1481,27 @@ namespace UTJ.MeshSync
         {
             return msAnimationClipGetAnimationData(self, i);
         }
+
+        // convert all curves to keyframes at once. this is much faster than converting curve by curve as
+        // curves are processed in parallel. the result is used by AnimationData.ExportToClip() via AnimationImportContext.
+        public AnimationCurveBatch FillCurves(InterpolationMode im)
+        {
+            msSetSizeOfKeyframe(Marshal.SizeOf(typeof(Keyframe)));
+            int numCurves = msAnimationClipGetNumCurves(self);
+            var curves = new IntPtr[numCurves];
+            var offsets = new int[numCurves];
+            int numKeyframes = msAnimationClipGetCurveLayout(self, curves, offsets, im);
+
+            var ret = new AnimationCurveBatch();
+            ret.interpolation = im;
+            ret.keyframes = new Keyframe[numKeyframes];
+            ret.offsets = new Dictionary<IntPtr, int>(numCurves);
+            if (msAnimationClipFillCurves(self, ret.keyframes, im) == 0)
+                return null;
+            for (int ci = 0; ci < numCurves; ++ci)
+                ret.offsets[curves[ci]] = offsets[ci];
+            return ret;
+        }
     }
     #endregion
 
@@ -1664,6 +1741,8 @@ namespace UTJ.MeshSync
         public IntPtr self;
         [DllImport("MeshSyncServer")] static extern int msSubmeshGetNumIndices(IntPtr self);
         [DllImport("MeshSyncServer")] static extern void msSubmeshReadIndices(IntPtr self, IntPtr dst);
+        [DllImport("MeshSyncServer")] static extern IndexFormat msSubmeshGetIndexFormat(IntPtr self);
+        [DllImport("MeshSyncServer")] static extern void msSubmeshReadIndices16(IntPtr self, IntPtr dst);
         [DllImport("MeshSyncServer")] static extern int msSubmeshGetMaterialID(IntPtr self);
         [DllImport("MeshSyncServer")] static extern Topology msSubmeshGetTopology(IntPtr self);
         #endregion
@@ -1676,11 +1755,20 @@ namespace UTJ.MeshSync
             Quads,
         };
 
+        public enum IndexFormat
+        {
+            UInt32,
+            UInt16,
+        };
+
 
         public int numIndices { get { return msSubmeshGetNumIndices(self); } }
         public Topology topology { get { return msSubmeshGetTopology(self); } }
+        public IndexFormat indexFormat { get { return msSubmeshGetIndexFormat(self); } }
         public int materialID { get { return msSubmeshGetMaterialID(self); } }
         public void ReadIndices(PinnedList<int> dst) { msSubmeshReadIndices(self, dst); }
+        // valid only if indexFormat is UInt16
+        public void ReadIndices(PinnedList<ushort> dst) { msSubmeshReadIndices16(self, dst); }
     }
 
     public struct SplitData
@@ -1694,6 +1782,8 @@ namespace UTJ.MeshSync
         [DllImport("MeshSyncServer")] static extern Vector3 msSplitGetBoundsSize(IntPtr self);
         [DllImport("MeshSyncServer")] static extern int msSplitGetNumSubmeshes(IntPtr self);
         [DllImport("MeshSyncServer")] static extern SubmeshData msSplitGetSubmesh(IntPtr self, int i);
+        [DllImport("MeshSyncServer")] static extern SubmeshData msSplitGetLODSubmesh(IntPtr self, int lod, int i);
+        [DllImport("MeshSyncServer")] static extern SubmeshData.IndexFormat msSplitGetIndexFormat(IntPtr self);
         #endregion
 
         public int numPoints { get { return msSplitGetNumPoints(self); } }
@@ -1701,11 +1791,16 @@ namespace UTJ.MeshSync
         public int numBoneWeights { get { return msSplitGetNumBoneWeights(self); } }
         public Bounds bounds { get { return new Bounds(msSplitGetBoundsCenter(self), msSplitGetBoundsSize(self)); } }
         public int numSubmeshes { get { return msSplitGetNumSubmeshes(self); } }
+        public SubmeshData.IndexFormat indexFormat { get { return msSplitGetIndexFormat(self); } }
 
         public SubmeshData GetSubmesh(int i)
         {
             return msSplitGetSubmesh(self, i);
         }
+        public SubmeshData GetLODSubmesh(int lod, int i)
+        {
+            return msSplitGetLODSubmesh(self, lod, i);
+        }
     }
 
     public struct BlendShapeData
@@ -1721,7 +1816,9 @@ namespace UTJ.MeshSync
         [DllImport("MeshSyncServer")] static extern void msBlendShapeReadPoints(IntPtr self, int f, IntPtr dst, SplitData split);
         [DllImport("MeshSyncServer")] static extern void msBlendShapeReadNormals(IntPtr self, int f, IntPtr dst, SplitData split);
         [DllImport("MeshSyncServer")] static extern void msBlendShapeReadTangents(IntPtr self, int f, IntPtr dst, SplitData split);
+        [DllImport("MeshSyncServer")] static extern int msBlendShapeGetNumSparseDeltas(IntPtr self, int f);
         [DllImport("MeshSyncServer")] static extern void msBlendShapeAddFrame(IntPtr self, float weight, int num, Vector3[] v, Vector3[] n, Vector3[] t);
+        [DllImport("MeshSyncServer")] static extern void msBlendShapeAddSparseFrame(IntPtr self, float weight, int num, int[] indices, Vector3[] v, Vector3[] n, Vector3[] t);
         #endregion
 
         public string name
@@ -1742,11 +1839,16 @@ namespace UTJ.MeshSync
         public void ReadPoints(int f, PinnedList<Vector3> dst, SplitData split) { msBlendShapeReadPoints(self, f, dst, split); }
         public void ReadNormals(int f, PinnedList<Vector3> dst, SplitData split) { msBlendShapeReadNormals(self, f, dst, split); }
         public void ReadTangents(int f, PinnedList<Vector3> dst, SplitData split) { msBlendShapeReadTangents(self, f, dst, split); }
+        public int GetNumSparseDeltas(int f) { return msBlendShapeGetNumSparseDeltas(self, f); }
 
         public void AddFrame(float w, Vector3[] v, Vector3[] n, Vector3[] t)
         {
             msBlendShapeAddFrame(self, w, v.Length, v, n, t);
         }
+        public void AddSparseFrame(float w, int[] indices, Vector3[] v, Vector3[] n, Vector3[] t)
+        {
+            msBlendShapeAddSparseFrame(self, w, indices.Length, indices, v, n, t);
+        }
     }
 
     public struct MeshDataFlags
@@ -1874,6 +1976,7 @@ namespace UTJ.MeshSync
         [DllImport("MeshSyncServer")] static extern void msMeshSetBonePath(IntPtr self, string v, int i);
         [DllImport("MeshSyncServer")] static extern void msMeshReadBindPoses(IntPtr self, Matrix4x4[] v);
         [DllImport("MeshSyncServer")] static extern void msMeshWriteBindPoses(IntPtr self, Matrix4x4[] v, int size);
+        [DllImport("MeshSyncServer")] static extern void msMeshBakeSkin(IntPtr self, Matrix4x4[] boneMatrices, int numBones, ref Matrix4x4 world2local);
 
         [DllImport("MeshSyncServer")] static extern void msMeshSetLocal2World(IntPtr self, ref Matrix4x4 v);
         [DllImport("MeshSyncServer")] static extern void msMeshSetWorld2Local(IntPtr self, ref Matrix4x4 v);
@@ -1881,6 +1984,11 @@ namespace UTJ.MeshSync
         [DllImport("MeshSyncServer")] static extern SplitData msMeshGetSplit(IntPtr self, int i);
         [DllImport("MeshSyncServer")] static extern int msMeshGetNumSubmeshes(IntPtr self);
         [DllImport("MeshSyncServer")] static extern SubmeshData msMeshGetSubmesh(IntPtr self, int i);
+        [DllImport("MeshSyncServer")] static extern int msMeshGetNumLODs(IntPtr self);
+        [DllImport("MeshSyncServer")] static extern ulong msMeshGetRefinePeakMemory(IntPtr self);
+        [DllImport("MeshSyncServer")] static extern VertexFormat msMeshGetVertexFormat(IntPtr self);
+        [DllImport("MeshSyncServer")] static extern int msMeshGetVertexStride(IntPtr self);
+        [DllImport("MeshSyncServer")] static extern void msMeshReadVertices(IntPtr self, IntPtr dst, SplitData split);
 
         [DllImport("MeshSyncServer")] static extern int msMeshGetNumBlendShapes(IntPtr self);
         [DllImport("MeshSyncServer")] static extern BlendShapeData msMeshGetBlendShapeData(IntPtr self, int i);
@@ -1915,6 +2023,8 @@ namespace UTJ.MeshSync
         public void ReadBoneWeightsV(IntPtr dst, SplitData split) { msMeshReadBoneWeightsV(self, dst, split); }
 #endif
         public void ReadIndices(IntPtr dst, SplitData split) { msMeshReadIndices(self, dst, split); }
+        // interleaved vertices in vertexFormat. dst must have room for split.numPoints * vertexStride bytes.
+        public void ReadVertices(IntPtr dst, SplitData split) { msMeshReadVertices(self, dst, split); }
 
         public void WritePoints(Vector3[] v) { msMeshWritePoints(self, v, v.Length); }
         public void WriteNormals(Vector3[] v) { msMeshWriteNormals(self, v, v.Length); }
@@ -1960,6 +2070,10 @@ namespace UTJ.MeshSync
             }
             set { msMeshWriteBindPoses(self, value, value.Length); }
         }
+        public void BakeSkin(Matrix4x4[] boneMatrices, Matrix4x4 world2local)
+        {
+            msMeshBakeSkin(self, boneMatrices, boneMatrices.Length, ref world2local);
+        }
         public void SetBonePaths(MeshSyncServer mss, Transform[] bones)
         {
             int n = bones.Length;
@@ -1979,6 +2093,10 @@ namespace UTJ.MeshSync
         }
 
         public int numSubmeshes { get { return msMeshGetNumSubmeshes(self); } }
+        public int numLODs { get { return msMeshGetNumLODs(self); } }
+        public ulong refinePeakMemory { get { return msMeshGetRefinePeakMemory(self); } }
+        public VertexFormat vertexFormat { get { return msMeshGetVertexFormat(self); } }
+        public int vertexStride { get { return msMeshGetVertexStride(self); } }
         public SubmeshData GetSubmesh(int i)
         {
             return msMeshGetSubmesh(self, i);
@@ -2243,6 +2361,7 @@ namespace UTJ.MeshSync
         [DllImport("MeshSyncServer")] static extern TransformData msSceneGetEntity(IntPtr self, int i);
         [DllImport("MeshSyncServer")] static extern int msSceneGetNumConstraints(IntPtr self);
         [DllImport("MeshSyncServer")] static extern ConstraintData msSceneGetConstraint(IntPtr self, int i);
+        [DllImport("MeshSyncServer")] static extern void msSceneBakeSkin(IntPtr self);
         #endregion
 
         public string name { get { return Misc.S(msSceneGetName(self)); } }
@@ -2253,6 +2372,7 @@ namespace UTJ.MeshSync
         public AssetData GetAsset(int i) { return msSceneGetAsset(self, i); }
         public TransformData GetEntity(int i) { return msSceneGetEntity(self, i); }
         public ConstraintData GetConstraint(int i) { return msSceneGetConstraint(self, i); }
+        public void BakeSkin() { msSceneBakeSkin(self); }
     }
     #endregion Scene
 }
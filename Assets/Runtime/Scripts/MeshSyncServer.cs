@@ -1893,6 +1893,8 @@ namespace UTJ.MeshSync
             //float start = Time.realtimeSinceStartup;
 
             var animClipCache = new Dictionary<GameObject, AnimationClip>();
+            // convert all curves at once
+            var curveBatch = clipData.FillCurves(m_animtionInterpolation);
 
             int numAnimations = clipData.numAnimations;
             for (int ai = 0; ai < numAnimations; ++ai)
@@ -1958,6 +1960,7 @@ namespace UTJ.MeshSync
                     path = animPath,
                     interpolation = m_animtionInterpolation,
                     enableVisibility = m_syncVisibility,
+                    curveBatch = curveBatch,
 #if UNITY_2018_1_OR_NEWER
                     usePhysicalCameraParams = m_usePhysicalCameraParams,
 #endif